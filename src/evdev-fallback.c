@@ -369,6 +369,7 @@ fallback_flush_mt_down(struct fallback_dispatch *dispatch,
 		return false;
 
 	seat->slot_map |= bit(seat_slot);
+	long_set_bit(dispatch->mt.active_slots, slot_idx);
 	point = slot->point;
 	slot->hysteresis_center = point;
 	evdev_transform_absolute(device, &point);
@@ -430,6 +431,7 @@ fallback_flush_mt_up(struct fallback_dispatch *dispatch,
 		return false;
 
 	seat->slot_map &= ~bit(seat_slot);
+	long_clear_bit(dispatch->mt.active_slots, slot_idx);
 
 	touch_notify_touch_up(base, time, slot_idx, seat_slot);
 
@@ -458,6 +460,7 @@ fallback_flush_mt_cancel(struct fallback_dispatch *dispatch,
 		return false;
 
 	seat->slot_map &= ~bit(seat_slot);
+	long_clear_bit(dispatch->mt.active_slots, slot_idx);
 
 	touch_notify_touch_cancel(base, time, slot_idx, seat_slot);
 
@@ -945,13 +948,12 @@ static inline bool
 fallback_any_button_down(struct fallback_dispatch *dispatch,
 			 struct evdev_device *device)
 {
-	for (evdev_usage_t usage = evdev_usage_from(EVDEV_BTN_LEFT);
-	     evdev_usage_lt(usage, EVDEV_BTN_JOYSTICK);
-	     usage = evdev_usage_next(usage)) {
-		if (libevdev_has_event_code(device->evdev,
-					    EV_KEY,
-					    evdev_usage_code(usage)) &&
-		    hw_is_key_down(dispatch, usage))
+	const size_t nlongs = ARRAY_LENGTH(dispatch->hw_key_mask);
+
+	for (int code = long_find_next_bit(dispatch->hw_key_mask, nlongs, BTN_LEFT);
+	     code >= 0 && code < BTN_JOYSTICK;
+	     code = long_find_next_bit(dispatch->hw_key_mask, nlongs, code + 1)) {
+		if (libevdev_has_event_code(device->evdev, EV_KEY, code))
 			return true;
 	}
 	return false;
@@ -1171,7 +1173,6 @@ cancel_touches(struct fallback_dispatch *dispatch,
 	       const struct device_coord_rect *rect,
 	       usec_t time)
 {
-	unsigned int idx;
 	bool need_frame = false;
 	struct device_coords point;
 
@@ -1180,14 +1181,13 @@ cancel_touches(struct fallback_dispatch *dispatch,
 	if (!rect || point_in_rect(&point, rect))
 		need_frame = fallback_flush_st_cancel(dispatch, device, time);
 
-	for (idx = 0; idx < dispatch->mt.slots_len; idx++) {
+	long_bit_for_each(dispatch->mt.active_slots,
+			  NLONGS(dispatch->mt.slots_len),
+			  idx) {
 		struct mt_slot *slot = &dispatch->mt.slots[idx];
 		point = slot->point;
 		evdev_transform_absolute(device, &point);
 
-		if (slot->seat_slot == -1)
-			continue;
-
 		if ((!rect || point_in_rect(&point, rect)) &&
 		    fallback_flush_mt_cancel(dispatch, device, idx, time))
 			need_frame = true;
@@ -1202,14 +1202,10 @@ release_pressed_keys(struct fallback_dispatch *dispatch,
 		     struct evdev_device *device,
 		     usec_t time)
 {
-	for (evdev_usage_t usage = evdev_usage_from(EVDEV_KEY_RESERVED);
-	     evdev_usage_le(usage, EVDEV_KEY_MAX);
-	     usage = evdev_usage_next(usage)) {
+	key_count_for_each_down(&device->key_count, code) {
+		evdev_usage_t usage = evdev_usage_from_code(EV_KEY, code);
 		int count = get_key_down_count(device, usage);
 
-		if (count == 0)
-			continue;
-
 		if (count > 1) {
 			evdev_log_bug_libinput(device,
 					       "key %d is down %d times.\n",
@@ -1404,6 +1400,7 @@ fallback_interface_destroy(struct evdev_dispatch *evdev_dispatch)
 	libinput_timer_destroy(&dispatch->debounce.timer_short);
 
 	free(dispatch->mt.slots);
+	free(dispatch->mt.active_slots);
 	free(dispatch);
 }
 
@@ -1702,6 +1699,7 @@ fallback_dispatch_init_slots(struct fallback_dispatch *dispatch,
 	}
 	dispatch->mt.slots = slots;
 	dispatch->mt.slots_len = num_slots;
+	dispatch->mt.active_slots = zalloc(NLONGS(num_slots) * sizeof(unsigned long));
 	dispatch->mt.slot = active_slot;
 	dispatch->mt.has_palm =
 		libevdev_has_event_code(evdev, EV_ABS, ABS_MT_TOOL_TYPE);
@@ -1748,8 +1746,13 @@ fallback_dispatch_init_switch(struct fallback_dispatch *dispatch,
 	if (device->tags & EVDEV_TAG_LID_SWITCH) {
 		dispatch->lid.reliability = evdev_read_switch_reliability_prop(device);
 		dispatch->lid.is_closed = false;
+		dispatch->base.pairing_wants |= bit(EVDEV_PAIRING_KEYBOARD);
 	}
 
+	/* see fallback_pair_tablet_mode() for the full checks */
+	if (device->tags & (EVDEV_TAG_INTERNAL_KEYBOARD | EVDEV_TAG_TRACKPOINT))
+		dispatch->base.pairing_wants |= bit(EVDEV_PAIRING_TABLET_MODE_SWITCH);
+
 	if (device->tags & EVDEV_TAG_TABLET_MODE_SWITCH) {
 		val = libevdev_get_event_value(device->evdev, EV_SW, SW_TABLET_MODE);
 		dispatch->tablet_mode.sw.state = val;
@@ -91,6 +91,8 @@ struct fallback_dispatch {
 		int slot;
 		struct mt_slot *slots;
 		size_t slots_len;
+		/* bitmask of slots with a seat slot, i.e. a touch we sent */
+		unsigned long *active_slots;
 		bool want_hysteresis;
 		struct device_coords hysteresis_margin;
 		bool has_palm;
@@ -216,7 +218,7 @@ get_key_down_count(struct evdev_device *device, evdev_usage_t usage)
 {
 	assert(evdev_usage_type(usage) == EV_KEY);
 	unsigned int code = evdev_usage_code(usage);
-	return device->key_count[code];
+	return key_count_get(&device->key_count, code);
 }
 
 void
@@ -81,56 +81,50 @@ button_event_to_str(enum button_event event)
 static inline bool
 is_inside_bottom_button_area(const struct tp_dispatch *tp, const struct tp_touch *t)
 {
-	return t->point.y >= tp->buttons.bottom_area.top_edge;
+	return !!(tp_zones_at(tp, t->point) & TP_ZONE_BOTTOM_AREA);
 }
 
 static inline bool
 is_inside_bottom_right_area(const struct tp_dispatch *tp, const struct tp_touch *t)
 {
-	return is_inside_bottom_button_area(tp, t) &&
-	       t->point.x > tp->buttons.bottom_area.rightbutton_left_edge;
+	return !!(tp_zones_at(tp, t->point) & TP_ZONE_BOTTOM_RIGHT);
 }
 
 static inline bool
 is_inside_bottom_middle_area(const struct tp_dispatch *tp, const struct tp_touch *t)
 {
-	return is_inside_bottom_button_area(tp, t) &&
-	       !is_inside_bottom_right_area(tp, t) &&
-	       t->point.x > tp->buttons.bottom_area.middlebutton_left_edge;
+	return !!(tp_zones_at(tp, t->point) & TP_ZONE_BOTTOM_MIDDLE);
 }
 
 static inline bool
 is_inside_top_button_area(const struct tp_dispatch *tp, const struct tp_touch *t)
 {
-	return t->point.y <= tp->buttons.top_area.bottom_edge;
+	return !!(tp_zones_at(tp, t->point) & TP_ZONE_TOP_AREA);
 }
 
 static inline bool
 is_inside_top_right_area(const struct tp_dispatch *tp, const struct tp_touch *t)
 {
-	return is_inside_top_button_area(tp, t) &&
-	       t->point.x > tp->buttons.top_area.rightbutton_left_edge;
+	return !!(tp_zones_at(tp, t->point) & TP_ZONE_TOP_RIGHT);
 }
 
 static inline bool
 is_inside_top_middle_area(const struct tp_dispatch *tp, const struct tp_touch *t)
 {
-	return is_inside_top_button_area(tp, t) &&
-	       t->point.x >= tp->buttons.top_area.leftbutton_right_edge &&
-	       t->point.x <= tp->buttons.top_area.rightbutton_left_edge;
+	return !!(tp_zones_at(tp, t->point) & TP_ZONE_TOP_MIDDLE);
 }
 
 static void
 tp_button_set_enter_timer(struct tp_dispatch *tp, struct tp_touch *t, usec_t time)
 {
-	libinput_timer_set(&t->button.timer,
+	libinput_timer_set(&tp_touch_cold(t)->button_timer,
 			   usec_add(time, DEFAULT_BUTTON_ENTER_TIMEOUT));
 }
 
 static void
 tp_button_set_leave_timer(struct tp_dispatch *tp, struct tp_touch *t, usec_t time)
 {
-	libinput_timer_set(&t->button.timer,
+	libinput_timer_set(&tp_touch_cold(t)->button_timer,
 			   usec_add(time, DEFAULT_BUTTON_LEAVE_TIMEOUT));
 }
 
@@ -145,7 +139,7 @@ tp_button_set_state(struct tp_dispatch *tp,
 		    enum button_event event,
 		    usec_t time)
 {
-	libinput_timer_cancel(&t->button.timer);
+	libinput_timer_cancel(&tp_touch_cold(t)->button_timer);
 
 	t->button.state = new_state;
 
@@ -501,8 +495,8 @@ tp_button_handle_state(struct tp_dispatch *tp, usec_t time)
 {
 	struct tp_touch *t;
 
-	tp_for_each_touch(tp, t) {
-		if (t->state == TOUCH_NONE || t->state == TOUCH_HOVERING)
+	tp_for_each_active_touch(tp, t) {
+		if (t->state == TOUCH_HOVERING)
 			continue;
 
 		if (t->state == TOUCH_BEGIN) {
@@ -587,7 +581,7 @@ tp_release_all_buttons(struct tp_dispatch *tp, usec_t time)
 }
 
 static void
-tp_init_softbuttons(struct tp_dispatch *tp, struct evdev_device *device)
+tp_init_middle_softbutton(struct tp_dispatch *tp, struct evdev_device *device)
 {
 	double width, height;
 	struct device_coords edges;
@@ -596,24 +590,6 @@ tp_init_softbuttons(struct tp_dispatch *tp, struct evdev_device *device)
 
 	evdev_device_get_size(device, &width, &height);
 
-	/* button height: 10mm or 15% or the touchpad height,
-	   whichever is smaller */
-	if (height * 0.15 > 10)
-		mm.y = height - 10;
-	else
-		mm.y = height * 0.85;
-
-	mm.x = width * 0.5;
-	edges = evdev_device_mm_to_units(device, &mm);
-	tp->buttons.bottom_area.top_edge = edges.y;
-	tp->buttons.bottom_area.rightbutton_left_edge = edges.x;
-
-	tp->buttons.bottom_area.middlebutton_left_edge = INT_MAX;
-
-	/* if middlebutton emulation is enabled, don't init a software area */
-	if (device->middlebutton.want_enabled)
-		return;
-
 	/* The middle button is 25% of the touchpad and centered. Many
 	 * touchpads don't have markings for the middle button at all so we
 	 * need to make it big enough to reliably hit it but not too big so
@@ -644,6 +620,36 @@ tp_init_softbuttons(struct tp_dispatch *tp, struct evdev_device *device)
 	tp->buttons.bottom_area.rightbutton_left_edge = mb_re;
 }
 
+static void
+tp_init_softbuttons(struct tp_dispatch *tp, struct evdev_device *device)
+{
+	double width, height;
+	struct device_coords edges;
+	struct phys_coords mm = { 0.0, 0.0 };
+
+	evdev_device_get_size(device, &width, &height);
+
+	/* button height: 10mm or 15% or the touchpad height,
+	   whichever is smaller */
+	if (height * 0.15 > 10)
+		mm.y = height - 10;
+	else
+		mm.y = height * 0.85;
+
+	mm.x = width * 0.5;
+	edges = evdev_device_mm_to_units(device, &mm);
+	tp->buttons.bottom_area.top_edge = edges.y;
+	tp->buttons.bottom_area.rightbutton_left_edge = edges.x;
+
+	tp->buttons.bottom_area.middlebutton_left_edge = INT_MAX;
+
+	/* if middlebutton emulation is enabled, don't init a software area */
+	if (!device->middlebutton.want_enabled)
+		tp_init_middle_softbutton(tp, device);
+
+	tp_zones_rebuild(tp);
+}
+
 void
 tp_init_top_softbuttons(struct tp_dispatch *tp,
 			struct evdev_device *device,
@@ -674,6 +680,8 @@ tp_init_top_softbuttons(struct tp_dispatch *tp,
 	} else {
 		tp->buttons.top_area.bottom_edge = INT_MIN;
 	}
+
+	tp_zones_rebuild(tp);
 }
 
 static inline uint32_t
@@ -718,6 +726,8 @@ tp_switch_click_method(struct tp_dispatch *tp)
 		tp->buttons.bottom_area.top_edge = INT_MAX;
 		break;
 	}
+
+	tp_zones_rebuild(tp);
 }
 
 static enum libinput_config_status
@@ -1013,7 +1023,7 @@ tp_init_buttons(struct tp_dispatch *tp, struct evdev_device *device)
 			 evdev_device_get_sysname(device),
 			 i);
 		t->button.state = BUTTON_STATE_NONE;
-		libinput_timer_init(&t->button.timer,
+		libinput_timer_init(&tp_touch_cold(t)->button_timer,
 				    tp_libinput_context(tp),
 				    timer_name,
 				    tp_button_handle_timeout,
@@ -1027,8 +1037,8 @@ tp_remove_buttons(struct tp_dispatch *tp)
 	struct tp_touch *t;
 
 	tp_for_each_touch(tp, t) {
-		libinput_timer_cancel(&t->button.timer);
-		libinput_timer_destroy(&t->button.timer);
+		libinput_timer_cancel(&tp_touch_cold(t)->button_timer);
+		libinput_timer_destroy(&tp_touch_cold(t)->button_timer);
 	}
 }
 
@@ -1134,7 +1144,7 @@ tp_clickfinger_set_button(struct tp_dispatch *tp)
 		{ EVDEV_BTN_LEFT, EVDEV_BTN_MIDDLE, EVDEV_BTN_RIGHT },
 	};
 
-	tp_for_each_touch(tp, t) {
+	tp_for_each_active_touch(tp, t) {
 		if (t->state != TOUCH_BEGIN && t->state != TOUCH_UPDATE)
 			continue;
 
@@ -73,14 +73,16 @@ uint32_t
 tp_touch_get_edge(const struct tp_dispatch *tp, const struct tp_touch *t)
 {
 	uint32_t edge = EDGE_NONE;
+	uint32_t zones;
 
 	if (tp->scroll.method != LIBINPUT_CONFIG_SCROLL_EDGE)
 		return EDGE_NONE;
 
-	if (t->point.x > tp->scroll.right_edge)
+	zones = tp_zones_at(tp, t->point);
+	if (zones & TP_ZONE_EDGE_SCROLL_RIGHT)
 		edge |= EDGE_RIGHT;
 
-	if (t->point.y > tp->scroll.bottom_edge)
+	if (zones & TP_ZONE_EDGE_SCROLL_BOTTOM)
 		edge |= EDGE_BOTTOM;
 
 	return edge;
@@ -97,7 +99,7 @@ tp_edge_scroll_set_timer(struct tp_dispatch *tp, struct tp_touch *t, usec_t time
 	if (tp->buttons.click_method == LIBINPUT_CONFIG_CLICK_METHOD_BUTTON_AREAS)
 		return;
 
-	libinput_timer_set(&t->scroll.timer,
+	libinput_timer_set(&tp_touch_cold(t)->scroll_timer,
 			   usec_add(time, DEFAULT_SCROLL_LOCK_TIMEOUT));
 }
 
@@ -107,7 +109,7 @@ tp_edge_scroll_set_state(struct tp_dispatch *tp,
 			 enum tp_edge_scroll_touch_state state,
 			 usec_t time)
 {
-	libinput_timer_cancel(&t->scroll.timer);
+	libinput_timer_cancel(&tp_touch_cold(t)->scroll_timer);
 
 	t->scroll.edge_state = state;
 
@@ -330,7 +332,7 @@ tp_edge_scroll_init(struct tp_dispatch *tp, struct evdev_device *device)
 			 evdev_device_get_sysname(device),
 			 i);
 		t->scroll.direction = -1;
-		libinput_timer_init(&t->scroll.timer,
+		libinput_timer_init(&tp_touch_cold(t)->scroll_timer,
 				    tp_libinput_context(tp),
 				    timer_name,
 				    tp_edge_scroll_handle_timeout,
@@ -344,8 +346,8 @@ tp_remove_edge_scroll(struct tp_dispatch *tp)
 	struct tp_touch *t;
 
 	tp_for_each_touch(tp, t) {
-		libinput_timer_cancel(&t->scroll.timer);
-		libinput_timer_destroy(&t->scroll.timer);
+		libinput_timer_cancel(&tp_touch_cold(t)->scroll_timer);
+		libinput_timer_destroy(&tp_touch_cold(t)->scroll_timer);
 	}
 }
 
@@ -364,10 +366,7 @@ tp_edge_scroll_handle_state(struct tp_dispatch *tp, usec_t time)
 		return;
 	}
 
-	tp_for_each_touch(tp, t) {
-		if (!t->dirty)
-			continue;
-
+	tp_for_each_dirty_touch(tp, t) {
 		switch (t->state) {
 		case TOUCH_NONE:
 		case TOUCH_HOVERING:
@@ -405,10 +404,7 @@ tp_edge_scroll_post_events(struct tp_dispatch *tp, usec_t time)
 	struct normalized_coords normalized, tmp;
 	const struct normalized_coords zero = { 0.0, 0.0 };
 
-	tp_for_each_touch(tp, t) {
-		if (!t->dirty)
-			continue;
-
+	tp_for_each_dirty_touch(tp, t) {
 		if (t->palm.state != PALM_NONE || tp_thumb_ignored(tp, t))
 			continue;
 
@@ -122,13 +122,11 @@ static struct device_float_coords
 tp_get_touches_delta(struct tp_dispatch *tp, bool average)
 {
 	struct tp_touch *t;
-	unsigned int i, nactive = 0;
+	unsigned int nactive = 0;
 	struct device_float_coords delta = { 0.0, 0.0 };
 
-	for (i = 0; i < tp->num_slots; i++) {
-		t = &tp->touches[i];
-
-		if (!tp_touch_active_for_gesture(tp, t))
+	tp_for_each_active_touch(tp, t) {
+		if (t->index >= tp->num_slots || !tp_touch_active_for_gesture(tp, t))
 			continue;
 
 		nactive++;
@@ -221,7 +219,7 @@ tp_gesture_post_pointer_motion(struct tp_dispatch *tp, usec_t time)
 		struct device_float_coords unaccel;
 
 		unaccel = tp_scale_to_xaxis(tp, raw);
-		pointer_notify_motion(&tp->device->base, time, &delta, &unaccel);
+		tp_notify_pointer_motion(tp, time, &delta, &unaccel);
 	}
 }
 
@@ -235,7 +233,7 @@ tp_gesture_get_active_touches(const struct tp_dispatch *tp,
 
 	memset(touches, 0, count * sizeof(struct tp_touch *));
 
-	tp_for_each_touch(tp, t) {
+	tp_for_each_active_touch(tp, t) {
 		if (tp_touch_active_for_gesture(tp, t)) {
 			touches[n++] = t;
 			if (n == count)
@@ -293,33 +291,69 @@ tp_gesture_get_direction(struct tp_dispatch *tp, struct tp_touch *touch)
 	return phys_get_direction(mm);
 }
 
-static void
-tp_gesture_get_pinch_info(struct tp_dispatch *tp,
-			  double *distance,
-			  double *angle,
-			  struct device_float_coords *center)
+static inline void
+tp_gesture_init_pinch(struct tp_dispatch *tp)
 {
-	struct normalized_coords normalized;
-	struct device_float_coords delta;
 	struct tp_touch *first = tp->gesture.touches[0],
 			*second = tp->gesture.touches[1];
+	struct normalized_coords v;
 
-	delta = device_delta(first->point, second->point);
-	normalized = tp_normalize_delta(tp, delta);
-	*distance = normalized_length(normalized);
-	*angle = rad2deg(atan2(normalized.y, normalized.x));
+	v = tp_normalize_delta(tp, device_delta(first->point, second->point));
 
-	*center = device_average(first->point, second->point);
+	tp->gesture.pinch.first = first->point;
+	tp->gesture.pinch.second = second->point;
+	tp->gesture.pinch.vector = v;
+	tp->gesture.pinch.initial_distance2 = v.x * v.x + v.y * v.y;
+	tp->gesture.pinch.scale = 1.0;
+	tp->gesture.pinch.prev_scale = 1.0;
+	tp->gesture.pinch.angle_delta = 0.0;
+	tp->gesture.pinch.center = device_average(first->point, second->point);
+	tp->gesture.pinch.center_delta = (struct device_float_coords){ 0.0, 0.0 };
 }
 
-static inline void
-tp_gesture_init_pinch(struct tp_dispatch *tp)
+/**
+ * Update the pinch geometry from the current position of the two
+ * gesture touches. Returns false if neither touch moved since the last
+ * update, the geometry is unchanged then.
+ */
+static bool
+tp_gesture_update_pinch(struct tp_dispatch *tp)
 {
-	tp_gesture_get_pinch_info(tp,
-				  &tp->gesture.initial_distance,
-				  &tp->gesture.angle,
-				  &tp->gesture.center);
-	tp->gesture.prev_scale = 1.0;
+	struct tp_touch *first = tp->gesture.touches[0],
+			*second = tp->gesture.touches[1];
+	struct normalized_coords prev = tp->gesture.pinch.vector, v;
+	struct device_float_coords center;
+	double cross, dot;
+
+	if (first->point.x == tp->gesture.pinch.first.x &&
+	    first->point.y == tp->gesture.pinch.first.y &&
+	    second->point.x == tp->gesture.pinch.second.x &&
+	    second->point.y == tp->gesture.pinch.second.y)
+		return false;
+
+	tp->gesture.pinch.first = first->point;
+	tp->gesture.pinch.second = second->point;
+
+	v = tp_normalize_delta(tp, device_delta(first->point, second->point));
+	tp->gesture.pinch.vector = v;
+	tp->gesture.pinch.scale =
+		sqrt((v.x * v.x + v.y * v.y) / tp->gesture.pinch.initial_distance2);
+
+	/* The rotation is the angle between the previous and the current
+	 * vector, no need for an atan2() if only the distance changed */
+	cross = prev.x * v.y - prev.y * v.x;
+	dot = prev.x * v.x + prev.y * v.y;
+	if (cross != 0.0)
+		tp->gesture.pinch.angle_delta = rad2deg(atan2(cross, dot));
+	else
+		tp->gesture.pinch.angle_delta = dot < 0.0 ? 180.0 : 0.0;
+
+	center = device_average(first->point, second->point);
+	tp->gesture.pinch.center_delta =
+		device_float_delta(center, tp->gesture.pinch.center);
+	tp->gesture.pinch.center = center;
+
+	return true;
 }
 
 static void
@@ -925,7 +959,7 @@ tp_gesture_handle_event_on_state_pinch(struct tp_dispatch *tp,
 		gesture_notify_pinch_end(&tp->device->base,
 					 time,
 					 tp->gesture.finger_count,
-					 tp->gesture.prev_scale,
+					 tp->gesture.pinch.prev_scale,
 					 cancelled);
 		libinput_timer_cancel(&tp->gesture.hold_timer);
 		tp->gesture.state = GESTURE_STATE_NONE;
@@ -1783,28 +1817,20 @@ static void
 tp_gesture_handle_state_pinch_start(struct tp_dispatch *tp, usec_t time)
 {
 	const struct normalized_coords zero = { 0.0, 0.0 };
-	double angle, angle_delta, distance, scale;
-	struct device_float_coords center, fdelta;
+	struct device_float_coords fdelta;
 	struct normalized_coords delta;
+	double scale;
 
-	tp_gesture_get_pinch_info(tp, &distance, &angle, &center);
-
-	scale = distance / tp->gesture.initial_distance;
-
-	angle_delta = angle - tp->gesture.angle;
-	tp->gesture.angle = angle;
-	if (angle_delta > 180.0)
-		angle_delta -= 360.0;
-	else if (angle_delta < -180.0)
-		angle_delta += 360.0;
-
-	fdelta = device_float_delta(center, tp->gesture.center);
-	tp->gesture.center = center;
+	if (!tp_gesture_update_pinch(tp))
+		return;
 
+	scale = tp->gesture.pinch.scale;
+	fdelta = tp->gesture.pinch.center_delta;
 	delta = tp_filter_motion(tp, &fdelta, time);
 
 	if (normalized_is_zero(delta) && device_float_is_zero(fdelta) &&
-	    scale == tp->gesture.prev_scale && angle_delta == 0.0)
+	    scale == tp->gesture.pinch.prev_scale &&
+	    tp->gesture.pinch.angle_delta == 0.0)
 		return;
 
 	gesture_notify_pinch(&tp->device->base,
@@ -1816,35 +1842,27 @@ tp_gesture_handle_state_pinch_start(struct tp_dispatch *tp, usec_t time)
 			     1.0,
 			     0.0);
 
-	tp->gesture.prev_scale = scale;
+	tp->gesture.pinch.prev_scale = scale;
 	tp->gesture.state = GESTURE_STATE_PINCH;
 }
 
 static void
 tp_gesture_handle_state_pinch(struct tp_dispatch *tp, usec_t time)
 {
-	double angle, angle_delta, distance, scale;
-	struct device_float_coords center, fdelta;
+	struct device_float_coords fdelta;
 	struct normalized_coords delta, unaccel;
+	double scale;
 
-	tp_gesture_get_pinch_info(tp, &distance, &angle, &center);
-
-	scale = distance / tp->gesture.initial_distance;
-
-	angle_delta = angle - tp->gesture.angle;
-	tp->gesture.angle = angle;
-	if (angle_delta > 180.0)
-		angle_delta -= 360.0;
-	else if (angle_delta < -180.0)
-		angle_delta += 360.0;
-
-	fdelta = device_float_delta(center, tp->gesture.center);
-	tp->gesture.center = center;
+	if (!tp_gesture_update_pinch(tp))
+		return;
 
+	scale = tp->gesture.pinch.scale;
+	fdelta = tp->gesture.pinch.center_delta;
 	delta = tp_filter_motion(tp, &fdelta, time);
 
 	if (normalized_is_zero(delta) && device_float_is_zero(fdelta) &&
-	    scale == tp->gesture.prev_scale && angle_delta == 0.0)
+	    scale == tp->gesture.pinch.prev_scale &&
+	    tp->gesture.pinch.angle_delta == 0.0)
 		return;
 
 	unaccel = tp_filter_motion_unaccelerated(tp, &fdelta, time);
@@ -1855,9 +1873,9 @@ tp_gesture_handle_state_pinch(struct tp_dispatch *tp, usec_t time)
 			     &delta,
 			     &unaccel,
 			     scale,
-			     angle_delta);
+			     tp->gesture.pinch.angle_delta);
 
-	tp->gesture.prev_scale = scale;
+	tp->gesture.pinch.prev_scale = scale;
 }
 
 static void
@@ -2240,7 +2258,7 @@ tp_gesture_update_finger_state(struct tp_dispatch *tp, usec_t time)
 	unsigned int active_touches = 0;
 	struct tp_touch *t;
 
-	tp_for_each_touch(tp, t) {
+	tp_for_each_active_touch(tp, t) {
 		if (tp_touch_active_for_gesture(tp, t))
 			active_touches++;
 	}
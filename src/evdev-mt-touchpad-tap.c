@@ -52,7 +52,8 @@ enum tap_event {
  * Look at the state diagram in doc/touchpad-tap-state-machine.svg
  * (generated with https://www.diagrams.net)
  *
- * Any changes in this file must be represented in the diagram.
+ * Any changes in this file, in particular in the tap_transitions table,
+ * must be represented in the diagram.
  */
 
 static inline const char *
@@ -181,888 +182,389 @@ tp_tap_clear_timer(struct tp_dispatch *tp)
 static bool
 tp_touch_near_any_edge(struct tp_dispatch *tp, struct tp_touch *t)
 {
-	return (t->point.x < tp->tap.edges.left || t->point.x > tp->tap.edges.right ||
-		t->point.y < tp->tap.edges.top || t->point.y > tp->tap.edges.bottom);
+	return !!(tp_zones_at(tp, t->point) & (TP_ZONE_TAP_EDGE_X | TP_ZONE_TAP_EDGE_Y));
 }
 
-static void
-tp_tap_move_to_dead(struct tp_dispatch *tp, struct tp_touch *t)
-{
-	tp->tap.state = TAP_STATE_DEAD;
-	t->tap.state = TAP_TOUCH_STATE_DEAD;
-	tp_tap_clear_timer(tp);
-}
-
-static void
-tp_tap_idle_handle_event(struct tp_dispatch *tp,
-			 struct tp_touch *t,
-			 enum tap_event event,
-			 usec_t time)
-{
-	switch (event) {
-	case TAP_EVENT_TOUCH:
-		tp->tap.state = TAP_STATE_TOUCH;
-		tp->tap.saved_press_time = time;
-		tp_tap_set_timer(tp, time);
-		break;
-	case TAP_EVENT_RELEASE:
-		break;
-	case TAP_EVENT_MOTION:
-		log_tap_bug(tp, t, event);
-		break;
-	case TAP_EVENT_TIMEOUT:
-		break;
-	case TAP_EVENT_BUTTON:
-		tp->tap.state = TAP_STATE_DEAD;
-		break;
-	case TAP_EVENT_THUMB:
-		log_tap_bug(tp, t, event);
-		break;
-	case TAP_EVENT_PALM:
-		tp->tap.state = TAP_STATE_IDLE;
-		break;
-	case TAP_EVENT_PALM_UP:
-		break;
-	}
-}
+/**
+ * The tap state machine is a table of (state, event) → transition. A
+ * transition is one step or, if it has a guard, two steps where the
+ * second one is taken if the guard is true. A step switches to the next
+ * state, then runs its actions in order.
+ */
 
-static void
-tp_tap_touch_handle_event(struct tp_dispatch *tp,
-			  struct tp_touch *t,
-			  enum tap_event event,
-			  usec_t time)
-{
+#define TAP_STATE_UNCHANGED 1 /* not a valid enum tp_tap_state */
+#define TAP_NSTATES (TAP_STATE_DEAD - TAP_STATE_IDLE + 1)
+#define TAP_NEVENTS (TAP_EVENT_PALM_UP - TAP_EVENT_TOUCH + 1)
 
-	switch (event) {
-	case TAP_EVENT_TOUCH:
-		tp->tap.state = TAP_STATE_TOUCH_2;
-		tp->tap.saved_press_time = time;
-		tp_tap_set_timer(tp, time);
-		break;
-	case TAP_EVENT_RELEASE:
-		tp_tap_notify(tp,
-			      tp->tap.saved_press_time,
-			      1,
-			      LIBINPUT_BUTTON_STATE_PRESSED);
-		if (tp->tap.drag_enabled) {
-			tp->tap.state = TAP_STATE_1FGTAP_TAPPED;
-			tp->tap.saved_release_time = time;
-			tp_tap_set_drag_timer(tp, time, 1);
-		} else {
-			tp_tap_notify(tp, time, 1, LIBINPUT_BUTTON_STATE_RELEASED);
-			tp->tap.state = TAP_STATE_IDLE;
-		}
-		break;
-	case TAP_EVENT_MOTION:
-		tp_tap_move_to_dead(tp, t);
-		break;
-	case TAP_EVENT_TIMEOUT:
-		tp->tap.state = TAP_STATE_HOLD;
-		tp_tap_clear_timer(tp);
-		tp_gesture_tap_timeout(tp, time);
-		break;
-	case TAP_EVENT_BUTTON:
-		tp->tap.state = TAP_STATE_DEAD;
-		break;
-	case TAP_EVENT_THUMB:
-		tp->tap.state = TAP_STATE_IDLE;
-		t->tap.is_thumb = true;
-		tp->tap.nfingers_down--;
-		t->tap.state = TAP_TOUCH_STATE_DEAD;
-		tp_tap_clear_timer(tp);
-		break;
-	case TAP_EVENT_PALM:
-		tp->tap.state = TAP_STATE_IDLE;
-		tp_tap_clear_timer(tp);
-		break;
-	case TAP_EVENT_PALM_UP:
-		break;
-	}
-}
+enum tap_guard {
+	TAP_GUARD_NONE = 0,
+	TAP_GUARD_DRAG_ENABLED,
+	TAP_GUARD_DRAG_LOCK, /* drag lock enabled or touch near an edge */
+	TAP_GUARD_NO_FINGERS_DOWN,
+};
 
-static void
-tp_tap_hold_handle_event(struct tp_dispatch *tp,
-			 struct tp_touch *t,
-			 enum tap_event event,
-			 usec_t time)
-{
+enum tap_action_type {
+	TAP_ACTION_NONE = 0,
+	TAP_ACTION_BUG, /* the event is invalid in this state */
+	TAP_ACTION_SAVE_PRESS_TIME,
+	TAP_ACTION_SAVE_RELEASE_TIME,
+	TAP_ACTION_SET_TIMER,
+	TAP_ACTION_SET_DRAG_TIMER,
+	TAP_ACTION_SET_DRAGLOCK_TIMER, /* unless drag lock is sticky */
+	TAP_ACTION_CLEAR_TIMER,
+	TAP_ACTION_PRESS,       /* at the saved press time */
+	TAP_ACTION_RELEASE,     /* at the saved release time */
+	TAP_ACTION_RELEASE_NOW, /* at the event time */
+	TAP_ACTION_TOUCH_DEAD,
+	TAP_ACTION_THUMB,
+	TAP_ACTION_GESTURE_TAP_TIMEOUT,
+};
 
-	switch (event) {
-	case TAP_EVENT_TOUCH:
-		tp->tap.state = TAP_STATE_TOUCH_2;
-		tp->tap.saved_press_time = time;
-		tp_tap_set_timer(tp, time);
-		break;
-	case TAP_EVENT_RELEASE:
-		tp->tap.state = TAP_STATE_IDLE;
-		break;
-	case TAP_EVENT_MOTION:
-		tp_tap_move_to_dead(tp, t);
-		break;
-	case TAP_EVENT_TIMEOUT:
-		break;
-	case TAP_EVENT_BUTTON:
-		tp->tap.state = TAP_STATE_DEAD;
-		break;
-	case TAP_EVENT_THUMB:
-		tp->tap.state = TAP_STATE_IDLE;
-		t->tap.is_thumb = true;
-		tp->tap.nfingers_down--;
-		t->tap.state = TAP_TOUCH_STATE_DEAD;
-		break;
-	case TAP_EVENT_PALM:
-		tp->tap.state = TAP_STATE_IDLE;
-		break;
-	case TAP_EVENT_PALM_UP:
-		break;
-	}
-}
+struct tap_action {
+	uint8_t type;     /* enum tap_action_type */
+	uint8_t nfingers; /* for buttons and the drag timer */
+};
 
-static void
-tp_tap_tapped_handle_event(struct tp_dispatch *tp,
-			   struct tp_touch *t,
-			   enum tap_event event,
-			   usec_t time,
-			   int nfingers_tapped)
-{
-	switch (event) {
-	case TAP_EVENT_MOTION:
-	case TAP_EVENT_RELEASE:
-		log_tap_bug(tp, t, event);
-		break;
-	case TAP_EVENT_TOUCH: {
-		enum tp_tap_state dest[3] = {
-			TAP_STATE_1FGTAP_DRAGGING_OR_DOUBLETAP,
-			TAP_STATE_2FGTAP_DRAGGING_OR_DOUBLETAP,
-			TAP_STATE_3FGTAP_DRAGGING_OR_DOUBLETAP,
-		};
-		assert(nfingers_tapped >= 1 && nfingers_tapped <= 3);
-		tp->tap.state = dest[nfingers_tapped - 1];
-		tp->tap.saved_press_time = time;
-		tp_tap_set_timer(tp, time);
-		break;
-	}
-	case TAP_EVENT_TIMEOUT:
-		tp->tap.state = TAP_STATE_IDLE;
-		tp_tap_notify(tp,
-			      tp->tap.saved_release_time,
-			      nfingers_tapped,
-			      LIBINPUT_BUTTON_STATE_RELEASED);
-		break;
-	case TAP_EVENT_BUTTON:
-		tp->tap.state = TAP_STATE_DEAD;
-		tp_tap_notify(tp,
-			      tp->tap.saved_release_time,
-			      nfingers_tapped,
-			      LIBINPUT_BUTTON_STATE_RELEASED);
-		break;
-	case TAP_EVENT_THUMB:
-		log_tap_bug(tp, t, event);
-		break;
-	case TAP_EVENT_PALM:
-		log_tap_bug(tp, t, event);
-		break;
-	case TAP_EVENT_PALM_UP:
-		break;
-	}
-}
+struct tap_step {
+	uint8_t next; /* enum tp_tap_state or TAP_STATE_UNCHANGED */
+	struct tap_action actions[4];
+};
 
-static void
-tp_tap_touch2_handle_event(struct tp_dispatch *tp,
-			   struct tp_touch *t,
-			   enum tap_event event,
-			   usec_t time)
-{
+struct tap_transition {
+	uint8_t guard; /* enum tap_guard */
+	struct tap_step step[2];
+};
 
-	switch (event) {
-	case TAP_EVENT_TOUCH:
-		tp->tap.state = TAP_STATE_TOUCH_3;
-		tp->tap.saved_press_time = time;
-		tp_tap_set_timer(tp, time);
-		break;
-	case TAP_EVENT_RELEASE:
-		tp->tap.state = TAP_STATE_TOUCH_2_RELEASE;
-		tp->tap.saved_release_time = time;
-		tp_tap_set_timer(tp, time);
-		break;
-	case TAP_EVENT_MOTION:
-		tp_tap_move_to_dead(tp, t);
-		break;
-	case TAP_EVENT_TIMEOUT:
-		tp->tap.state = TAP_STATE_TOUCH_2_HOLD;
-		tp_gesture_tap_timeout(tp, time);
-		break;
-	case TAP_EVENT_BUTTON:
-		tp->tap.state = TAP_STATE_DEAD;
-		break;
-	case TAP_EVENT_THUMB:
-		break;
-	case TAP_EVENT_PALM:
-		tp->tap.state = TAP_STATE_TOUCH;
-		break;
-	case TAP_EVENT_PALM_UP:
-		break;
-	}
-}
+#define S(state_) TAP_STATE_##state_
+#define STAY TAP_STATE_UNCHANGED
+#define A(type_) { TAP_ACTION_##type_, 0 }
+#define AN(type_, nfingers_) { TAP_ACTION_##type_, nfingers_ }
+#define STEP(next_, ...) { next_, { __VA_ARGS__ } }
+#define ON(event_, next_, ...) \
+	[TAP_EVENT_##event_ - TAP_EVENT_TOUCH] = { TAP_GUARD_NONE, \
+						   { STEP(next_, __VA_ARGS__) } }
+#define ON_IF(event_, guard_, if_false_, if_true_) \
+	[TAP_EVENT_##event_ - TAP_EVENT_TOUCH] = { TAP_GUARD_##guard_, \
+						   { if_false_, if_true_ } }
+#define STATE(state_, ...) [TAP_STATE_##state_ - TAP_STATE_IDLE] = { __VA_ARGS__ }
+
+#define TAPPED(n_) \
+	STATE(n_##FGTAP_TAPPED, \
+	      ON(TOUCH, S(n_##FGTAP_DRAGGING_OR_DOUBLETAP), \
+		 A(SAVE_PRESS_TIME), A(SET_TIMER)), \
+	      ON(RELEASE, STAY, A(BUG)), \
+	      ON(MOTION, STAY, A(BUG)), \
+	      ON(TIMEOUT, S(IDLE), AN(RELEASE, n_)), \
+	      ON(BUTTON, S(DEAD), AN(RELEASE, n_)), \
+	      ON(THUMB, STAY, A(BUG)), \
+	      ON(PALM, STAY, A(BUG)), \
+	      ON(PALM_UP, STAY))
+
+#define DRAGGING_OR_DOUBLETAP(n_) \
+	STATE(n_##FGTAP_DRAGGING_OR_DOUBLETAP, \
+	      ON(TOUCH, S(TOUCH_2), \
+		 AN(RELEASE, n_), A(SAVE_PRESS_TIME), A(SET_TIMER)), \
+	      ON(RELEASE, S(1FGTAP_TAPPED), \
+		 AN(RELEASE, n_), AN(PRESS, 1), \
+		 A(SAVE_RELEASE_TIME), A(SET_TIMER)), \
+	      ON(MOTION, S(n_##FGTAP_DRAGGING)), \
+	      ON(TIMEOUT, S(n_##FGTAP_DRAGGING)), \
+	      ON(BUTTON, S(DEAD), AN(RELEASE, n_)), \
+	      ON(THUMB, STAY), \
+	      ON(PALM, S(n_##FGTAP_TAPPED)), \
+	      ON(PALM_UP, STAY))
+
+#define DRAGGING(n_) \
+	STATE(n_##FGTAP_DRAGGING, \
+	      ON(TOUCH, S(n_##FGTAP_DRAGGING_2)), \
+	      ON_IF(RELEASE, DRAG_LOCK, \
+		    STEP(S(IDLE), AN(RELEASE_NOW, n_)), \
+		    STEP(S(n_##FGTAP_DRAGGING_WAIT), A(SET_DRAGLOCK_TIMER))), \
+	      ON(MOTION, STAY), \
+	      ON(TIMEOUT, STAY), \
+	      ON(BUTTON, S(DEAD), AN(RELEASE_NOW, n_)), \
+	      ON(THUMB, STAY), \
+	      ON(PALM, S(IDLE), AN(RELEASE, n_)), \
+	      ON(PALM_UP, STAY))
+
+#define DRAGGING_WAIT(n_) \
+	STATE(n_##FGTAP_DRAGGING_WAIT, \
+	      ON(TOUCH, S(n_##FGTAP_DRAGGING_OR_TAP), A(SET_TIMER)), \
+	      ON(RELEASE, STAY, A(BUG)), \
+	      ON(MOTION, STAY, A(BUG)), \
+	      ON(TIMEOUT, S(IDLE), AN(RELEASE_NOW, n_)), \
+	      ON(BUTTON, S(DEAD), AN(RELEASE_NOW, n_)), \
+	      ON(THUMB, STAY, A(BUG)), \
+	      ON(PALM, STAY, A(BUG)), \
+	      ON(PALM_UP, STAY))
+
+#define DRAGGING_OR_TAP(n_) \
+	STATE(n_##FGTAP_DRAGGING_OR_TAP, \
+	      ON(TOUCH, S(DEAD), AN(RELEASE_NOW, n_), A(TOUCH_DEAD)), \
+	      ON(RELEASE, S(IDLE), AN(RELEASE_NOW, n_)), \
+	      ON(MOTION, S(n_##FGTAP_DRAGGING)), \
+	      ON(TIMEOUT, S(n_##FGTAP_DRAGGING)), \
+	      ON(BUTTON, S(DEAD), AN(RELEASE_NOW, n_)), \
+	      ON(THUMB, STAY), \
+	      ON(PALM, S(n_##FGTAP_DRAGGING_WAIT)), \
+	      ON(PALM_UP, STAY))
+
+#define DRAGGING_2(n_) \
+	STATE(n_##FGTAP_DRAGGING_2, \
+	      ON(TOUCH, S(DEAD), AN(RELEASE_NOW, n_)), \
+	      ON(RELEASE, S(n_##FGTAP_DRAGGING)), \
+	      ON(MOTION, STAY), \
+	      ON(TIMEOUT, STAY), \
+	      ON(BUTTON, S(DEAD), AN(RELEASE_NOW, n_)), \
+	      ON(THUMB, STAY), \
+	      ON(PALM, S(n_##FGTAP_DRAGGING)), \
+	      ON(PALM_UP, STAY))
+
+/* Timers are cleared whenever we end up in IDLE or DEAD, see
+ * tp_tap_handle_event(), a transition into those states does not need
+ * to clear it.
+ */
+/* clang-format off */
+static const struct tap_transition tap_transitions[TAP_NSTATES][TAP_NEVENTS] = {
+	STATE(IDLE,
+	      ON(TOUCH, S(TOUCH), A(SAVE_PRESS_TIME), A(SET_TIMER)),
+	      ON(RELEASE, STAY),
+	      ON(MOTION, STAY, A(BUG)),
+	      ON(TIMEOUT, STAY),
+	      ON(BUTTON, S(DEAD)),
+	      ON(THUMB, STAY, A(BUG)),
+	      ON(PALM, S(IDLE)),
+	      ON(PALM_UP, STAY)),
+	STATE(TOUCH,
+	      ON(TOUCH, S(TOUCH_2), A(SAVE_PRESS_TIME), A(SET_TIMER)),
+	      ON_IF(RELEASE, DRAG_ENABLED,
+		    STEP(S(IDLE), AN(PRESS, 1), AN(RELEASE_NOW, 1)),
+		    STEP(S(1FGTAP_TAPPED), AN(PRESS, 1),
+			 A(SAVE_RELEASE_TIME), AN(SET_DRAG_TIMER, 1))),
+	      ON(MOTION, S(DEAD), A(TOUCH_DEAD)),
+	      ON(TIMEOUT, S(HOLD), A(CLEAR_TIMER), A(GESTURE_TAP_TIMEOUT)),
+	      ON(BUTTON, S(DEAD)),
+	      ON(THUMB, S(IDLE), A(THUMB)),
+	      ON(PALM, S(IDLE)),
+	      ON(PALM_UP, STAY)),
+	STATE(HOLD,
+	      ON(TOUCH, S(TOUCH_2), A(SAVE_PRESS_TIME), A(SET_TIMER)),
+	      ON(RELEASE, S(IDLE)),
+	      ON(MOTION, S(DEAD), A(TOUCH_DEAD)),
+	      ON(TIMEOUT, STAY),
+	      ON(BUTTON, S(DEAD)),
+	      ON(THUMB, S(IDLE), A(THUMB)),
+	      ON(PALM, S(IDLE)),
+	      ON(PALM_UP, STAY)),
+	TAPPED(1),
+	TAPPED(2),
+	TAPPED(3),
+	STATE(TOUCH_2,
+	      ON(TOUCH, S(TOUCH_3), A(SAVE_PRESS_TIME), A(SET_TIMER)),
+	      ON(RELEASE, S(TOUCH_2_RELEASE), A(SAVE_RELEASE_TIME), A(SET_TIMER)),
+	      ON(MOTION, S(DEAD), A(TOUCH_DEAD)),
+	      ON(TIMEOUT, S(TOUCH_2_HOLD), A(GESTURE_TAP_TIMEOUT)),
+	      ON(BUTTON, S(DEAD)),
+	      ON(THUMB, STAY),
+	      ON(PALM, S(TOUCH)),
+	      ON(PALM_UP, STAY)),
+	STATE(TOUCH_2_HOLD,
+	      ON(TOUCH, S(TOUCH_3), A(SAVE_PRESS_TIME), A(SET_TIMER)),
+	      ON(RELEASE, S(HOLD)),
+	      ON(MOTION, S(DEAD), A(TOUCH_DEAD)),
+	      ON(TIMEOUT, STAY),
+	      ON(BUTTON, S(DEAD)),
+	      ON(THUMB, STAY),
+	      ON(PALM, S(HOLD)),
+	      ON(PALM_UP, STAY)),
+	STATE(TOUCH_2_RELEASE,
+	      ON(TOUCH, S(TOUCH_2_HOLD), A(TOUCH_DEAD), A(CLEAR_TIMER)),
+	      ON_IF(RELEASE, DRAG_ENABLED,
+		    STEP(S(IDLE), AN(PRESS, 2), AN(RELEASE, 2)),
+		    STEP(S(2FGTAP_TAPPED), AN(PRESS, 2), AN(SET_DRAG_TIMER, 2))),
+	      ON(MOTION, S(DEAD), A(TOUCH_DEAD)),
+	      ON(TIMEOUT, S(HOLD)),
+	      ON(BUTTON, S(DEAD)),
+	      ON(THUMB, STAY),
+	      /* There's only one saved press time and it's overwritten by
+	       * the last touch down. So in the case of finger down, palm
+	       * down, finger up, palm detected, we use the palm touch's
+	       * press time here instead of the finger's press time.
+	       * For a single-finger tap the timer delay is the same as for
+	       * the release of the finger that became a palm, no reset
+	       * necessary.
+	       */
+	      ON_IF(PALM, DRAG_ENABLED,
+		    STEP(S(IDLE), AN(PRESS, 1), AN(RELEASE, 1)),
+		    STEP(S(1FGTAP_TAPPED), AN(PRESS, 1))),
+	      ON(PALM_UP, STAY)),
+	STATE(TOUCH_3,
+	      ON(TOUCH, S(DEAD)),
+	      ON(RELEASE, S(TOUCH_3_RELEASE), A(SAVE_RELEASE_TIME), A(SET_TIMER)),
+	      ON(MOTION, S(DEAD), A(TOUCH_DEAD)),
+	      ON(TIMEOUT, S(TOUCH_3_HOLD), A(CLEAR_TIMER), A(GESTURE_TAP_TIMEOUT)),
+	      ON(BUTTON, S(DEAD)),
+	      ON(THUMB, STAY),
+	      ON(PALM, S(TOUCH_2)),
+	      ON(PALM_UP, STAY)),
+	STATE(TOUCH_3_HOLD,
+	      ON(TOUCH, S(DEAD)),
+	      ON(RELEASE, S(TOUCH_2_HOLD)),
+	      ON(MOTION, S(DEAD), A(TOUCH_DEAD)),
+	      ON(TIMEOUT, STAY),
+	      ON(BUTTON, S(DEAD)),
+	      ON(THUMB, STAY),
+	      ON(PALM, S(TOUCH_2_HOLD)),
+	      ON(PALM_UP, STAY)),
+	STATE(TOUCH_3_RELEASE,
+	      ON(TOUCH, S(TOUCH_3), AN(PRESS, 3), AN(RELEASE, 3),
+		 A(SAVE_PRESS_TIME), A(SET_TIMER)),
+	      ON(RELEASE, S(TOUCH_3_RELEASE_2), A(SET_TIMER)),
+	      ON(MOTION, S(DEAD), AN(PRESS, 3), AN(RELEASE, 3), A(TOUCH_DEAD)),
+	      ON(TIMEOUT, S(TOUCH_2_HOLD), AN(PRESS, 3), AN(RELEASE, 3)),
+	      ON(BUTTON, S(DEAD), AN(PRESS, 3), AN(RELEASE, 3)),
+	      ON(THUMB, STAY),
+	      ON(PALM, S(TOUCH_2_RELEASE)),
+	      ON(PALM_UP, STAY)),
+	STATE(TOUCH_3_RELEASE_2,
+	      ON(TOUCH, S(TOUCH_2), AN(PRESS, 3), AN(RELEASE, 3),
+		 A(SAVE_PRESS_TIME), A(SET_TIMER)),
+	      ON_IF(RELEASE, DRAG_ENABLED,
+		    STEP(S(IDLE), AN(PRESS, 3), AN(RELEASE, 3)),
+		    STEP(S(3FGTAP_TAPPED), AN(PRESS, 3), AN(SET_DRAG_TIMER, 3))),
+	      ON(MOTION, S(DEAD), AN(PRESS, 3), AN(RELEASE, 3), A(TOUCH_DEAD)),
+	      ON(TIMEOUT, S(HOLD), AN(PRESS, 3), AN(RELEASE, 3)),
+	      ON(BUTTON, S(DEAD), AN(PRESS, 3), AN(RELEASE, 3)),
+	      ON(THUMB, STAY),
+	      /* Resetting the timer to the appropriate delay for a
+	       * two-finger tap would be ideal, but the timestamp of the
+	       * last real finger release is lost, so the in-progress
+	       * similar delay for release of the finger which became a
+	       * palm instead will have to do */
+	      ON_IF(PALM, DRAG_ENABLED,
+		    STEP(S(IDLE), AN(PRESS, 2), AN(RELEASE, 2)),
+		    STEP(S(2FGTAP_TAPPED), AN(PRESS, 2))),
+	      ON(PALM_UP, STAY)),
+	DRAGGING_OR_DOUBLETAP(1),
+	DRAGGING_OR_DOUBLETAP(2),
+	DRAGGING_OR_DOUBLETAP(3),
+	DRAGGING_OR_TAP(1),
+	DRAGGING_OR_TAP(2),
+	DRAGGING_OR_TAP(3),
+	DRAGGING(1),
+	DRAGGING(2),
+	DRAGGING(3),
+	DRAGGING_WAIT(1),
+	DRAGGING_WAIT(2),
+	DRAGGING_WAIT(3),
+	DRAGGING_2(1),
+	DRAGGING_2(2),
+	DRAGGING_2(3),
+	STATE(DEAD,
+	      ON(TOUCH, STAY),
+	      ON_IF(RELEASE, NO_FINGERS_DOWN, STEP(STAY), STEP(S(IDLE))),
+	      ON(MOTION, STAY),
+	      ON(TIMEOUT, STAY),
+	      ON(BUTTON, STAY),
+	      ON(THUMB, STAY),
+	      ON_IF(PALM, NO_FINGERS_DOWN, STEP(STAY), STEP(S(IDLE))),
+	      ON_IF(PALM_UP, NO_FINGERS_DOWN, STEP(STAY), STEP(S(IDLE)))),
+};
+/* clang-format on */
+
+#undef S
+#undef STAY
+#undef A
+#undef AN
+#undef STEP
+#undef ON
+#undef ON_IF
+#undef STATE
+#undef TAPPED
+#undef DRAGGING_OR_DOUBLETAP
+#undef DRAGGING
+#undef DRAGGING_WAIT
+#undef DRAGGING_OR_TAP
+#undef DRAGGING_2
 
-static void
-tp_tap_touch2_hold_handle_event(struct tp_dispatch *tp,
-				struct tp_touch *t,
-				enum tap_event event,
-				usec_t time)
+static bool
+tp_tap_guard(struct tp_dispatch *tp, struct tp_touch *t, enum tap_guard guard)
 {
-
-	switch (event) {
-	case TAP_EVENT_TOUCH:
-		tp->tap.state = TAP_STATE_TOUCH_3;
-		tp->tap.saved_press_time = time;
-		tp_tap_set_timer(tp, time);
-		break;
-	case TAP_EVENT_RELEASE:
-		tp->tap.state = TAP_STATE_HOLD;
-		break;
-	case TAP_EVENT_MOTION:
-		tp_tap_move_to_dead(tp, t);
-		break;
-	case TAP_EVENT_TIMEOUT:
-		tp->tap.state = TAP_STATE_TOUCH_2_HOLD;
-		break;
-	case TAP_EVENT_BUTTON:
-		tp->tap.state = TAP_STATE_DEAD;
-		break;
-	case TAP_EVENT_THUMB:
-		break;
-	case TAP_EVENT_PALM:
-		tp->tap.state = TAP_STATE_HOLD;
-		break;
-	case TAP_EVENT_PALM_UP:
-		break;
+	switch (guard) {
+	case TAP_GUARD_NONE:
+		return false;
+	case TAP_GUARD_DRAG_ENABLED:
+		return tp->tap.drag_enabled;
+	case TAP_GUARD_DRAG_LOCK:
+		return tp->tap.drag_lock != LIBINPUT_CONFIG_DRAG_LOCK_DISABLED ||
+		       tp_touch_near_any_edge(tp, t);
+	case TAP_GUARD_NO_FINGERS_DOWN:
+		return tp->tap.nfingers_down == 0;
 	}
-}
 
-static void
-tp_tap_touch2_release_handle_event(struct tp_dispatch *tp,
-				   struct tp_touch *t,
-				   enum tap_event event,
-				   usec_t time)
-{
-
-	switch (event) {
-	case TAP_EVENT_TOUCH:
-		tp->tap.state = TAP_STATE_TOUCH_2_HOLD;
-		t->tap.state = TAP_TOUCH_STATE_DEAD;
-		tp_tap_clear_timer(tp);
-		break;
-	case TAP_EVENT_RELEASE:
-		tp_tap_notify(tp,
-			      tp->tap.saved_press_time,
-			      2,
-			      LIBINPUT_BUTTON_STATE_PRESSED);
-		if (tp->tap.drag_enabled) {
-			tp->tap.state = TAP_STATE_2FGTAP_TAPPED;
-			tp_tap_set_drag_timer(tp, time, 2);
-		} else {
-			tp_tap_notify(tp,
-				      tp->tap.saved_release_time,
-				      2,
-				      LIBINPUT_BUTTON_STATE_RELEASED);
-			tp->tap.state = TAP_STATE_IDLE;
-		}
-		break;
-	case TAP_EVENT_MOTION:
-		tp_tap_move_to_dead(tp, t);
-		break;
-	case TAP_EVENT_TIMEOUT:
-		tp->tap.state = TAP_STATE_HOLD;
-		break;
-	case TAP_EVENT_BUTTON:
-		tp->tap.state = TAP_STATE_DEAD;
-		break;
-	case TAP_EVENT_THUMB:
-		break;
-	case TAP_EVENT_PALM:
-		/* There's only one saved press time and it's overwritten by
-		 * the last touch down. So in the case of finger down, palm
-		 * down, finger up, palm detected, we use the
-		 * palm touch's press time here instead of the finger's press
-		 * time. Let's wait and see if that's an issue.
-		 */
-		tp_tap_notify(tp,
-			      tp->tap.saved_press_time,
-			      1,
-			      LIBINPUT_BUTTON_STATE_PRESSED);
-		if (tp->tap.drag_enabled) {
-			/* For a single-finger tap the timer delay is the same
-			 * as for the release of the finger that became a palm,
-			 * no reset necessary */
-			tp->tap.state = TAP_STATE_1FGTAP_TAPPED;
-		} else {
-			tp_tap_notify(tp,
-				      tp->tap.saved_release_time,
-				      1,
-				      LIBINPUT_BUTTON_STATE_RELEASED);
-			tp->tap.state = TAP_STATE_IDLE;
-		}
-		break;
-	case TAP_EVENT_PALM_UP:
-		break;
-	}
+	abort();
 }
 
 static void
-tp_tap_touch3_handle_event(struct tp_dispatch *tp,
-			   struct tp_touch *t,
-			   enum tap_event event,
-			   usec_t time)
+tp_tap_run_action(struct tp_dispatch *tp,
+		  struct tp_touch *t,
+		  enum tap_event event,
+		  const struct tap_action *action,
+		  usec_t time)
 {
-
-	switch (event) {
-	case TAP_EVENT_TOUCH:
-		tp->tap.state = TAP_STATE_DEAD;
-		tp_tap_clear_timer(tp);
+	switch ((enum tap_action_type)action->type) {
+	case TAP_ACTION_NONE:
 		break;
-	case TAP_EVENT_MOTION:
-		tp_tap_move_to_dead(tp, t);
+	case TAP_ACTION_BUG:
+		log_tap_bug(tp, t, event);
 		break;
-	case TAP_EVENT_TIMEOUT:
-		tp->tap.state = TAP_STATE_TOUCH_3_HOLD;
-		tp_tap_clear_timer(tp);
-		tp_gesture_tap_timeout(tp, time);
+	case TAP_ACTION_SAVE_PRESS_TIME:
+		tp->tap.saved_press_time = time;
 		break;
-	case TAP_EVENT_RELEASE:
-		tp->tap.state = TAP_STATE_TOUCH_3_RELEASE;
+	case TAP_ACTION_SAVE_RELEASE_TIME:
 		tp->tap.saved_release_time = time;
-		tp_tap_set_timer(tp, time);
-		break;
-	case TAP_EVENT_BUTTON:
-		tp->tap.state = TAP_STATE_DEAD;
-		break;
-	case TAP_EVENT_THUMB:
 		break;
-	case TAP_EVENT_PALM:
-		tp->tap.state = TAP_STATE_TOUCH_2;
-		break;
-	case TAP_EVENT_PALM_UP:
-		break;
-	}
-}
-
-static void
-tp_tap_touch3_hold_handle_event(struct tp_dispatch *tp,
-				struct tp_touch *t,
-				enum tap_event event,
-				usec_t time)
-{
-
-	switch (event) {
-	case TAP_EVENT_TOUCH:
-		tp->tap.state = TAP_STATE_DEAD;
+	case TAP_ACTION_SET_TIMER:
 		tp_tap_set_timer(tp, time);
 		break;
-	case TAP_EVENT_RELEASE:
-		tp->tap.state = TAP_STATE_TOUCH_2_HOLD;
-		break;
-	case TAP_EVENT_MOTION:
-		tp_tap_move_to_dead(tp, t);
-		break;
-	case TAP_EVENT_TIMEOUT:
-		break;
-	case TAP_EVENT_BUTTON:
-		tp->tap.state = TAP_STATE_DEAD;
-		break;
-	case TAP_EVENT_THUMB:
-		break;
-	case TAP_EVENT_PALM:
-		tp->tap.state = TAP_STATE_TOUCH_2_HOLD;
-		break;
-	case TAP_EVENT_PALM_UP:
-		break;
-	}
-}
-
-static void
-tp_tap_touch3_release_handle_event(struct tp_dispatch *tp,
-				   struct tp_touch *t,
-				   enum tap_event event,
-				   usec_t time)
-{
-
-	switch (event) {
-	case TAP_EVENT_TOUCH:
-		tp_tap_notify(tp,
-			      tp->tap.saved_press_time,
-			      3,
-			      LIBINPUT_BUTTON_STATE_PRESSED);
-		tp_tap_notify(tp,
-			      tp->tap.saved_release_time,
-			      3,
-			      LIBINPUT_BUTTON_STATE_RELEASED);
-		tp->tap.state = TAP_STATE_TOUCH_3;
-		tp->tap.saved_press_time = time;
-		tp_tap_set_timer(tp, time);
+	case TAP_ACTION_SET_DRAG_TIMER:
+		tp_tap_set_drag_timer(tp, time, action->nfingers);
 		break;
-	case TAP_EVENT_RELEASE:
-		tp->tap.state = TAP_STATE_TOUCH_3_RELEASE_2;
-		tp_tap_set_timer(tp, time);
+	case TAP_ACTION_SET_DRAGLOCK_TIMER:
+		if (tp->tap.drag_lock != LIBINPUT_CONFIG_DRAG_LOCK_ENABLED_STICKY)
+			tp_tap_set_draglock_timer(tp, time);
 		break;
-	case TAP_EVENT_MOTION:
-		tp_tap_notify(tp,
-			      tp->tap.saved_press_time,
-			      3,
-			      LIBINPUT_BUTTON_STATE_PRESSED);
-		tp_tap_notify(tp,
-			      tp->tap.saved_release_time,
-			      3,
-			      LIBINPUT_BUTTON_STATE_RELEASED);
-		tp_tap_move_to_dead(tp, t);
-		break;
-	case TAP_EVENT_TIMEOUT:
-		tp_tap_notify(tp,
-			      tp->tap.saved_press_time,
-			      3,
-			      LIBINPUT_BUTTON_STATE_PRESSED);
-		tp_tap_notify(tp,
-			      tp->tap.saved_release_time,
-			      3,
-			      LIBINPUT_BUTTON_STATE_RELEASED);
-		tp->tap.state = TAP_STATE_TOUCH_2_HOLD;
-		break;
-	case TAP_EVENT_BUTTON:
-		tp_tap_notify(tp,
-			      tp->tap.saved_press_time,
-			      3,
-			      LIBINPUT_BUTTON_STATE_PRESSED);
-		tp_tap_notify(tp,
-			      tp->tap.saved_release_time,
-			      3,
-			      LIBINPUT_BUTTON_STATE_RELEASED);
-		tp->tap.state = TAP_STATE_DEAD;
-		break;
-	case TAP_EVENT_THUMB:
-		break;
-	case TAP_EVENT_PALM:
-		tp->tap.state = TAP_STATE_TOUCH_2_RELEASE;
-		break;
-	case TAP_EVENT_PALM_UP:
-		break;
-	}
-}
-
-static void
-tp_tap_touch3_release2_handle_event(struct tp_dispatch *tp,
-				    struct tp_touch *t,
-				    enum tap_event event,
-				    usec_t time)
-{
-
-	switch (event) {
-	case TAP_EVENT_TOUCH:
-		tp_tap_notify(tp,
-			      tp->tap.saved_press_time,
-			      3,
-			      LIBINPUT_BUTTON_STATE_PRESSED);
-		tp_tap_notify(tp,
-			      tp->tap.saved_release_time,
-			      3,
-			      LIBINPUT_BUTTON_STATE_RELEASED);
-		tp->tap.state = TAP_STATE_TOUCH_2;
-		tp->tap.saved_press_time = time;
-		tp_tap_set_timer(tp, time);
-		break;
-	case TAP_EVENT_RELEASE:
-		tp_tap_notify(tp,
-			      tp->tap.saved_press_time,
-			      3,
-			      LIBINPUT_BUTTON_STATE_PRESSED);
-		if (tp->tap.drag_enabled) {
-			tp->tap.state = TAP_STATE_3FGTAP_TAPPED;
-			tp_tap_set_drag_timer(tp, time, 3);
-		} else {
-			tp_tap_notify(tp,
-				      tp->tap.saved_release_time,
-				      3,
-				      LIBINPUT_BUTTON_STATE_RELEASED);
-			tp->tap.state = TAP_STATE_IDLE;
-		}
-		break;
-	case TAP_EVENT_MOTION:
-		tp_tap_notify(tp,
-			      tp->tap.saved_press_time,
-			      3,
-			      LIBINPUT_BUTTON_STATE_PRESSED);
-		tp_tap_notify(tp,
-			      tp->tap.saved_release_time,
-			      3,
-			      LIBINPUT_BUTTON_STATE_RELEASED);
-		tp_tap_move_to_dead(tp, t);
-		break;
-	case TAP_EVENT_TIMEOUT:
-		tp_tap_notify(tp,
-			      tp->tap.saved_press_time,
-			      3,
-			      LIBINPUT_BUTTON_STATE_PRESSED);
-		tp_tap_notify(tp,
-			      tp->tap.saved_release_time,
-			      3,
-			      LIBINPUT_BUTTON_STATE_RELEASED);
-		tp->tap.state = TAP_STATE_HOLD;
-		break;
-	case TAP_EVENT_BUTTON:
-		tp_tap_notify(tp,
-			      tp->tap.saved_press_time,
-			      3,
-			      LIBINPUT_BUTTON_STATE_PRESSED);
-		tp_tap_notify(tp,
-			      tp->tap.saved_release_time,
-			      3,
-			      LIBINPUT_BUTTON_STATE_RELEASED);
-		tp->tap.state = TAP_STATE_DEAD;
-		break;
-	case TAP_EVENT_THUMB:
+	case TAP_ACTION_CLEAR_TIMER:
+		tp_tap_clear_timer(tp);
 		break;
-	case TAP_EVENT_PALM:
+	case TAP_ACTION_PRESS:
 		tp_tap_notify(tp,
 			      tp->tap.saved_press_time,
-			      2,
+			      action->nfingers,
 			      LIBINPUT_BUTTON_STATE_PRESSED);
-		if (tp->tap.drag_enabled) {
-			/* Resetting the timer to the appropriate delay
-			 * for a two-finger tap would be ideal, but the
-			 * timestamp of the last real finger release is lost,
-			 * so the in-progress similar delay for release
-			 * of the finger which became a palm instead
-			 * will have to do */
-			tp->tap.state = TAP_STATE_2FGTAP_TAPPED;
-		} else {
-			tp_tap_notify(tp,
-				      tp->tap.saved_release_time,
-				      2,
-				      LIBINPUT_BUTTON_STATE_RELEASED);
-			tp->tap.state = TAP_STATE_IDLE;
-		}
-		break;
-	case TAP_EVENT_PALM_UP:
-		break;
-	}
-}
-
-static void
-tp_tap_dragging_or_doubletap_handle_event(struct tp_dispatch *tp,
-					  struct tp_touch *t,
-					  enum tap_event event,
-					  usec_t time,
-					  int nfingers_tapped)
-{
-	switch (event) {
-	case TAP_EVENT_TOUCH: {
-		tp_tap_notify(tp,
-			      tp->tap.saved_release_time,
-			      nfingers_tapped,
-			      LIBINPUT_BUTTON_STATE_RELEASED);
-		tp->tap.state = TAP_STATE_TOUCH_2;
-		tp->tap.saved_press_time = time;
-		tp_tap_set_timer(tp, time);
 		break;
-	}
-	case TAP_EVENT_RELEASE:
-		tp->tap.state = TAP_STATE_1FGTAP_TAPPED;
+	case TAP_ACTION_RELEASE:
 		tp_tap_notify(tp,
 			      tp->tap.saved_release_time,
-			      nfingers_tapped,
+			      action->nfingers,
 			      LIBINPUT_BUTTON_STATE_RELEASED);
-		tp_tap_notify(tp,
-			      tp->tap.saved_press_time,
-			      1,
-			      LIBINPUT_BUTTON_STATE_PRESSED);
-		tp->tap.saved_release_time = time;
-		tp_tap_set_timer(tp, time);
 		break;
-	case TAP_EVENT_MOTION:
-	case TAP_EVENT_TIMEOUT: {
-		enum tp_tap_state dest[3] = {
-			TAP_STATE_1FGTAP_DRAGGING,
-			TAP_STATE_2FGTAP_DRAGGING,
-			TAP_STATE_3FGTAP_DRAGGING,
-		};
-		assert(nfingers_tapped >= 1 && nfingers_tapped <= 3);
-		tp->tap.state = dest[nfingers_tapped - 1];
-		break;
-	}
-	case TAP_EVENT_BUTTON:
-		tp->tap.state = TAP_STATE_DEAD;
-		tp_tap_notify(tp,
-			      tp->tap.saved_release_time,
-			      nfingers_tapped,
-			      LIBINPUT_BUTTON_STATE_RELEASED);
-		break;
-	case TAP_EVENT_THUMB:
-		break;
-	case TAP_EVENT_PALM: {
-		enum tp_tap_state dest[3] = {
-			TAP_STATE_1FGTAP_TAPPED,
-			TAP_STATE_2FGTAP_TAPPED,
-			TAP_STATE_3FGTAP_TAPPED,
-		};
-		assert(nfingers_tapped >= 1 && nfingers_tapped <= 3);
-		tp->tap.state = dest[nfingers_tapped - 1];
-		break;
-	}
-	case TAP_EVENT_PALM_UP:
-		break;
-	}
-}
-
-static void
-tp_tap_dragging_handle_event(struct tp_dispatch *tp,
-			     struct tp_touch *t,
-			     enum tap_event event,
-			     usec_t time,
-			     int nfingers_tapped)
-{
-	bool at_edge = false;
-
-	switch (event) {
-	case TAP_EVENT_TOUCH: {
-		enum tp_tap_state dest[3] = {
-			TAP_STATE_1FGTAP_DRAGGING_2,
-			TAP_STATE_2FGTAP_DRAGGING_2,
-			TAP_STATE_3FGTAP_DRAGGING_2,
-		};
-		assert(nfingers_tapped >= 1 && nfingers_tapped <= 3);
-		tp->tap.state = dest[nfingers_tapped - 1];
-		break;
-	}
-	case TAP_EVENT_RELEASE:
-		if (tp->tap.drag_lock != LIBINPUT_CONFIG_DRAG_LOCK_DISABLED ||
-		    (at_edge = tp_touch_near_any_edge(tp, t))) {
-			enum tp_tap_state dest[3] = {
-				TAP_STATE_1FGTAP_DRAGGING_WAIT,
-				TAP_STATE_2FGTAP_DRAGGING_WAIT,
-				TAP_STATE_3FGTAP_DRAGGING_WAIT,
-			};
-			assert(nfingers_tapped >= 1 && nfingers_tapped <= 3);
-			tp->tap.state = dest[nfingers_tapped - 1];
-			if (at_edge ||
-			    tp->tap.drag_lock ==
-				    LIBINPUT_CONFIG_DRAG_LOCK_ENABLED_TIMEOUT)
-				tp_tap_set_draglock_timer(tp, time);
-		} else {
-			tp_tap_notify(tp,
-				      time,
-				      nfingers_tapped,
-				      LIBINPUT_BUTTON_STATE_RELEASED);
-			tp->tap.state = TAP_STATE_IDLE;
-		}
-		break;
-	case TAP_EVENT_MOTION:
-	case TAP_EVENT_TIMEOUT:
-		/* noop */
-		break;
-	case TAP_EVENT_BUTTON:
-		tp->tap.state = TAP_STATE_DEAD;
+	case TAP_ACTION_RELEASE_NOW:
 		tp_tap_notify(tp,
 			      time,
-			      nfingers_tapped,
+			      action->nfingers,
 			      LIBINPUT_BUTTON_STATE_RELEASED);
 		break;
-	case TAP_EVENT_THUMB:
-		break;
-	case TAP_EVENT_PALM:
-		tp_tap_notify(tp,
-			      tp->tap.saved_release_time,
-			      nfingers_tapped,
-			      LIBINPUT_BUTTON_STATE_RELEASED);
-		tp->tap.state = TAP_STATE_IDLE;
-		break;
-	case TAP_EVENT_PALM_UP:
-		break;
-	}
-}
-
-static void
-tp_tap_dragging_wait_handle_event(struct tp_dispatch *tp,
-				  struct tp_touch *t,
-				  enum tap_event event,
-				  usec_t time,
-				  int nfingers_tapped)
-{
-
-	switch (event) {
-	case TAP_EVENT_TOUCH: {
-		enum tp_tap_state dest[3] = {
-			TAP_STATE_1FGTAP_DRAGGING_OR_TAP,
-			TAP_STATE_2FGTAP_DRAGGING_OR_TAP,
-			TAP_STATE_3FGTAP_DRAGGING_OR_TAP,
-		};
-		assert(nfingers_tapped >= 1 && nfingers_tapped <= 3);
-		tp->tap.state = dest[nfingers_tapped - 1];
-		tp_tap_set_timer(tp, time);
-		break;
-	}
-	case TAP_EVENT_RELEASE:
-	case TAP_EVENT_MOTION:
-		log_tap_bug(tp, t, event);
-		break;
-	case TAP_EVENT_TIMEOUT:
-		tp->tap.state = TAP_STATE_IDLE;
-		tp_tap_notify(tp,
-			      time,
-			      nfingers_tapped,
-			      LIBINPUT_BUTTON_STATE_RELEASED);
-		break;
-	case TAP_EVENT_BUTTON:
-		tp->tap.state = TAP_STATE_DEAD;
-		tp_tap_notify(tp,
-			      time,
-			      nfingers_tapped,
-			      LIBINPUT_BUTTON_STATE_RELEASED);
-		break;
-	case TAP_EVENT_THUMB:
-	case TAP_EVENT_PALM:
-		log_tap_bug(tp, t, event);
-		break;
-	case TAP_EVENT_PALM_UP:
-		break;
-	}
-}
-
-static void
-tp_tap_dragging_tap_handle_event(struct tp_dispatch *tp,
-				 struct tp_touch *t,
-				 enum tap_event event,
-				 usec_t time,
-				 int nfingers_tapped)
-{
-
-	switch (event) {
-	case TAP_EVENT_TOUCH: {
-		tp_tap_notify(tp,
-			      time,
-			      nfingers_tapped,
-			      LIBINPUT_BUTTON_STATE_RELEASED);
-		tp_tap_clear_timer(tp);
-		tp_tap_move_to_dead(tp, t);
-		break;
-	}
-	case TAP_EVENT_RELEASE:
-		tp->tap.state = TAP_STATE_IDLE;
-		tp_tap_notify(tp,
-			      time,
-			      nfingers_tapped,
-			      LIBINPUT_BUTTON_STATE_RELEASED);
-		break;
-	case TAP_EVENT_MOTION:
-	case TAP_EVENT_TIMEOUT: {
-		enum tp_tap_state dest[3] = {
-			TAP_STATE_1FGTAP_DRAGGING,
-			TAP_STATE_2FGTAP_DRAGGING,
-			TAP_STATE_3FGTAP_DRAGGING,
-		};
-		assert(nfingers_tapped >= 1 && nfingers_tapped <= 3);
-		tp->tap.state = dest[nfingers_tapped - 1];
-		break;
-	}
-	case TAP_EVENT_BUTTON:
-		tp->tap.state = TAP_STATE_DEAD;
-		tp_tap_notify(tp,
-			      time,
-			      nfingers_tapped,
-			      LIBINPUT_BUTTON_STATE_RELEASED);
-		break;
-	case TAP_EVENT_THUMB:
-		break;
-	case TAP_EVENT_PALM: {
-		enum tp_tap_state dest[3] = {
-			TAP_STATE_1FGTAP_DRAGGING_WAIT,
-			TAP_STATE_2FGTAP_DRAGGING_WAIT,
-			TAP_STATE_3FGTAP_DRAGGING_WAIT,
-		};
-		assert(nfingers_tapped >= 1 && nfingers_tapped <= 3);
-		tp->tap.state = dest[nfingers_tapped - 1];
-		break;
-	}
-	case TAP_EVENT_PALM_UP:
-		break;
-	}
-}
-
-static void
-tp_tap_dragging2_handle_event(struct tp_dispatch *tp,
-			      struct tp_touch *t,
-			      enum tap_event event,
-			      usec_t time,
-			      int nfingers_tapped)
-{
-
-	switch (event) {
-	case TAP_EVENT_RELEASE: {
-		enum tp_tap_state dest[3] = {
-			TAP_STATE_1FGTAP_DRAGGING,
-			TAP_STATE_2FGTAP_DRAGGING,
-			TAP_STATE_3FGTAP_DRAGGING,
-		};
-		assert(nfingers_tapped >= 1 && nfingers_tapped <= 3);
-		tp->tap.state = dest[nfingers_tapped - 1];
-		break;
-	}
-	case TAP_EVENT_TOUCH:
-		tp->tap.state = TAP_STATE_DEAD;
-		tp_tap_notify(tp,
-			      time,
-			      nfingers_tapped,
-			      LIBINPUT_BUTTON_STATE_RELEASED);
-		break;
-	case TAP_EVENT_MOTION:
-	case TAP_EVENT_TIMEOUT:
-		/* noop */
-		break;
-	case TAP_EVENT_BUTTON:
-		tp->tap.state = TAP_STATE_DEAD;
-		tp_tap_notify(tp,
-			      time,
-			      nfingers_tapped,
-			      LIBINPUT_BUTTON_STATE_RELEASED);
-		break;
-	case TAP_EVENT_THUMB:
-		break;
-	case TAP_EVENT_PALM: {
-		enum tp_tap_state dest[3] = {
-			TAP_STATE_1FGTAP_DRAGGING,
-			TAP_STATE_2FGTAP_DRAGGING,
-			TAP_STATE_3FGTAP_DRAGGING,
-		};
-		assert(nfingers_tapped >= 1 && nfingers_tapped <= 3);
-		tp->tap.state = dest[nfingers_tapped - 1];
-		break;
-	}
-	case TAP_EVENT_PALM_UP:
-		break;
-	}
-}
-
-static void
-tp_tap_dead_handle_event(struct tp_dispatch *tp,
-			 struct tp_touch *t,
-			 enum tap_event event,
-			 usec_t time)
-{
-
-	switch (event) {
-	case TAP_EVENT_RELEASE:
-		if (tp->tap.nfingers_down == 0)
-			tp->tap.state = TAP_STATE_IDLE;
-		break;
-	case TAP_EVENT_TOUCH:
-	case TAP_EVENT_MOTION:
-	case TAP_EVENT_TIMEOUT:
-	case TAP_EVENT_BUTTON:
+	case TAP_ACTION_TOUCH_DEAD:
+		t->tap.state = TAP_TOUCH_STATE_DEAD;
 		break;
-	case TAP_EVENT_THUMB:
+	case TAP_ACTION_THUMB:
+		t->tap.is_thumb = true;
+		tp->tap.nfingers_down--;
+		t->tap.state = TAP_TOUCH_STATE_DEAD;
 		break;
-	case TAP_EVENT_PALM:
-	case TAP_EVENT_PALM_UP:
-		if (tp->tap.nfingers_down == 0)
-			tp->tap.state = TAP_STATE_IDLE;
+	case TAP_ACTION_GESTURE_TAP_TIMEOUT:
+		tp_gesture_tap_timeout(tp, time);
 		break;
 	}
 }
@@ -1073,98 +575,22 @@ tp_tap_handle_event(struct tp_dispatch *tp,
 		    enum tap_event event,
 		    usec_t time)
 {
+	const struct tap_transition *transition;
+	const struct tap_step *step;
 	enum tp_tap_state current;
 
 	current = tp->tap.state;
 
-	switch (tp->tap.state) {
-	case TAP_STATE_IDLE:
-		tp_tap_idle_handle_event(tp, t, event, time);
-		break;
-	case TAP_STATE_TOUCH:
-		tp_tap_touch_handle_event(tp, t, event, time);
-		break;
-	case TAP_STATE_HOLD:
-		tp_tap_hold_handle_event(tp, t, event, time);
-		break;
-	case TAP_STATE_1FGTAP_TAPPED:
-		tp_tap_tapped_handle_event(tp, t, event, time, 1);
-		break;
-	case TAP_STATE_2FGTAP_TAPPED:
-		tp_tap_tapped_handle_event(tp, t, event, time, 2);
-		break;
-	case TAP_STATE_3FGTAP_TAPPED:
-		tp_tap_tapped_handle_event(tp, t, event, time, 3);
-		break;
-	case TAP_STATE_TOUCH_2:
-		tp_tap_touch2_handle_event(tp, t, event, time);
-		break;
-	case TAP_STATE_TOUCH_2_HOLD:
-		tp_tap_touch2_hold_handle_event(tp, t, event, time);
-		break;
-	case TAP_STATE_TOUCH_2_RELEASE:
-		tp_tap_touch2_release_handle_event(tp, t, event, time);
-		break;
-	case TAP_STATE_TOUCH_3:
-		tp_tap_touch3_handle_event(tp, t, event, time);
-		break;
-	case TAP_STATE_TOUCH_3_HOLD:
-		tp_tap_touch3_hold_handle_event(tp, t, event, time);
-		break;
-	case TAP_STATE_TOUCH_3_RELEASE:
-		tp_tap_touch3_release_handle_event(tp, t, event, time);
-		break;
-	case TAP_STATE_TOUCH_3_RELEASE_2:
-		tp_tap_touch3_release2_handle_event(tp, t, event, time);
-		break;
-	case TAP_STATE_1FGTAP_DRAGGING_OR_DOUBLETAP:
-		tp_tap_dragging_or_doubletap_handle_event(tp, t, event, time, 1);
-		break;
-	case TAP_STATE_2FGTAP_DRAGGING_OR_DOUBLETAP:
-		tp_tap_dragging_or_doubletap_handle_event(tp, t, event, time, 2);
-		break;
-	case TAP_STATE_3FGTAP_DRAGGING_OR_DOUBLETAP:
-		tp_tap_dragging_or_doubletap_handle_event(tp, t, event, time, 3);
-		break;
-	case TAP_STATE_1FGTAP_DRAGGING:
-		tp_tap_dragging_handle_event(tp, t, event, time, 1);
-		break;
-	case TAP_STATE_2FGTAP_DRAGGING:
-		tp_tap_dragging_handle_event(tp, t, event, time, 2);
-		break;
-	case TAP_STATE_3FGTAP_DRAGGING:
-		tp_tap_dragging_handle_event(tp, t, event, time, 3);
-		break;
-	case TAP_STATE_1FGTAP_DRAGGING_WAIT:
-		tp_tap_dragging_wait_handle_event(tp, t, event, time, 1);
-		break;
-	case TAP_STATE_2FGTAP_DRAGGING_WAIT:
-		tp_tap_dragging_wait_handle_event(tp, t, event, time, 2);
-		break;
-	case TAP_STATE_3FGTAP_DRAGGING_WAIT:
-		tp_tap_dragging_wait_handle_event(tp, t, event, time, 3);
-		break;
-	case TAP_STATE_1FGTAP_DRAGGING_OR_TAP:
-		tp_tap_dragging_tap_handle_event(tp, t, event, time, 1);
-		break;
-	case TAP_STATE_2FGTAP_DRAGGING_OR_TAP:
-		tp_tap_dragging_tap_handle_event(tp, t, event, time, 2);
-		break;
-	case TAP_STATE_3FGTAP_DRAGGING_OR_TAP:
-		tp_tap_dragging_tap_handle_event(tp, t, event, time, 3);
-		break;
-	case TAP_STATE_1FGTAP_DRAGGING_2:
-		tp_tap_dragging2_handle_event(tp, t, event, time, 1);
-		break;
-	case TAP_STATE_2FGTAP_DRAGGING_2:
-		tp_tap_dragging2_handle_event(tp, t, event, time, 2);
-		break;
-	case TAP_STATE_3FGTAP_DRAGGING_2:
-		tp_tap_dragging2_handle_event(tp, t, event, time, 3);
-		break;
-	case TAP_STATE_DEAD:
-		tp_tap_dead_handle_event(tp, t, event, time);
-		break;
+	transition = &tap_transitions[current - TAP_STATE_IDLE][event - TAP_EVENT_TOUCH];
+	step = &transition->step[tp_tap_guard(tp, t, transition->guard)];
+
+	if (step->next != TAP_STATE_UNCHANGED)
+		tp->tap.state = step->next;
+
+	ARRAY_FOR_EACH(step->actions, action) {
+		if (action->type == TAP_ACTION_NONE)
+			break;
+		tp_tap_run_action(tp, t, event, action, time);
 	}
 
 	if (tp->tap.state == TAP_STATE_IDLE || tp->tap.state == TAP_STATE_DEAD)
@@ -1180,6 +606,27 @@ tp_tap_handle_event(struct tp_dispatch *tp,
 				tap_state_to_str(tp->tap.state));
 }
 
+/**
+ * Every (state, event) pair must have an entry in the table, a missing
+ * entry has a zero next state.
+ */
+static bool
+tp_tap_transitions_complete(void)
+{
+	for (size_t s = 0; s < TAP_NSTATES; s++) {
+		for (size_t e = 0; e < TAP_NEVENTS; e++) {
+			const struct tap_transition *tr = &tap_transitions[s][e];
+
+			if (tr->step[0].next == 0)
+				return false;
+			if (tr->guard != TAP_GUARD_NONE && tr->step[1].next == 0)
+				return false;
+		}
+	}
+
+	return true;
+}
+
 static bool
 tp_tap_exceeds_motion_threshold(struct tp_dispatch *tp, struct tp_touch *t)
 {
@@ -1231,8 +678,8 @@ tp_tap_handle_state(struct tp_dispatch *tp, usec_t time)
 	if (tp->buttons.is_clickpad && tp->queued & TOUCHPAD_EVENT_BUTTON_PRESS)
 		tp_tap_handle_event(tp, NULL, TAP_EVENT_BUTTON, time);
 
-	tp_for_each_touch(tp, t) {
-		if (!t->dirty || t->state == TOUCH_NONE)
+	tp_for_each_dirty_touch(tp, t) {
+		if (t->state == TOUCH_NONE)
 			continue;
 
 		if (tp->buttons.is_clickpad && tp->queued & TOUCHPAD_EVENT_BUTTON_PRESS)
@@ -1359,8 +806,8 @@ tp_tap_handle_timeout(usec_t time, void *data)
 
 	tp_tap_handle_event(tp, NULL, TAP_EVENT_TIMEOUT, time);
 
-	tp_for_each_touch(tp, t) {
-		if (t->state == TOUCH_NONE || t->tap.state == TAP_TOUCH_STATE_IDLE)
+	tp_for_each_active_touch(tp, t) {
+		if (t->tap.state == TAP_TOUCH_STATE_IDLE)
 			continue;
 
 		t->tap.state = TAP_TOUCH_STATE_DEAD;
@@ -1382,10 +829,7 @@ tp_tap_enabled_update(struct tp_dispatch *tp, bool suspended, bool enabled, usec
 		struct tp_touch *t;
 
 		/* On resume, all touches are considered palms */
-		tp_for_each_touch(tp, t) {
-			if (t->state == TOUCH_NONE)
-				continue;
-
+		tp_for_each_active_touch(tp, t) {
 			t->tap.is_palm = true;
 			t->tap.state = TAP_TOUCH_STATE_DEAD;
 		}
@@ -1582,6 +1026,10 @@ tp_init_tap(struct tp_dispatch *tp)
 		tp_tap_config_get_default_draglock_enabled;
 	tp->device->base.config.tap = &tp->tap.config;
 
+	if (!tp_tap_transitions_complete())
+		evdev_log_bug_libinput(tp->device,
+				       "tap state machine is missing transitions\n");
+
 	tp->tap.state = TAP_STATE_IDLE;
 	tp->tap.enabled = tp_tap_default(tp->device);
 	tp->tap.map = LIBINPUT_CONFIG_TAP_MAP_LRM;
@@ -1632,10 +1080,7 @@ tp_release_all_taps(struct tp_dispatch *tp, usec_t now)
 	}
 
 	/* To neutralize all current touches, we make them all palms */
-	tp_for_each_touch(tp, t) {
-		if (t->state == TOUCH_NONE)
-			continue;
-
+	tp_for_each_active_touch(tp, t) {
 		if (t->tap.is_palm)
 			continue;
 
@@ -30,6 +30,8 @@
 #define SCROLL_MM_X 35
 #define SCROLL_MM_Y 25
 #define THUMB_TIMEOUT usec_from_millis(100)
+/* max distance from where a thumb landed while it is being put down */
+#define THUMB_LANDING_TRAVEL_MM 1.0
 
 static inline const char *
 thumb_state_to_str(enum tp_thumb_state state)
@@ -95,7 +97,7 @@ tp_thumb_detect_pressure_size(const struct tp_dispatch *tp, const struct tp_touc
 	bool is_thumb = false;
 
 	if (tp->thumb.use_pressure && t->pressure > tp->thumb.pressure_threshold &&
-	    tp_thumb_in_exclusion_area(tp, t)) {
+	    t->thumb.in_exclusion_area) {
 		is_thumb = true;
 	}
 
@@ -107,22 +109,47 @@ tp_thumb_detect_pressure_size(const struct tp_dispatch *tp, const struct tp_touc
 	return is_thumb;
 }
 
-static bool
-tp_thumb_needs_jail(const struct tp_dispatch *tp, const struct tp_touch *t)
+/**
+ * Classify the touch from its current position, pressure, size and
+ * speed. Everything else reads the cached result.
+ */
+static void
+tp_thumb_update_stats(const struct tp_dispatch *tp, struct tp_touch *t)
 {
+	bool needs_jail = true;
+
+	if (t->state == TOUCH_BEGIN)
+		t->thumb.initial = t->point;
+
+	t->thumb.in_exclusion_area = tp_thumb_in_exclusion_area(tp, t);
+	t->thumb.pressure_size = tp_thumb_detect_pressure_size(tp, t);
+	t->thumb.fast = t->speed.exceeded_count >= tp_scale_frame_count(tp, 10);
+
 	if (t->point.y < tp->thumb.upper_thumb_line ||
 	    tp->scroll.method == LIBINPUT_CONFIG_SCROLL_EDGE)
-		return false;
+		needs_jail = false;
+	else if (!t->thumb.in_exclusion_area &&
+		 (tp->thumb.use_size || tp->thumb.use_pressure) &&
+		 !t->thumb.pressure_size)
+		needs_jail = false;
+	else if (t->thumb.fast)
+		needs_jail = false;
+
+	t->thumb.needs_jail = needs_jail;
+}
 
-	if (!tp_thumb_in_exclusion_area(tp, t) &&
-	    (tp->thumb.use_size || tp->thumb.use_pressure) &&
-	    !tp_thumb_detect_pressure_size(tp, t))
-		return false;
+static inline bool
+tp_thumb_needs_jail(const struct tp_dispatch *tp, const struct tp_touch *t)
+{
+	return t->thumb.needs_jail;
+}
 
-	if (t->speed.exceeded_count >= 10)
-		return false;
+static inline double
+tp_thumb_landing_distance_mm(const struct tp_dispatch *tp, const struct tp_touch *t)
+{
+	struct device_float_coords delta = device_delta(t->point, t->thumb.initial);
 
-	return true;
+	return length_in_mm(tp_phys_delta(tp, delta));
 }
 
 bool
@@ -198,10 +225,12 @@ tp_thumb_update_touch(struct tp_dispatch *tp, struct tp_touch *t, usec_t time)
 	if (!tp->thumb.detect_thumbs)
 		return;
 
+	tp_thumb_update_stats(tp, t);
+
 	/* Once any active touch exceeds the speed threshold, don't
 	 * try to detect pinches until all touches lift.
 	 */
-	if (t->speed.exceeded_count >= 10 && tp->thumb.pinch_eligible &&
+	if (t->thumb.fast && tp->thumb.pinch_eligible &&
 	    tp->gesture.state == GESTURE_STATE_NONE) {
 		tp->thumb.pinch_eligible = false;
 		if (tp->thumb.state == THUMB_STATE_PINCH) {
@@ -241,6 +270,19 @@ tp_thumb_update_touch(struct tp_dispatch *tp, struct tp_touch *t, usec_t time)
 		return;
 	}
 
+	/* A thumb put down slowly may only reach the pressure or size
+	 * threshold a few frames after TOUCH_BEGIN. If that happens while
+	 * the touch is still resting where it landed, jail it as if it
+	 * had been detected on TOUCH_BEGIN.
+	 */
+	if (tp->thumb.state == THUMB_STATE_FINGER && t->state == TOUCH_UPDATE &&
+	    t->thumb.pressure_size && tp_thumb_needs_jail(tp, t) &&
+	    usec_cmp(usec_delta(time, t->initial_time), THUMB_TIMEOUT) < 0 &&
+	    tp_thumb_landing_distance_mm(tp, t) < THUMB_LANDING_TRAVEL_MM) {
+		tp_thumb_set_state(tp, t, THUMB_STATE_JAILED);
+		return;
+	}
+
 	/* If a touch breaks the speed threshold, or leaves the thumb area
 	 * (upper or lower, depending on HW detection), it "escapes" jail.
 	 */
@@ -264,8 +306,8 @@ tp_thumb_update_multifinger(struct tp_dispatch *tp)
 	/* Get the first and second bottom-most touches, the max speed exceeded
 	 * count overall, and the newest and oldest touches.
 	 */
-	tp_for_each_touch(tp, t) {
-		if (t->state == TOUCH_NONE || t->state == TOUCH_HOVERING)
+	tp_for_each_active_touch(tp, t) {
+		if (t->state == TOUCH_HOVERING)
 			continue;
 
 		if (t->state == TOUCH_BEGIN)
@@ -307,7 +349,7 @@ tp_thumb_update_multifinger(struct tp_dispatch *tp)
 	 * while scrolling or swiping.
 	 */
 	if (newest && tp->thumb.state == THUMB_STATE_FINGER && tp->nfingers_down >= 2 &&
-	    speed_exceeded_count > 5 &&
+	    speed_exceeded_count > tp_scale_frame_count(tp, 5) &&
 	    (tp->scroll.method != LIBINPUT_CONFIG_SCROLL_2FG ||
 	     (mm.x > SCROLL_MM_X || mm.y > SCROLL_MM_Y))) {
 		evdev_log_debug(tp->device,
@@ -117,12 +117,8 @@ tp_filter_scroll(struct tp_dispatch *tp,
 }
 
 static inline void
-tp_calculate_motion_speed(struct tp_dispatch *tp, struct tp_touch *t, usec_t time)
+tp_calculate_motion_speed(struct tp_dispatch *tp, struct tp_touch *t)
 {
-	const struct tp_history_point *last;
-	struct device_coords delta;
-	struct phys_coords mm;
-
 	/* Don't do this on single-touch or semi-mt devices */
 	if (!tp->has_mt || tp->semi_mt)
 		return;
@@ -142,19 +138,40 @@ tp_calculate_motion_speed(struct tp_dispatch *tp, struct tp_touch *t, usec_t tim
 	if (t->history.count < 4)
 		return;
 
-	/* TODO: we probably need a speed history here so we can average
-	 * across a few events */
-	last = tp_motion_history_offset(t, 1);
-	delta.x = abs(t->point.x - last->point.x);
-	delta.y = abs(t->point.y - last->point.y);
-	mm = evdev_device_unit_delta_to_mm(tp->device, &delta);
+	t->speed.last_speed = t->history.stats.velocity;
+}
+
+static inline void
+tp_motion_history_update_stats(struct tp_dispatch *tp, struct tp_touch *t)
+{
+	struct tp_history_stats *stats = &t->history.stats;
+	const struct tp_history_point *now, *prev;
+	struct device_float_coords delta;
+	usec_t tdelta;
+	double distance_mm;
+
+	if (t->history.count <= 1) {
+		stats->delta = (struct device_coords){ 0, 0 };
+		stats->velocity = 0.0;
+		return;
+	}
+
+	now = tp_motion_history_offset(t, 0);
+	prev = tp_motion_history_offset(t, 1);
 
-	usec_t tdelta = usec_delta(time, last->time);
-	double distance = length_in_mm(mm);
-	double speed = distance / usec_as_uint64_t(tdelta); /* mm/us */
-	speed *= 1000000;                                   /* mm/s */
+	stats->delta.x = now->point.x - prev->point.x;
+	stats->delta.y = now->point.y - prev->point.y;
+	delta.x = stats->delta.x;
+	delta.y = stats->delta.y;
+	distance_mm = length_in_mm(tp_phys_delta(tp, delta));
+	stats->travel_mm += distance_mm;
+
+	/* Two frames with the same timestamp, keep the previous speed */
+	tdelta = usec_delta(now->time, prev->time);
+	if (usec_is_zero(tdelta))
+		return;
 
-	t->speed.last_speed = speed;
+	stats->velocity = distance_mm * 1000000 / usec_as_uint64_t(tdelta);
 }
 
 static inline void
@@ -168,6 +185,8 @@ tp_motion_history_push(struct tp_touch *t, usec_t time)
 	t->history.samples[motion_index].point = t->point;
 	t->history.samples[motion_index].time = time;
 	t->history.index = motion_index;
+
+	tp_motion_history_update_stats(t->tp, t);
 }
 
 /* Idea: if we got a tuple of *very* quick moves like {Left, Right,
@@ -205,7 +224,9 @@ tp_detect_wobbling(struct tp_dispatch *tp, struct tp_touch *t, usec_t time)
 
 	tp->hysteresis.last_motion_time = time;
 
-	if ((dx == 0 && dy != 0) || usec_cmp(dtime, usec_from_millis(40)) > 0) {
+	/* 40ms at the reference frame rate, a bit over three frames */
+	if ((dx == 0 && dy != 0) ||
+	    usec_cmp(dtime, usec_div(usec_mul(tp_frame_interval(tp), 40), 12)) > 0) {
 		t->hysteresis.x_motion_history = 0;
 		return;
 	}
@@ -243,6 +264,7 @@ static inline void
 tp_motion_history_reset(struct tp_touch *t)
 {
 	t->history.count = 0;
+	tp_motion_history_update_stats(t->tp, t);
 }
 
 static inline struct tp_touch *
@@ -336,7 +358,7 @@ tp_new_touch(struct tp_dispatch *tp, struct tp_touch *t, usec_t time)
 				     "touch %d ended and began in same frame.\n",
 				     t->index);
 		tp->nfingers_down++;
-		t->state = TOUCH_UPDATE;
+		tp_touch_set_state(tp, t, TOUCH_UPDATE);
 		t->has_ended = false;
 		return;
 	}
@@ -345,11 +367,11 @@ tp_new_touch(struct tp_dispatch *tp, struct tp_touch *t, usec_t time)
 	 * don't know if it's a touch down or not. And BTN_TOUCH may happen
 	 * after ABS_MT_TRACKING_ID */
 	tp_motion_history_reset(t);
-	t->dirty = true;
+	tp_touch_set_dirty(tp, t);
 	t->has_ended = false;
 	t->was_down = false;
 	t->palm.state = PALM_NONE;
-	t->state = TOUCH_HOVERING;
+	tp_touch_set_state(tp, t, TOUCH_HOVERING);
 	t->pinned.is_pinned = false;
 	t->speed.last_speed = 0;
 	t->speed.exceeded_count = 0;
@@ -360,8 +382,8 @@ tp_new_touch(struct tp_dispatch *tp, struct tp_touch *t, usec_t time)
 static inline void
 tp_begin_touch(struct tp_dispatch *tp, struct tp_touch *t, usec_t time)
 {
-	t->dirty = true;
-	t->state = TOUCH_BEGIN;
+	tp_touch_set_dirty(tp, t);
+	tp_touch_set_state(tp, t, TOUCH_BEGIN);
 	t->initial_time = time;
 	t->was_down = true;
 	tp->nfingers_down++;
@@ -369,7 +391,7 @@ tp_begin_touch(struct tp_dispatch *tp, struct tp_touch *t, usec_t time)
 	t->tap.is_thumb = false;
 	t->tap.is_palm = false;
 	t->speed.exceeded_count = 0;
-	t->dwt.cumulative_distance_mm = 0.0;
+	t->history.stats.travel_mm = 0.0;
 	t->dwt.distance_exceeded = false;
 	assert(tp->nfingers_down >= 1);
 	tp->hysteresis.last_motion_time = time;
@@ -404,12 +426,12 @@ tp_maybe_end_touch(struct tp_dispatch *tp, struct tp_touch *t, usec_t time)
 	if (t->state != TOUCH_HOVERING) {
 		assert(tp->nfingers_down >= 1);
 		tp->nfingers_down--;
-		t->state = TOUCH_MAYBE_END;
+		tp_touch_set_state(tp, t, TOUCH_MAYBE_END);
 	} else {
-		t->state = TOUCH_NONE;
+		tp_touch_set_state(tp, t, TOUCH_NONE);
 	}
 
-	t->dirty = true;
+	tp_touch_set_dirty(tp, t);
 }
 
 /**
@@ -419,8 +441,8 @@ tp_maybe_end_touch(struct tp_dispatch *tp, struct tp_touch *t, usec_t time)
 static inline void
 tp_recover_ended_touch(struct tp_dispatch *tp, struct tp_touch *t)
 {
-	t->dirty = true;
-	t->state = TOUCH_UPDATE;
+	tp_touch_set_dirty(tp, t);
+	tp_touch_set_state(tp, t, TOUCH_UPDATE);
 	tp->nfingers_down++;
 }
 
@@ -439,9 +461,9 @@ tp_end_touch(struct tp_dispatch *tp, struct tp_touch *t, usec_t time)
 		return;
 	}
 
-	t->dirty = true;
+	tp_touch_set_dirty(tp, t);
 	t->palm.state = PALM_NONE;
-	t->state = TOUCH_END;
+	tp_touch_set_state(tp, t, TOUCH_END);
 	t->pinned.is_pinned = false;
 	t->palm.time = usec_from_uint64_t(0);
 	t->speed.exceeded_count = 0;
@@ -469,18 +491,7 @@ tp_stop_actions(struct tp_dispatch *tp, usec_t time)
 struct device_coords
 tp_get_delta(struct tp_touch *t)
 {
-	struct device_coords delta;
-	const struct device_coords zero = { 0.0, 0.0 };
-
-	if (t->history.count <= 1)
-		return zero;
-
-	delta.x = tp_motion_history_offset(t, 0)->point.x -
-		  tp_motion_history_offset(t, 1)->point.x;
-	delta.y = tp_motion_history_offset(t, 0)->point.y -
-		  tp_motion_history_offset(t, 1)->point.y;
-
-	return delta;
+	return t->history.stats.delta;
 }
 
 static inline int32_t
@@ -515,13 +526,13 @@ tp_process_absolute(struct tp_dispatch *tp, const struct evdev_event *e, usec_t
 	case EVDEV_ABS_MT_POSITION_X:
 		evdev_device_check_abs_axis_range(tp->device, e->usage, e->value);
 		t->point.x = rotated(tp, e->usage, e->value);
-		t->dirty = true;
+		tp_touch_set_dirty(tp, t);
 		tp->queued |= TOUCHPAD_EVENT_MOTION;
 		break;
 	case EVDEV_ABS_MT_POSITION_Y:
 		evdev_device_check_abs_axis_range(tp->device, e->usage, e->value);
 		t->point.y = rotated(tp, e->usage, e->value);
-		t->dirty = true;
+		tp_touch_set_dirty(tp, t);
 		tp->queued |= TOUCHPAD_EVENT_MOTION;
 		break;
 	case EVDEV_ABS_MT_SLOT:
@@ -538,22 +549,22 @@ tp_process_absolute(struct tp_dispatch *tp, const struct evdev_event *e, usec_t
 		break;
 	case EVDEV_ABS_MT_PRESSURE:
 		t->pressure = e->value;
-		t->dirty = true;
+		tp_touch_set_dirty(tp, t);
 		tp->queued |= TOUCHPAD_EVENT_OTHERAXIS;
 		break;
 	case EVDEV_ABS_MT_TOOL_TYPE:
 		t->is_tool_palm = e->value == MT_TOOL_PALM;
-		t->dirty = true;
+		tp_touch_set_dirty(tp, t);
 		tp->queued |= TOUCHPAD_EVENT_OTHERAXIS;
 		break;
 	case EVDEV_ABS_MT_TOUCH_MAJOR:
 		t->major = e->value;
-		t->dirty = true;
+		tp_touch_set_dirty(tp, t);
 		tp->queued |= TOUCHPAD_EVENT_OTHERAXIS;
 		break;
 	case EVDEV_ABS_MT_TOUCH_MINOR:
 		t->minor = e->value;
-		t->dirty = true;
+		tp_touch_set_dirty(tp, t);
 		tp->queued |= TOUCHPAD_EVENT_OTHERAXIS;
 		break;
 	default:
@@ -570,18 +581,18 @@ tp_process_absolute_st(struct tp_dispatch *tp, const struct evdev_event *e, usec
 	case EVDEV_ABS_X:
 		evdev_device_check_abs_axis_range(tp->device, e->usage, e->value);
 		t->point.x = rotated(tp, e->usage, e->value);
-		t->dirty = true;
+		tp_touch_set_dirty(tp, t);
 		tp->queued |= TOUCHPAD_EVENT_MOTION;
 		break;
 	case EVDEV_ABS_Y:
 		evdev_device_check_abs_axis_range(tp->device, e->usage, e->value);
 		t->point.y = rotated(tp, e->usage, e->value);
-		t->dirty = true;
+		tp_touch_set_dirty(tp, t);
 		tp->queued |= TOUCHPAD_EVENT_MOTION;
 		break;
 	case EVDEV_ABS_PRESSURE:
 		t->pressure = e->value;
-		t->dirty = true;
+		tp_touch_set_dirty(tp, t);
 		tp->queued |= TOUCHPAD_EVENT_OTHERAXIS;
 		break;
 	default:
@@ -742,7 +753,7 @@ tp_process_key(struct tp_dispatch *tp, const struct evdev_event *e, usec_t time)
 static void
 tp_process_msc(struct tp_dispatch *tp, const struct evdev_event *e, usec_t time)
 {
-	if (evdev_usage_eq(e->usage, EVDEV_MSC_TIMESTAMP))
+	if (!evdev_usage_eq(e->usage, EVDEV_MSC_TIMESTAMP))
 		return;
 
 	tp->quirks.msc_timestamp.now = usec_from_uint64_t(e->value);
@@ -799,35 +810,167 @@ tp_touch_active_for_gesture(const struct tp_dispatch *tp, const struct tp_touch
 	       tp_edge_scroll_touch_active(tp, t);
 }
 
+static uint32_t
+tp_zones_for_x(const struct tp_dispatch *tp, int32_t x)
+{
+	/* zones that only depend on y are set for all x */
+	uint32_t zones = TP_ZONE_PALM_TOP | TP_ZONE_BOTTOM_AREA |
+			 TP_ZONE_TOP_AREA | TP_ZONE_EDGE_SCROLL_BOTTOM |
+			 TP_ZONE_TAP_EDGE_Y;
+
+	if (x < tp->palm.left_edge || x > tp->palm.right_edge)
+		zones |= TP_ZONE_PALM_SIDE;
+	if (x > tp->buttons.bottom_area.rightbutton_left_edge)
+		zones |= TP_ZONE_BOTTOM_RIGHT;
+	else if (x > tp->buttons.bottom_area.middlebutton_left_edge)
+		zones |= TP_ZONE_BOTTOM_MIDDLE;
+	if (x > tp->buttons.top_area.rightbutton_left_edge)
+		zones |= TP_ZONE_TOP_RIGHT;
+	if (x >= tp->buttons.top_area.leftbutton_right_edge &&
+	    x <= tp->buttons.top_area.rightbutton_left_edge)
+		zones |= TP_ZONE_TOP_MIDDLE;
+	if (x > tp->scroll.right_edge)
+		zones |= TP_ZONE_EDGE_SCROLL_RIGHT;
+	if (x < tp->tap.edges.left || x > tp->tap.edges.right)
+		zones |= TP_ZONE_TAP_EDGE_X;
+
+	return zones;
+}
+
+static uint32_t
+tp_zones_for_y(const struct tp_dispatch *tp, int32_t y)
+{
+	/* zones that only depend on x are set for all y */
+	uint32_t zones = TP_ZONE_PALM_SIDE | TP_ZONE_EDGE_SCROLL_RIGHT |
+			 TP_ZONE_TAP_EDGE_X;
+
+	if (y < tp->palm.upper_edge)
+		zones |= TP_ZONE_PALM_TOP;
+	if (y >= tp->buttons.bottom_area.top_edge)
+		zones |= TP_ZONE_BOTTOM_AREA | TP_ZONE_BOTTOM_MIDDLE |
+			 TP_ZONE_BOTTOM_RIGHT;
+	if (y <= tp->buttons.top_area.bottom_edge)
+		zones |= TP_ZONE_TOP_AREA | TP_ZONE_TOP_MIDDLE | TP_ZONE_TOP_RIGHT;
+	if (y > tp->scroll.bottom_edge)
+		zones |= TP_ZONE_EDGE_SCROLL_BOTTOM;
+	if (y < tp->tap.edges.top || y > tp->tap.edges.bottom)
+		zones |= TP_ZONE_TAP_EDGE_Y;
+
+	return zones;
+}
+
+static int
+cmp_int64(const void *a, const void *b)
+{
+	int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+static void
+tp_zone_axis_build(const struct tp_dispatch *tp,
+		   struct tp_zone_axis *axis,
+		   const int32_t *thresholds,
+		   size_t nthresholds,
+		   uint32_t (*zones_at)(const struct tp_dispatch *tp, int32_t v))
+{
+	int64_t bounds[TP_ZONE_MAX_INTERVALS];
+	size_t nbounds = 0;
+
+	assert(1 + 2 * nthresholds <= ARRAY_LENGTH(bounds));
+
+	/* Every predicate is a <, <=, > or >= against a threshold a, so
+	 * its result can only change at a or a + 1. Within the intervals
+	 * between those boundaries the zones are constant. */
+	bounds[nbounds++] = INT32_MIN;
+	for (size_t i = 0; i < nthresholds; i++) {
+		bounds[nbounds++] = thresholds[i];
+		bounds[nbounds++] = (int64_t)thresholds[i] + 1;
+	}
+	qsort(bounds, nbounds, sizeof(*bounds), cmp_int64);
+
+	axis->ninterval = 0;
+	for (size_t i = 0; i < nbounds; i++) {
+		uint32_t zones;
+
+		if (bounds[i] > INT32_MAX)
+			break;
+		if (axis->ninterval > 0 &&
+		    bounds[i] == axis->start[axis->ninterval - 1])
+			continue;
+
+		zones = zones_at(tp, (int32_t)bounds[i]);
+		/* merge neighbours that ended up in the same zones */
+		if (axis->ninterval > 0 &&
+		    axis->zones[axis->ninterval - 1] == zones)
+			continue;
+
+		axis->start[axis->ninterval] = (int32_t)bounds[i];
+		axis->zones[axis->ninterval] = zones;
+		axis->ninterval++;
+	}
+}
+
+/**
+ * Precompute the palm, button, edge scroll and tap edge zones for every
+ * point of the touchpad. Must be called whenever one of those edges
+ * changes.
+ */
+void
+tp_zones_rebuild(struct tp_dispatch *tp)
+{
+	const int32_t xs[] = {
+		tp->palm.left_edge,
+		tp->palm.right_edge,
+		tp->buttons.bottom_area.rightbutton_left_edge,
+		tp->buttons.bottom_area.middlebutton_left_edge,
+		tp->buttons.top_area.rightbutton_left_edge,
+		tp->buttons.top_area.leftbutton_right_edge,
+		tp->scroll.right_edge,
+		tp->tap.edges.left,
+		tp->tap.edges.right,
+	};
+	const int32_t ys[] = {
+		tp->palm.upper_edge,
+		tp->buttons.bottom_area.top_edge,
+		tp->buttons.top_area.bottom_edge,
+		tp->scroll.bottom_edge,
+		tp->tap.edges.top,
+		tp->tap.edges.bottom,
+	};
+
+	tp_zone_axis_build(tp, &tp->zones.x, xs, ARRAY_LENGTH(xs), tp_zones_for_x);
+	tp_zone_axis_build(tp, &tp->zones.y, ys, ARRAY_LENGTH(ys), tp_zones_for_y);
+}
+
 static inline bool
 tp_palm_was_in_side_edge(const struct tp_dispatch *tp, const struct tp_touch *t)
 {
-	return t->palm.first.x < tp->palm.left_edge ||
-	       t->palm.first.x > tp->palm.right_edge;
+	return !!(tp_zones_at(tp, t->palm.first) & TP_ZONE_PALM_SIDE);
 }
 
 static inline bool
 tp_palm_was_in_top_edge(const struct tp_dispatch *tp, const struct tp_touch *t)
 {
-	return t->palm.first.y < tp->palm.upper_edge;
+	return !!(tp_zones_at(tp, t->palm.first) & TP_ZONE_PALM_TOP);
 }
 
 static inline bool
 tp_palm_in_side_edge(const struct tp_dispatch *tp, const struct tp_touch *t)
 {
-	return t->point.x < tp->palm.left_edge || t->point.x > tp->palm.right_edge;
+	return !!(tp_zones_at(tp, t->point) & TP_ZONE_PALM_SIDE);
 }
 
 static inline bool
 tp_palm_in_top_edge(const struct tp_dispatch *tp, const struct tp_touch *t)
 {
-	return t->point.y < tp->palm.upper_edge;
+	return !!(tp_zones_at(tp, t->point) & TP_ZONE_PALM_TOP);
 }
 
 static inline bool
 tp_palm_in_edge(const struct tp_dispatch *tp, const struct tp_touch *t)
 {
-	return tp_palm_in_side_edge(tp, t) || tp_palm_in_top_edge(tp, t);
+	return !!(tp_zones_at(tp, t->point) & (TP_ZONE_PALM_SIDE | TP_ZONE_PALM_TOP));
 }
 
 static bool
@@ -949,7 +1092,7 @@ tp_palm_detect_multifinger(struct tp_dispatch *tp, struct tp_touch *t, usec_t ti
 	 * frame the second touch will still be PALM_NONE and thus detected
 	 * here as non-palm touch. This is too niche to worry about for now.
 	 */
-	tp_for_each_touch(tp, other) {
+	tp_for_each_active_touch(tp, other) {
 		if (other == t)
 			continue;
 
@@ -1193,7 +1336,7 @@ tp_unhover_pressure(struct tp_dispatch *tp, usec_t time)
 	 * ones don't. Anything else gets insane quickly.
 	 */
 	if (real_fingers_down > 0) {
-		tp_for_each_touch(tp, t) {
+		tp_for_each_active_touch(tp, t) {
 			if (t->state == TOUCH_HOVERING) {
 				/* avoid jumps when landing a finger */
 				tp_motion_history_reset(t);
@@ -1285,7 +1428,7 @@ tp_unhover_fake_touches(struct tp_dispatch *tp, usec_t time)
 	 * until nfingers_down matches nfake_touches
 	 */
 	if (tp_fake_finger_is_touching(tp) && tp->nfingers_down < nfake_touches) {
-		tp_for_each_touch(tp, t) {
+		tp_for_each_active_touch(tp, t) {
 			if (t->state == TOUCH_HOVERING) {
 				tp_begin_touch(tp, t, time);
 
@@ -1362,8 +1505,8 @@ tp_position_fake_touches(struct tp_dispatch *tp)
 
 		t->point = topmost->point;
 		t->pressure = topmost->pressure;
-		if (!t->dirty)
-			t->dirty = topmost->dirty;
+		if (!t->dirty && topmost->dirty)
+			tp_touch_set_dirty(tp, t);
 	}
 }
 
@@ -1412,7 +1555,8 @@ tp_detect_jumps(const struct tp_dispatch *tp, struct tp_touch *t, usec_t time)
 	usec_t tdelta;
 	/* Reference interval from the touchpad the various thresholds
 	 * were measured from */
-	usec_t reference_interval = usec_from_millis(12);
+	usec_t reference_interval = TP_REFERENCE_FRAME_INTERVAL;
+	usec_t frame_interval = tp_frame_interval(tp);
 
 	/* On some touchpads the firmware does funky stuff and we cannot
 	 * have our own jump detection, e.g. Lenovo Carbon X1 Gen 6 (see
@@ -1439,13 +1583,15 @@ tp_detect_jumps(const struct tp_dispatch *tp, struct tp_touch *t, usec_t time)
 
 	/* For test devices we always force the time delta to 12, at least
 	   until the test suite actually does proper intervals. */
-	if (tp->device->model_flags & EVDEV_MODEL_TEST_DEVICE)
+	if (tp->device->model_flags & EVDEV_MODEL_TEST_DEVICE) {
 		reference_interval = tdelta;
+		frame_interval = tdelta;
+	}
 
-	/* If the last frame is more than 30ms ago, we have irregular
+	/* If the last frame is more than 2.5 frames ago, we have irregular
 	 * frames, who knows what's a pointer jump here and what's
 	 * legitimate movement.... */
-	if (usec_cmp(tdelta, usec_mul(reference_interval, 2.5)) > 0 ||
+	if (usec_cmp(tdelta, usec_mul(frame_interval, 2.5)) > 0 ||
 	    usec_is_zero(tdelta))
 		return false;
 
@@ -1616,7 +1762,7 @@ tp_pre_process_state(struct tp_dispatch *tp, usec_t time)
 	tp_process_fake_touches(tp, time);
 	tp_unhover_touches(tp, time);
 
-	tp_for_each_touch(tp, t) {
+	tp_for_each_active_touch(tp, t) {
 		if (t->state == TOUCH_MAYBE_END)
 			tp_end_touch(tp, t, time);
 
@@ -1640,10 +1786,7 @@ tp_process_state(struct tp_dispatch *tp, usec_t time)
 
 	want_motion_reset = tp_need_motion_history_reset(tp);
 
-	tp_for_each_touch(tp, t) {
-		if (t->state == TOUCH_NONE)
-			continue;
-
+	tp_for_each_active_touch(tp, t) {
 		if (want_motion_reset) {
 			tp_motion_history_reset(t);
 			t->quirks.reset_motion_history = true;
@@ -1685,17 +1828,8 @@ tp_process_state(struct tp_dispatch *tp, usec_t time)
 		tp_motion_hysteresis(tp, t);
 		tp_motion_history_push(t, time);
 
-		if (!t->dwt.distance_exceeded) {
-			struct device_coords raw_delta = tp_get_delta(t);
-			struct device_float_coords fdelta = {
-				.x = raw_delta.x,
-				.y = raw_delta.y,
-			};
-			struct phys_coords mm = tp_phys_delta(tp, fdelta);
-			t->dwt.cumulative_distance_mm += length_in_mm(mm);
-			if (t->dwt.cumulative_distance_mm >= 20.0)
-				t->dwt.distance_exceeded = true;
-		}
+		if (t->history.stats.travel_mm >= 20.0)
+			t->dwt.distance_exceeded = true;
 
 		/* Touch speed handling: if we'are above the threshold,
 		 * count each event that we're over the threshold up to 10
@@ -1703,14 +1837,15 @@ tp_process_state(struct tp_dispatch *tp, usec_t time)
 		 *
 		 * Take the touch with the highest speed excess, if it is
 		 * above a certain threshold (5, see below), assume a
-		 * dropped finger is a thumb.
+		 * dropped finger is a thumb. All counts are in frames at
+		 * the reference frame rate, see tp_scale_frame_count().
 		 *
 		 * Yes, this relies on the touchpad to keep sending us
 		 * events even if the finger doesn't move, otherwise we
 		 * never count down. Let's see how far we get with that.
 		 */
 		if (t->speed.last_speed > THUMB_IGNORE_SPEED_THRESHOLD) {
-			if (t->speed.exceeded_count < 15)
+			if (t->speed.exceeded_count < tp_scale_frame_count(tp, 15))
 				t->speed.exceeded_count++;
 		} else if (t->speed.exceeded_count > 0) {
 			t->speed.exceeded_count--;
@@ -1719,7 +1854,7 @@ tp_process_state(struct tp_dispatch *tp, usec_t time)
 		speed_exceeded_count =
 			max(speed_exceeded_count, t->speed.exceeded_count);
 
-		tp_calculate_motion_speed(tp, t, time);
+		tp_calculate_motion_speed(tp, t);
 
 		tp_unpin_finger(tp, t);
 
@@ -1755,21 +1890,17 @@ tp_post_process_state(struct tp_dispatch *tp, usec_t time)
 {
 	struct tp_touch *t;
 
-	tp_for_each_touch(tp, t) {
-
-		if (!t->dirty)
-			continue;
-
+	tp_for_each_dirty_touch(tp, t) {
 		if (t->state == TOUCH_END) {
 			if (t->has_ended)
-				t->state = TOUCH_NONE;
+				tp_touch_set_state(tp, t, TOUCH_NONE);
 			else
-				t->state = TOUCH_HOVERING;
+				tp_touch_set_state(tp, t, TOUCH_HOVERING);
 		} else if (t->state == TOUCH_BEGIN) {
-			t->state = TOUCH_UPDATE;
+			tp_touch_set_state(tp, t, TOUCH_UPDATE);
 		}
 
-		t->dirty = false;
+		tp_touch_clear_dirty(tp, t);
 	}
 
 	tp->old_nfingers_down = tp->nfingers_down;
@@ -1835,19 +1966,240 @@ tp_apply_rotation(struct evdev_device *device)
 			tp->left_handed.rotate ? "on" : "off");
 }
 
+void
+tp_notify_pointer_motion(struct tp_dispatch *tp,
+			 usec_t time,
+			 const struct normalized_coords *delta,
+			 const struct device_float_coords *unaccel)
+{
+	struct normalized_coords predicted = { 0.0, 0.0 };
+
+	if (usec_is_zero(tp->prediction.horizon)) {
+		pointer_notify_motion(&tp->device->base, time, delta, unaccel);
+		return;
+	}
+
+	/* The first motion after a stop only gives us the start time */
+	if (!usec_is_zero(tp->prediction.last_time)) {
+		double interval = usec_as_uint64_t(tp_frame_interval(tp)) / 1000.0;
+		double horizon = usec_as_uint64_t(tp->prediction.horizon) / 1000.0;
+		double dt = usec_as_uint64_t(usec_sub(time, tp->prediction.last_time)) /
+			    1000.0;
+		struct normalized_coords *vel = &tp->prediction.velocity;
+
+		/* Events may arrive in bursts, a SYN gap shorter than a
+		 * hardware frame would make the velocity explode */
+		dt = max(dt, interval);
+
+		/* Smooth out the sensor noise, this lags the
+		 * prediction a bit on direction changes */
+		vel->x = 0.5 * vel->x + 0.5 * delta->x / dt;
+		vel->y = 0.5 * vel->y + 0.5 * delta->y / dt;
+
+		predicted.x = vel->x * horizon;
+		predicted.y = vel->y * horizon;
+
+		/* Never predict further than the current motion would
+		 * cover within the horizon, otherwise the smoothing
+		 * overshoots when the finger slows down */
+		double limit = normalized_length(*delta) * horizon / interval;
+		double length = normalized_length(predicted);
+		if (length > limit) {
+			predicted.x *= limit / length;
+			predicted.y *= limit / length;
+		}
+	}
+
+	tp->prediction.last_time = time;
+	tp->prediction.posted = true;
+	tp->prediction.pending = !normalized_is_zero(predicted);
+
+	pointer_notify_motion_predicted(&tp->device->base,
+					time,
+					delta,
+					unaccel,
+					&predicted);
+}
+
+/**
+ * End the current prediction. If the last motion event carried a
+ * prediction, send one more motion event without delta or prediction so
+ * the caller can move the pointer back to its actual position.
+ */
+static void
+tp_prediction_stop(struct tp_dispatch *tp, usec_t time)
+{
+	if (tp->prediction.pending) {
+		const struct normalized_coords zero = { 0.0, 0.0 };
+		const struct device_float_coords raw = { 0.0, 0.0 };
+
+		pointer_notify_motion_predicted(&tp->device->base,
+						time,
+						&zero,
+						&raw,
+						&zero);
+		tp->prediction.pending = false;
+	}
+
+	tp->prediction.velocity = (struct normalized_coords){ 0.0, 0.0 };
+	tp->prediction.last_time = usec_from_uint64_t(0);
+}
+
+/**
+ * Update the estimated interval between hardware frames. The hardware
+ * timestamp is preferred where we have it, it doesn't include the
+ * jitter of the kernel and our own event processing.
+ */
+static void
+tp_frame_rate_update(struct tp_dispatch *tp, usec_t time)
+{
+	const usec_t max_interval = usec_from_millis(50);
+	usec_t delta = usec_from_uint64_t(0);
+	usec_t msc = tp->quirks.msc_timestamp.now;
+
+	if ((tp->queued & TOUCHPAD_EVENT_TIMESTAMP) &&
+	    !usec_is_zero(tp->frame_rate.last_msc_timestamp) &&
+	    usec_cmp(msc, tp->frame_rate.last_msc_timestamp) > 0)
+		delta = usec_delta(msc, tp->frame_rate.last_msc_timestamp);
+	else if (tp->nfingers_down > 0 &&
+		 !usec_is_zero(tp->frame_rate.last_frame_time))
+		delta = usec_delta(time, tp->frame_rate.last_frame_time);
+
+	if (tp->queued & TOUCHPAD_EVENT_TIMESTAMP)
+		tp->frame_rate.last_msc_timestamp = msc;
+	tp->frame_rate.last_frame_time = time;
+
+	/* Anything longer is a pause, not the frame rate */
+	if (usec_is_zero(delta) || usec_cmp(delta, max_interval) > 0)
+		return;
+
+	if (usec_is_zero(tp->frame_rate.interval))
+		tp->frame_rate.interval = delta;
+	else
+		tp->frame_rate.interval =
+			usec_add(usec_mul(tp->frame_rate.interval, 0.875),
+				 usec_mul(delta, 0.125));
+}
+
+/**
+ * If a maximum frame rate is configured, defer a frame that arrives too
+ * soon after the last processed one. Only frames that move touches
+ * that are already down qualify, anything else (touches beginning or
+ * ending, buttons, fake finger changes) is processed immediately
+ * together with any pending motion.
+ *
+ * Touch coordinates are absolute, so a deferred frame is simply merged
+ * into the next one. The timer makes sure the last frame before the
+ * touchpad goes quiet is processed.
+ *
+ * @return true if the frame was deferred
+ */
+static bool
+tp_frame_rate_defer(struct tp_dispatch *tp, usec_t time)
+{
+	const struct msc_timestamp *m = &tp->quirks.msc_timestamp;
+	struct tp_touch *t;
+
+	if (usec_is_zero(tp->frame_rate.min_interval))
+		return false;
+
+	if (usec_cmp(usec_delta(time, tp->frame_rate.last_processed),
+		     tp->frame_rate.min_interval) >= 0)
+		return false;
+
+	if (!(tp->queued & TOUCHPAD_EVENT_MOTION) ||
+	    (tp->queued & (TOUCHPAD_EVENT_BUTTON_PRESS | TOUCHPAD_EVENT_BUTTON_RELEASE)))
+		return false;
+
+	/* The timestamp jump detection needs to see every frame */
+	if ((tp->queued & TOUCHPAD_EVENT_TIMESTAMP) &&
+	    (usec_is_zero(m->now) || m->state != JUMP_STATE_IGNORE))
+		return false;
+
+	if (tp->nfingers_down == 0 || tp->fake_touches != tp->frame_rate.fake_touches)
+		return false;
+
+	tp_for_each_active_touch(tp, t) {
+		if (t->state != TOUCH_UPDATE)
+			return false;
+	}
+
+	if (usec_is_zero(tp->frame_rate.pending_time))
+		libinput_timer_set(&tp->frame_rate.timer,
+				   usec_add(tp->frame_rate.last_processed,
+					    tp->frame_rate.min_interval));
+	tp->frame_rate.pending_time = time;
+
+	return true;
+}
+
+static void
+tp_prediction_timeout(usec_t now, void *data)
+{
+	struct tp_dispatch *tp = data;
+
+	tp_prediction_stop(tp, now);
+}
+
+/**
+ * A frame without pointer motion ends the current prediction. A finger
+ * that stops without lifting may not send any more frames at all, so
+ * the prediction also ends if no frame follows within a frame interval
+ * (plus some slack for jitter).
+ */
+static void
+tp_prediction_post_frame(struct tp_dispatch *tp, usec_t time)
+{
+	if (usec_is_zero(tp->prediction.horizon))
+		return;
+
+	if (tp->prediction.posted) {
+		tp->prediction.posted = false;
+		if (tp->prediction.pending)
+			libinput_timer_set(&tp->prediction.timer,
+					   usec_add(time,
+						    usec_mul(tp_frame_interval(tp),
+							     1.5)));
+		return;
+	}
+
+	libinput_timer_cancel(&tp->prediction.timer);
+	tp_prediction_stop(tp, time);
+}
+
 static void
 tp_handle_state(struct tp_dispatch *tp, usec_t time)
 {
+	if (!usec_is_zero(tp->frame_rate.pending_time)) {
+		libinput_timer_cancel(&tp->frame_rate.timer);
+		tp->frame_rate.pending_time = usec_from_uint64_t(0);
+	}
+	tp->frame_rate.last_processed = time;
+
 	tp_pre_process_state(tp, time);
 	tp_process_state(tp, time);
 	tp_post_events(tp, time);
+	tp_prediction_post_frame(tp, time);
 	tp_post_process_state(tp, time);
 
+	tp->frame_rate.fake_touches = tp->fake_touches;
+
 	tp_clickpad_middlebutton_apply_config(tp->device);
 	tp_apply_rotation(tp->device);
 	tp_3fg_drag_apply_config(tp->device);
 }
 
+static void
+tp_frame_rate_timeout(usec_t now, void *data)
+{
+	struct tp_dispatch *tp = data;
+
+	/* Process the merged frame with the time it arrived, not the
+	 * time the timer fired */
+	if (!usec_is_zero(tp->frame_rate.pending_time))
+		tp_handle_state(tp, tp->frame_rate.pending_time);
+}
+
 _unused_ static inline void
 tp_debug_touch_state(struct tp_dispatch *tp, struct evdev_device *device)
 {
@@ -1895,6 +2247,9 @@ tp_interface_process_event(struct evdev_dispatch *dispatch,
 		tp_process_msc(tp, e, time);
 		break;
 	case EV_SYN:
+		tp_frame_rate_update(tp, time);
+		if (tp_frame_rate_defer(tp, time))
+			break;
 		tp_handle_state(tp, time);
 #if 0
 		tp_debug_touch_state(tp, device);
@@ -1966,6 +2321,8 @@ tp_interface_remove(struct evdev_dispatch *dispatch)
 	struct evdev_paired_device *kbd;
 
 	libinput_timer_cancel(&tp->arbitration.arbitration_timer);
+	libinput_timer_cancel(&tp->frame_rate.timer);
+	libinput_timer_cancel(&tp->prediction.timer);
 
 	list_for_each_safe(kbd, &tp->dwt.paired_keyboard_list, link) {
 		evdev_paired_device_destroy(kbd);
@@ -1985,6 +2342,8 @@ tp_interface_destroy(struct evdev_dispatch *dispatch)
 	struct tp_dispatch *tp = tp_dispatch(dispatch);
 
 	libinput_timer_destroy(&tp->arbitration.arbitration_timer);
+	libinput_timer_destroy(&tp->frame_rate.timer);
+	libinput_timer_destroy(&tp->prediction.timer);
 	libinput_timer_destroy(&tp->palm.trackpoint_timer);
 	libinput_timer_destroy(&tp->dwt.keyboard_timer);
 	libinput_timer_destroy(&tp->tap.timer);
@@ -1993,6 +2352,9 @@ tp_interface_destroy(struct evdev_dispatch *dispatch)
 	libinput_timer_destroy(&tp->gesture.drag_3fg_timer);
 	libinput_timer_destroy(&tp->gesture.drag_3fg_or_swipe_timer);
 	free(tp->touches);
+	free(tp->touches_cold);
+	free(tp->dirty_mask);
+	free(tp->active_mask);
 	free(tp);
 }
 
@@ -2177,10 +2539,20 @@ tp_keyboard_timeout(usec_t now, void *data)
 {
 	struct tp_dispatch *tp = data;
 
+	/* Key presses only extend keyboard_active_until, catch up with
+	 * them here */
+	if (usec_cmp(tp->dwt.keyboard_active_until, now) > 0) {
+		libinput_timer_set(&tp->dwt.keyboard_timer,
+				   tp->dwt.keyboard_active_until);
+		evdev_log_debug(tp->device, "palm: keyboard timeout extended\n");
+		return;
+	}
+
 	if (tp->dwt.dwt_enabled &&
 	    long_any_bit_set(tp->dwt.key_mask, ARRAY_LENGTH(tp->dwt.key_mask))) {
+		tp->dwt.keyboard_active_until = usec_add(now, tp->dwt.timeout);
 		libinput_timer_set(&tp->dwt.keyboard_timer,
-				   usec_add(now, tp->dwt.timeout));
+				   tp->dwt.keyboard_active_until);
 		tp->dwt.keyboard_last_press_time = now;
 		evdev_log_debug(tp->device, "palm: keyboard timeout refresh\n");
 		return;
@@ -2249,7 +2621,7 @@ tp_pointer_motion_is_active(const struct tp_dispatch *tp, usec_t time)
 	if (tp->nfingers_down != 1)
 		return false;
 
-	tp_for_each_touch(tp, t) {
+	tp_for_each_active_touch(tp, t) {
 		if (t->state != TOUCH_UPDATE)
 			continue;
 
@@ -2271,7 +2643,7 @@ tp_keyboard_event(usec_t time, struct libinput_event *event, void *data)
 {
 	struct tp_dispatch *tp = data;
 	struct libinput_event_keyboard *kbdev;
-	usec_t timeout;
+	usec_t timeout, until;
 	unsigned int key;
 	bool is_modifier;
 
@@ -2334,13 +2706,21 @@ tp_keyboard_event(usec_t time, struct libinput_event *event, void *data)
 		tp_stop_actions(tp, time);
 		tp->dwt.keyboard_active = true;
 		timeout = DEFAULT_KEYBOARD_ACTIVITY_TIMEOUT_1;
+		until = usec_add(time, timeout);
+		libinput_timer_set(&tp->dwt.keyboard_timer, until);
 	} else {
+		/* Re-arming the timer for every key is expensive, leave it
+		 * to the timeout to catch up unless we need to fire
+		 * earlier than it will */
 		timeout = tp->dwt.timeout;
+		until = usec_add(time, timeout);
+		if (usec_cmp(until, tp->dwt.keyboard_active_until) < 0)
+			libinput_timer_set(&tp->dwt.keyboard_timer, until);
 	}
 
+	tp->dwt.keyboard_active_until = until;
 	tp->dwt.keyboard_last_press_time = time;
 	long_set_bit(tp->dwt.key_mask, key);
-	libinput_timer_set(&tp->dwt.keyboard_timer, usec_add(time, timeout));
 }
 
 static bool
@@ -2734,7 +3114,7 @@ evdev_tag_touchpad(struct evdev_device *device, struct udev_device *udev_device)
 	int bustype, vendor;
 	const char *prop;
 
-	prop = udev_device_get_property_value(udev_device, "ID_INTEGRATION");
+	prop = evdev_device_get_udev_property(device, "ID_INTEGRATION");
 	if (prop) {
 		if (streq(prop, "internal")) {
 			evdev_tag_touchpad_internal(device);
@@ -2750,8 +3130,7 @@ evdev_tag_touchpad(struct evdev_device *device, struct udev_device *udev_device)
 	}
 
 	/* Fall back to ID_TOUCHPAD_INTEGRATION if ID_INTEGRATION is missing */
-	prop = udev_device_get_property_value(udev_device,
-					      "ID_INPUT_TOUCHPAD_INTEGRATION");
+	prop = evdev_device_get_udev_property(device, "ID_INPUT_TOUCHPAD_INTEGRATION");
 	if (prop) {
 		if (streq(prop, "internal")) {
 			evdev_tag_touchpad_internal(device);
@@ -2891,6 +3270,7 @@ tp_interface_disable_feature(struct evdev_dispatch *dispatch,
 		tp->palm.right_edge = INT_MAX;
 		tp->palm.left_edge = INT_MIN;
 		tp->palm.upper_edge = INT_MIN;
+		tp_zones_rebuild(tp);
 		break;
 	default:
 		return;
@@ -2998,6 +3378,9 @@ tp_init_slots(struct tp_dispatch *tp, struct evdev_device *device)
 
 	tp->ntouches = max(tp->num_slots, n_btn_tool_touches);
 	tp->touches = zalloc(tp->ntouches * sizeof(struct tp_touch));
+	tp->touches_cold = zalloc(tp->ntouches * sizeof(struct tp_touch_cold));
+	tp->dirty_mask = zalloc(NLONGS(tp->ntouches) * sizeof(unsigned long));
+	tp->active_mask = zalloc(NLONGS(tp->ntouches) * sizeof(unsigned long));
 
 	for (i = 0; i < tp->ntouches; i++)
 		tp_init_touch(tp, &tp->touches[i], i);
@@ -3394,6 +3777,99 @@ tp_dwtp_config_get_default_timeout(struct libinput_device *device)
 	return DEFAULT_TRACKPOINT_ACTIVITY_TIMEOUT;
 }
 
+static int
+tp_prediction_config_is_available(struct libinput_device *device)
+{
+	return 1;
+}
+
+static enum libinput_config_status
+tp_prediction_config_set_horizon(struct libinput_device *device, usec_t horizon)
+{
+	struct evdev_device *evdev = evdev_device(device);
+	struct tp_dispatch *tp = (struct tp_dispatch *)evdev->dispatch;
+
+	libinput_timer_cancel(&tp->prediction.timer);
+	tp->prediction.horizon = horizon;
+	tp->prediction.velocity = (struct normalized_coords){ 0.0, 0.0 };
+	tp->prediction.last_time = usec_from_uint64_t(0);
+	tp->prediction.pending = false;
+	tp->prediction.posted = false;
+
+	return LIBINPUT_CONFIG_STATUS_SUCCESS;
+}
+
+static usec_t
+tp_prediction_config_get_horizon(struct libinput_device *device)
+{
+	struct evdev_device *evdev = evdev_device(device);
+	struct tp_dispatch *tp = (struct tp_dispatch *)evdev->dispatch;
+
+	return tp->prediction.horizon;
+}
+
+static usec_t
+tp_prediction_config_get_default_horizon(struct libinput_device *device)
+{
+	return usec_from_uint64_t(0);
+}
+
+static void
+tp_init_prediction(struct tp_dispatch *tp, struct evdev_device *device)
+{
+	char timer_name[64];
+
+	snprintf(timer_name,
+		 sizeof(timer_name),
+		 "%s prediction",
+		 evdev_device_get_sysname(device));
+	libinput_timer_init(&tp->prediction.timer,
+			    tp_libinput_context(tp),
+			    timer_name,
+			    tp_prediction_timeout,
+			    tp);
+
+	tp->prediction.config.is_available = tp_prediction_config_is_available;
+	tp->prediction.config.set_horizon = tp_prediction_config_set_horizon;
+	tp->prediction.config.get_horizon = tp_prediction_config_get_horizon;
+	tp->prediction.config.get_default_horizon =
+		tp_prediction_config_get_default_horizon;
+	tp->prediction.horizon =
+		tp_prediction_config_get_default_horizon(&device->base);
+	device->base.config.prediction = &tp->prediction.config;
+}
+
+static void
+tp_init_frame_rate(struct tp_dispatch *tp, struct evdev_device *device)
+{
+	char timer_name[64];
+	uint32_t rate;
+
+	snprintf(timer_name,
+		 sizeof(timer_name),
+		 "%s frame rate",
+		 evdev_device_get_sysname(device));
+	libinput_timer_init(&tp->frame_rate.timer,
+			    tp_libinput_context(tp),
+			    timer_name,
+			    tp_frame_rate_timeout,
+			    tp);
+
+	_unref_(quirks) *q = libinput_device_get_quirks(&device->base);
+	if (!q || !quirks_get_uint32(q, QUIRK_ATTR_TOUCHPAD_MAX_FRAME_RATE, &rate))
+		return;
+
+	/* Merging frames below the rate our heuristics were measured at
+	 * would break those */
+	if (rate < 80 || rate > 1000) {
+		evdev_log_bug_libinput(device, "Invalid touchpad max frame rate %u\n", rate);
+		return;
+	}
+
+	tp->frame_rate.min_interval = usec_from_uint64_t(1000000 / rate);
+	evdev_log_debug(device, "merging frames above %uHz\n", rate);
+}
+
 static inline bool
 tp_is_tpkb_combo_below(struct evdev_device *device)
 {
@@ -3818,6 +4294,10 @@ tp_init(struct tp_dispatch *tp, struct evdev_device *device)
 
 	tp->base.dispatch_type = DISPATCH_TOUCHPAD;
 	tp->base.interface = &tp_interface;
+	tp->base.pairing_wants =
+		bit(EVDEV_PAIRING_KEYBOARD) | bit(EVDEV_PAIRING_TRACKPOINT) |
+		bit(EVDEV_PAIRING_LID_SWITCH) | bit(EVDEV_PAIRING_TABLET_MODE_SWITCH) |
+		bit(EVDEV_PAIRING_TABLET) | bit(EVDEV_PAIRING_EXTERNAL_MOUSE);
 	tp->device = device;
 	list_init(&tp->dwt.paired_keyboard_list);
 
@@ -3852,11 +4332,14 @@ tp_init(struct tp_dispatch *tp, struct evdev_device *device)
 	tp_init_buttons(tp, device);
 	tp_init_dwt(tp, device);
 	tp_init_dwtp(tp, device);
+	tp_init_prediction(tp, device);
+	tp_init_frame_rate(tp, device);
 	tp_init_palmdetect(tp, device);
 	tp_init_sendevents(tp, device);
 	tp_init_scroll(tp, device);
 	tp_init_gesture(tp);
 	tp_init_thumb(tp);
+	tp_zones_rebuild(tp);
 
 	/* Lenovo X1 Gen6 buffers the events in a weird way, making jump
 	 * detection impossible. See
@@ -3887,15 +4370,10 @@ tp_sendevents_get_modes(struct libinput_device *device)
 static void
 tp_suspend_conditional(struct tp_dispatch *tp, struct evdev_device *device)
 {
-	struct libinput_device *dev;
+	struct libinput_seat *seat = device->base.seat;
 
-	list_for_each(dev, &device->base.seat->devices_list, link) {
-		struct evdev_device *d = evdev_device(dev);
-		if (d->tags & EVDEV_TAG_EXTERNAL_MOUSE) {
-			tp_suspend(tp, device, SUSPEND_EXTERNAL_MOUSE);
-			break;
-		}
-	}
+	if (!list_empty(&seat->pairing.role[EVDEV_PAIRING_EXTERNAL_MOUSE]))
+		tp_suspend(tp, device, SUSPEND_EXTERNAL_MOUSE);
 }
 
 static enum libinput_config_status
@@ -3979,6 +4457,7 @@ tp_requires_rotation(struct tp_dispatch *tp, struct evdev_device *device)
 	WacomDevice *dev;
 	uint32_t vid = evdev_device_get_id_vendor(device),
 		 pid = evdev_device_get_id_product(device);
+	usec_t start = usec_from_now();
 
 	if ((device->tags & EVDEV_TAG_TABLET_TOUCHPAD) == 0)
 		goto out;
@@ -4020,6 +4499,7 @@ out:
 	 * it until the device dies. */
 	if (db)
 		libinput_libwacom_unref(li);
+	evdev_timing_add(device, EVDEV_TIMING_LIBWACOM, start);
 #endif
 
 	return rotate;
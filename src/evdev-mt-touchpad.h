@@ -24,6 +24,7 @@
 #ifndef EVDEV_MT_TOUCHPAD_H
 #define EVDEV_MT_TOUCHPAD_H
 
+#include <math.h>
 #include <stdbool.h>
 
 #include "evdev.h"
@@ -32,6 +33,9 @@
 #define TOUCHPAD_HISTORY_LENGTH 4
 #define TOUCHPAD_MIN_SAMPLES 4
 
+/* The frame interval most of our heuristics were measured at */
+#define TP_REFERENCE_FRAME_INTERVAL usec_from_millis(12)
+
 /* Convert mm to a distance normalized to DEFAULT_MOUSE_DPI */
 #define TP_MM_TO_DPI_NORMALIZED(mm) (DEFAULT_MOUSE_DPI/25.4 * mm)
 
@@ -147,6 +151,25 @@ enum tp_edge {
 	EDGE_BOTTOM = bit(1),
 };
 
+/* Zones a point is in, see tp_zones_rebuild() */
+enum tp_zone {
+	TP_ZONE_PALM_SIDE = bit(0),
+	TP_ZONE_PALM_TOP = bit(1),
+	TP_ZONE_BOTTOM_AREA = bit(2),
+	TP_ZONE_BOTTOM_MIDDLE = bit(3),
+	TP_ZONE_BOTTOM_RIGHT = bit(4),
+	TP_ZONE_TOP_AREA = bit(5),
+	TP_ZONE_TOP_MIDDLE = bit(6),
+	TP_ZONE_TOP_RIGHT = bit(7),
+	TP_ZONE_EDGE_SCROLL_RIGHT = bit(8),
+	TP_ZONE_EDGE_SCROLL_BOTTOM = bit(9),
+	TP_ZONE_TAP_EDGE_X = bit(10),
+	TP_ZONE_TAP_EDGE_Y = bit(11),
+};
+
+/* Two boundaries per threshold, see tp_zones_rebuild() */
+#define TP_ZONE_MAX_INTERVALS 32
+
 enum tp_edge_scroll_touch_state {
 	EDGE_SCROLL_TOUCH_STATE_NONE,
 	EDGE_SCROLL_TOUCH_STATE_EDGE_NEW,
@@ -189,20 +212,43 @@ enum tp_jump_state {
 	JUMP_STATE_EXPECT_DELAY,
 };
 
+/**
+ * Per-touch state, tp_for_each_touch() walks all of these several times
+ * per frame. The fields used on every frame come first, the timers are
+ * in struct tp_touch_cold.
+ */
 struct tp_touch {
 	struct tp_dispatch *tp;
 	unsigned int index;
 	enum touch_state state;
 	bool has_ended; /* TRACKING_ID == -1 */
 	bool dirty;
+	bool was_down; /* if distance == 0, false for pure hovering
+			  touches */
+	bool is_tool_palm; /* MT_TOOL_PALM */
 	struct device_coords point;
-	usec_t initial_time;
 	int pressure;
-	bool is_tool_palm; /* MT_TOOL_PALM */
 	int major, minor;
 
-	bool was_down; /* if distance == 0, false for pure hovering
-			  touches */
+	struct {
+		struct tp_history_point {
+			usec_t time;
+			struct device_coords point;
+		} samples[TOUCHPAD_HISTORY_LENGTH];
+		unsigned int index;
+		unsigned int count;
+
+		/* Updated once per tp_motion_history_push(), from the two
+		 * most recent samples. Read these instead of recalculating
+		 * from the samples. */
+		struct tp_history_stats {
+			struct device_coords delta; /* zero if count <= 1 */
+			double velocity;            /* mm/s */
+			/* Distance travelled since the touch began, not
+			 * reset with the history */
+			double travel_mm;
+		} stats;
+	} history;
 
 	struct {
 		/* A quirk mostly used on Synaptics touchpads. In a
@@ -213,15 +259,6 @@ struct tp_touch {
 		bool reset_motion_history;
 	} quirks;
 
-	struct {
-		struct tp_history_point {
-			usec_t time;
-			struct device_coords point;
-		} samples[TOUCHPAD_HISTORY_LENGTH];
-		unsigned int index;
-		unsigned int count;
-	} history;
-
 	struct {
 		double last_delta_mm;
 	} jumps;
@@ -231,6 +268,13 @@ struct tp_touch {
 		uint8_t x_motion_history;
 	} hysteresis;
 
+	struct {
+		double last_speed; /* speed in mm/s at last sample */
+		unsigned int exceeded_count;
+	} speed;
+
+	usec_t initial_time;
+
 	/* A pinned touchpoint is the one that pressed the physical button
 	 * on a clickpad. After the release, it won't move until the center
 	 * moves more than a threshold away from the original coordinates
@@ -240,12 +284,11 @@ struct tp_touch {
 		struct device_coords center;
 	} pinned;
 
-	/* Software-button state and timeout if applicable */
+	/* Software-button state, the timer is in struct tp_touch_cold */
 	struct {
 		enum button_state state;
 		/* We use button_event here so we can use == on events */
 		enum button_event current;
-		struct libinput_timer timer;
 		struct device_coords initial;
 		bool has_moved; /* has moved more than threshold */
 		usec_t initial_time;
@@ -258,11 +301,11 @@ struct tp_touch {
 		bool is_palm;
 	} tap;
 
+	/* the timer is in struct tp_touch_cold */
 	struct {
 		enum tp_edge_scroll_touch_state edge_state;
 		uint32_t edge;
 		int direction;
-		struct libinput_timer timer;
 		struct device_coords initial;
 	} scroll;
 
@@ -277,14 +320,27 @@ struct tp_touch {
 	} gesture;
 
 	struct {
-		double last_speed; /* speed in mm/s at last sample */
-		unsigned int exceeded_count;
-	} speed;
-
-	struct {
-		double cumulative_distance_mm;
 		bool distance_exceeded;
 	} dwt;
+
+	/* Thumb classification, updated once per touch update by
+	 * tp_thumb_update_touch() */
+	struct {
+		struct device_coords initial; /* where the touch landed */
+		bool in_exclusion_area;
+		bool pressure_size; /* pressure/size look like a thumb */
+		bool fast;          /* above the speed threshold for a while */
+		bool needs_jail;
+	} thumb;
+};
+
+/**
+ * The parts of a touch that are only needed when a timer is set or
+ * fires, indexed like tp->touches.
+ */
+struct tp_touch_cold {
+	struct libinput_timer button_timer;
+	struct libinput_timer scroll_timer;
 };
 
 enum suspend_trigger {
@@ -316,6 +372,12 @@ struct tp_dispatch {
 	unsigned int num_slots;     /* number of slots */
 	unsigned int ntouches;      /* no slots inc. fakes */
 	struct tp_touch *touches;   /* len == ntouches */
+	struct tp_touch_cold *touches_cold; /* len == ntouches */
+	/* bitmasks indexed like touches, NLONGS(ntouches) long. A bit in
+	 * dirty_mask is set iff t->dirty, a bit in active_mask iff
+	 * t->state != TOUCH_NONE. Use the helpers below to modify those. */
+	unsigned long *dirty_mask;
+	unsigned long *active_mask;
 	/* bit 0: BTN_TOUCH
 	 * bit 1: BTN_TOOL_FINGER
 	 * bit 2: BTN_TOOL_DOUBLETAP
@@ -369,10 +431,20 @@ struct tp_dispatch {
 		enum tp_gesture_state state;
 		struct tp_touch *touches[2];
 		usec_t initial_time;
-		double initial_distance;
-		double prev_scale;
-		double angle;
-		struct device_float_coords center;
+
+		/* Geometry of touches[0] and touches[1] during a pinch,
+		 * only updated when either touch moves */
+		struct {
+			struct device_coords first, second;
+			struct normalized_coords vector; /* second → first */
+			double initial_distance2;        /* squared */
+			double scale;
+			double prev_scale; /* last scale sent */
+			double angle_delta; /* degrees, since the last update */
+			struct device_float_coords center;
+			struct device_float_coords center_delta;
+		} pinch;
+
 		struct libinput_timer hold_timer;
 		bool hold_enabled;
 
@@ -462,6 +534,31 @@ struct tp_dispatch {
 		} edges;
 	} tap;
 
+	struct {
+		struct libinput_device_config_prediction config;
+		usec_t horizon; /* 0 if disabled */
+		struct normalized_coords velocity; /* per ms, smoothed */
+		usec_t last_time; /* of the last motion, 0 after a stop */
+		bool pending; /* last motion carried a prediction */
+		bool posted;  /* motion posted in the current frame */
+		struct libinput_timer timer; /* ends it if no frame follows */
+	} prediction;
+
+	struct {
+		/* Estimated interval between hardware frames, 0 until
+		 * measured. See tp_frame_interval() */
+		usec_t interval;
+		usec_t last_frame_time;
+		usec_t last_msc_timestamp;
+
+		/* Frame merging, see AttrTouchpadMaxFrameRate */
+		usec_t min_interval; /* 0 if disabled */
+		usec_t last_processed;
+		usec_t pending_time; /* 0 if no frame is pending */
+		unsigned int fake_touches;
+		struct libinput_timer timer;
+	} frame_rate;
+
 	struct {
 		struct libinput_device_config_3fg_drag config;
 		size_t nfingers;
@@ -517,6 +614,9 @@ struct tp_dispatch {
 		bool keyboard_active;
 		struct libinput_timer keyboard_timer;
 		usec_t keyboard_last_press_time;
+		/* The timer is only moved forward when it fires, see
+		 * tp_keyboard_timeout() */
+		usec_t keyboard_active_until;
 	} dwt;
 
 	struct {
@@ -570,6 +670,17 @@ struct tp_dispatch {
 		struct evdev_device *tablet_device;
 		bool tablet_left_handed_state;
 	} left_handed;
+
+	/* The zones of a point are x.zones[i] & y.zones[j] where i and j
+	 * are the intervals the coordinates fall into. Rebuilt by
+	 * tp_zones_rebuild() whenever one of the edges changes. */
+	struct tp_zone_map {
+		struct tp_zone_axis {
+			int32_t start[TP_ZONE_MAX_INTERVALS];
+			uint32_t zones[TP_ZONE_MAX_INTERVALS];
+			size_t ninterval;
+		} x, y;
+	} zones;
 };
 
 static inline struct tp_dispatch *
@@ -580,9 +691,83 @@ tp_dispatch(struct evdev_dispatch *dispatch)
 	return container_of(dispatch, struct tp_dispatch, base);
 }
 
+/**
+ * The interval between two processed frames, either measured or
+ * TP_REFERENCE_FRAME_INTERVAL if we don't know yet. Test devices always
+ * use the reference interval. Where frames are merged, we never process
+ * them faster than the configured maximum frame rate.
+ */
+static inline usec_t
+tp_frame_interval(const struct tp_dispatch *tp)
+{
+	usec_t interval = tp->frame_rate.interval;
+
+	if (usec_is_zero(interval) ||
+	    tp->device->model_flags & EVDEV_MODEL_TEST_DEVICE)
+		interval = TP_REFERENCE_FRAME_INTERVAL;
+
+	if (usec_cmp(tp->frame_rate.min_interval, interval) > 0)
+		interval = tp->frame_rate.min_interval;
+
+	return interval;
+}
+
+/**
+ * Scale a number of frames at the reference frame rate to the same
+ * duration at this touchpad's frame rate.
+ */
+static inline unsigned int
+tp_scale_frame_count(const struct tp_dispatch *tp, unsigned int count)
+{
+	double scale = (double)usec_as_uint64_t(TP_REFERENCE_FRAME_INTERVAL) /
+		       usec_as_uint64_t(tp_frame_interval(tp));
+
+	return max(1U, (unsigned int)round(count * scale));
+}
+
+static inline struct tp_touch_cold *
+tp_touch_cold(struct tp_touch *t)
+{
+	return &t->tp->touches_cold[t->index];
+}
+
 #define tp_for_each_touch(_tp, _t) \
 	for (unsigned int _i = 0; _i < (_tp)->ntouches && (_t = &(_tp)->touches[_i]); _i++)
 
+#define tp_for_each_touch_in_mask_(_tp, _mask, _t)                                 \
+	for (int _i = long_find_next_bit(_mask, NLONGS((_tp)->ntouches), 0);       \
+	     _i >= 0 && (_t = &(_tp)->touches[_i]);                                 \
+	     _i = long_find_next_bit(_mask, NLONGS((_tp)->ntouches), _i + 1))
+
+/* All touches with t->dirty set */
+#define tp_for_each_dirty_touch(_tp, _t) \
+	tp_for_each_touch_in_mask_(_tp, (_tp)->dirty_mask, _t)
+
+/* All touches not in TOUCH_NONE */
+#define tp_for_each_active_touch(_tp, _t) \
+	tp_for_each_touch_in_mask_(_tp, (_tp)->active_mask, _t)
+
+static inline void
+tp_touch_set_dirty(struct tp_dispatch *tp, struct tp_touch *t)
+{
+	t->dirty = true;
+	long_set_bit(tp->dirty_mask, t->index);
+}
+
+static inline void
+tp_touch_clear_dirty(struct tp_dispatch *tp, struct tp_touch *t)
+{
+	t->dirty = false;
+	long_clear_bit(tp->dirty_mask, t->index);
+}
+
+static inline void
+tp_touch_set_state(struct tp_dispatch *tp, struct tp_touch *t, enum touch_state state)
+{
+	t->state = state;
+	long_set_bit_state(tp->active_mask, t->index, state != TOUCH_NONE);
+}
+
 static inline struct libinput *
 tp_libinput_context(const struct tp_dispatch *tp)
 {
@@ -634,6 +819,12 @@ tp_filter_motion(struct tp_dispatch *tp,
 		 const struct device_float_coords *unaccelerated,
 		 usec_t time);
 
+void
+tp_notify_pointer_motion(struct tp_dispatch *tp,
+			 usec_t time,
+			 const struct normalized_coords *delta,
+			 const struct device_float_coords *unaccel);
+
 struct normalized_coords
 tp_filter_motion_unaccelerated(struct tp_dispatch *tp,
 			       const struct device_float_coords *unaccelerated,
@@ -647,6 +838,33 @@ tp_filter_scroll(struct tp_dispatch *tp,
 bool
 tp_touch_active(const struct tp_dispatch *tp, const struct tp_touch *t);
 
+void
+tp_zones_rebuild(struct tp_dispatch *tp);
+
+static inline uint32_t
+tp_zone_axis_lookup(const struct tp_zone_axis *axis, int32_t v)
+{
+	size_t lo = 0, hi = axis->ninterval;
+
+	/* start[0] is INT32_MIN, find the last start <= v */
+	while (hi - lo > 1) {
+		size_t mid = (lo + hi) / 2;
+		if (axis->start[mid] <= v)
+			lo = mid;
+		else
+			hi = mid;
+	}
+
+	return axis->zones[lo];
+}
+
+static inline uint32_t
+tp_zones_at(const struct tp_dispatch *tp, struct device_coords point)
+{
+	return tp_zone_axis_lookup(&tp->zones.x, point.x) &
+	       tp_zone_axis_lookup(&tp->zones.y, point.y);
+}
+
 bool
 tp_touch_active_for_gesture(const struct tp_dispatch *tp, const struct tp_touch *t);
 
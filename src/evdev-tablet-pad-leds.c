@@ -202,8 +202,7 @@ pad_get_mode_group(struct pad_dispatch *pad, unsigned int index)
 static inline bool
 is_litest_device(struct evdev_device *device)
 {
-	return !!udev_device_get_property_value(device->udev_device,
-						"LIBINPUT_TEST_DEVICE");
+	return !!evdev_device_get_udev_property(device, "LIBINPUT_TEST_DEVICE");
 }
 
 static inline struct pad_mode_toggle_button *
@@ -247,9 +246,8 @@ pad_led_get_sysfs_base_path(struct evdev_device *device)
 
 	/* For testing purposes only allow for a base path set through a
 	 * udev rule. We still expect the normal directory hierarchy inside */
-	test_path =
-		udev_device_get_property_value(udev_device,
-					       "LIBINPUT_TEST_TABLET_PAD_SYSFS_PATH");
+	test_path = evdev_device_get_udev_property(device,
+						   "LIBINPUT_TEST_TABLET_PAD_SYSFS_PATH");
 	if (test_path)
 		return safe_strdup(test_path);
 
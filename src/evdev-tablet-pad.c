@@ -794,30 +794,22 @@ pad_init(struct pad_dispatch *pad, struct evdev_device *device)
 	struct libinput *li = evdev_libinput_context(device);
 	WacomDevice *wacom = NULL;
 #ifdef HAVE_LIBWACOM
-	WacomDeviceDatabase *db = libinput_libwacom_ref(li);
-	if (db) {
-		char event_path[64];
-		snprintf(event_path,
-			 sizeof(event_path),
-			 "/dev/input/%s",
-			 evdev_device_get_sysname(device));
-		wacom = libwacom_new_from_path(db, event_path, WFALLBACK_NONE, NULL);
-		if (!wacom) {
-			wacom = libwacom_new_from_usbid(
-				db,
-				evdev_device_get_id_vendor(device),
-				evdev_device_get_id_product(device),
-				NULL);
-		}
-		if (!wacom) {
-			evdev_log_info(
-				device,
-				"device \"%s\" (%04x:%04x) is not known to libwacom\n",
-				evdev_device_get_name(device),
-				evdev_device_get_id_vendor(device),
-				evdev_device_get_id_product(device));
-		}
+	usec_t start = usec_from_now();
+	/* owned by the context's libwacom cache */
+	wacom = libinput_libwacom_get_device(li,
+					     evdev_device_get_sysname(device),
+					     evdev_device_get_id_bustype(device),
+					     evdev_device_get_id_vendor(device),
+					     evdev_device_get_id_product(device),
+					     evdev_device_get_name(device));
+	if (!wacom) {
+		evdev_log_info(device,
+			       "device \"%s\" (%04x:%04x) is not known to libwacom\n",
+			       evdev_device_get_name(device),
+			       evdev_device_get_id_vendor(device),
+			       evdev_device_get_id_product(device));
 	}
+	evdev_timing_add(device, EVDEV_TIMING_LIBWACOM, start);
 #endif
 
 	pad->base.dispatch_type = DISPATCH_TABLET_PAD;
@@ -847,12 +839,6 @@ pad_init(struct pad_dispatch *pad, struct evdev_device *device)
 	/* at most 5 "Multiple EV_ABS events" log messages per hour */
 	ratelimit_init(&pad->duplicate_abs_limit, usec_from_seconds(60 * 60), 5);
 
-#ifdef HAVE_LIBWACOM
-	if (wacom)
-		libwacom_destroy(wacom);
-	if (db)
-		libinput_libwacom_unref(li);
-#endif
 	return rc;
 }
 
@@ -2924,35 +2924,28 @@ tablet_init(struct tablet_dispatch *tablet, struct evdev_device *device)
 	WacomDevice *wacom = NULL;
 #ifdef HAVE_LIBWACOM
 	struct libinput *li = evdev_libinput_context(device);
-	WacomDeviceDatabase *db = libinput_libwacom_ref(li);
-	if (db) {
-		char event_path[64];
-		snprintf(event_path,
-			 sizeof(event_path),
-			 "/dev/input/%s",
-			 evdev_device_get_sysname(device));
-		wacom = libwacom_new_from_path(db, event_path, WFALLBACK_NONE, NULL);
-		if (!wacom) {
-			wacom = libwacom_new_from_usbid(
-				db,
-				evdev_device_get_id_vendor(device),
-				evdev_device_get_id_product(device),
-				NULL);
-		}
-		if (!wacom) {
-			evdev_log_info(
-				device,
-				"device \"%s\" (%04x:%04x) is not known to libwacom\n",
-				evdev_device_get_name(device),
-				evdev_device_get_id_vendor(device),
-				evdev_device_get_id_product(device));
-		}
+	usec_t start = usec_from_now();
+	/* owned by the context's libwacom cache */
+	wacom = libinput_libwacom_get_device(li,
+					     evdev_device_get_sysname(device),
+					     evdev_device_get_id_bustype(device),
+					     evdev_device_get_id_vendor(device),
+					     evdev_device_get_id_product(device),
+					     evdev_device_get_name(device));
+	if (!wacom) {
+		evdev_log_info(device,
+			       "device \"%s\" (%04x:%04x) is not known to libwacom\n",
+			       evdev_device_get_name(device),
+			       evdev_device_get_id_vendor(device),
+			       evdev_device_get_id_product(device));
 	}
+	evdev_timing_add(device, EVDEV_TIMING_LIBWACOM, start);
 #endif
 
 	tablet->tablet_id = ++tablet_ids;
 	tablet->base.dispatch_type = DISPATCH_TABLET;
 	tablet->base.interface = &tablet_interface;
+	tablet->base.pairing_wants = bit(EVDEV_PAIRING_TOUCH);
 	tablet->device = device;
 	tablet->status = TABLET_NONE;
 	tablet->current_tool.type = LIBINPUT_TOOL_NONE;
@@ -2998,12 +2991,6 @@ tablet_init(struct tablet_dispatch *tablet, struct evdev_device *device)
 
 	rc = 0;
 out:
-#ifdef HAVE_LIBWACOM
-	if (wacom)
-		libwacom_destroy(wacom);
-	if (db)
-		libinput_libwacom_unref(li);
-#endif
 	return rc;
 }
 
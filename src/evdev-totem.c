@@ -836,6 +836,8 @@ evdev_totem_create(struct evdev_device *device)
 	totem->device = device;
 	totem->base.dispatch_type = DISPATCH_TOTEM;
 	totem->base.interface = &totem_interface;
+	/* pairs by vid/pid, virtual devices may not have a device group */
+	totem->base.pairing_wants = bit(EVDEV_PAIRING_ANY);
 
 	num_slots = libevdev_get_num_slots(device->evdev);
 	if (num_slots <= 0)
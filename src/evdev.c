@@ -29,10 +29,12 @@
 #include <assert.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <inttypes.h>
 #include <math.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/ioctl.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
@@ -106,19 +108,29 @@ parse_udev_flag(struct evdev_device *device,
 	const char *val;
 	bool b;
 
-	val = udev_device_get_property_value(udev_device, property);
-	if (!val)
-		return false;
+	/* The device's own properties come from the cached snapshot, the
+	 * parsed value is cached there too */
+	if (udev_device == device->udev_device) {
+		struct udev_property *prop =
+			libinput_device_find_udev_property(&device->base, property);
+		if (!prop)
+			return false;
 
-	if (!parse_boolean_property(val, &b)) {
-		evdev_log_error(device,
-				"property %s has invalid value '%s'\n",
-				property,
-				val);
-		return false;
+		val = prop->value;
+		if (udev_property_get_bool(prop, &b))
+			return b;
+	} else {
+		val = udev_device_get_property_value(udev_device, property);
+		if (!val)
+			return false;
+
+		if (parse_boolean_property(val, &b))
+			return b;
 	}
 
-	return b;
+	evdev_log_error(device, "property %s has invalid value '%s'\n", property, val);
+
+	return false;
 }
 
 int
@@ -133,17 +145,16 @@ evdev_update_key_down_count(struct evdev_device *device,
 	unsigned int code = evdev_usage_code(usage);
 
 	if (pressed) {
-		key_count = ++device->key_count[code];
+		key_count = key_count_inc(&device->key_count, code);
 	} else {
-		if (device->key_count[code] > 0) {
-			key_count = --device->key_count[code];
+		if (key_count_is_down(&device->key_count, code)) {
+			key_count = key_count_dec(&device->key_count, code);
 		} else {
 			evdev_log_bug_libinput(
 				device,
-				"releasing key %s (%#x) with count %d\n",
+				"releasing key %s (%#x) with count 0\n",
 				libevdev_event_code_get_name(EV_KEY, code),
-				evdev_usage_as_uint32_t(usage),
-				device->key_count[code]);
+				evdev_usage_as_uint32_t(usage));
 		}
 	}
 
@@ -507,7 +518,7 @@ evdev_tag_trackpoint(struct evdev_device *device, struct udev_device *udev_devic
 
 	device->tags |= EVDEV_TAG_TRACKPOINT;
 
-	udev_prop = udev_device_get_property_value(udev_device, "ID_INTEGRATION");
+	udev_prop = evdev_device_get_udev_property(device, "ID_INTEGRATION");
 	if (udev_prop) {
 		if (streq(udev_prop, "internal")) {
 			/* noop, this is the default anyway */
@@ -561,7 +572,7 @@ evdev_tag_keyboard(struct evdev_device *device, struct udev_device *udev_device)
 			return;
 	}
 
-	udev_prop = udev_device_get_property_value(udev_device, "ID_INTEGRATION");
+	udev_prop = evdev_device_get_udev_property(device, "ID_INTEGRATION");
 	if (udev_prop) {
 		if (streq(udev_prop, "internal"))
 			evdev_tag_keyboard_internal(device);
@@ -1024,24 +1035,96 @@ libinput_device_dispatch_frame(struct libinput_device *device,
 	evdev_device_dispatch_frame(libinput, dev, frame);
 }
 
+/**
+ * The largest possible resync: every key, switch, LED and axis changed
+ * plus every slot. libevdev < 1.9 may end and restart a touch within the
+ * same slot, hence the extra tracking id per slot.
+ */
+static size_t
+evdev_sync_frame_size(struct evdev_device *device)
+{
+	struct libevdev *evdev = device->evdev;
+	const struct {
+		unsigned int type, max;
+	} types[] = {
+		{ EV_KEY, KEY_MAX },
+		{ EV_SW, SW_MAX },
+		{ EV_LED, LED_MAX },
+		{ EV_ABS, ABS_MAX },
+	};
+	int nslots = libevdev_get_num_slots(evdev);
+	size_t size = 1; /* SYN_REPORT */
+	size_t nmt = 0;
+
+	ARRAY_FOR_EACH(types, t) {
+		for (unsigned int code = 0; code <= t->max; code++) {
+			if (!libevdev_has_event_code(evdev, t->type, code))
+				continue;
+
+			if (t->type == EV_ABS && nslots > 0 &&
+			    code > ABS_MT_SLOT)
+				nmt++;
+			else
+				size++;
+		}
+	}
+
+	if (nslots > 0)
+		size += nslots * (nmt + 2);
+
+	return size;
+}
+
 static int
 evdev_sync_device(struct libinput *libinput, struct evdev_device *device)
 {
 	struct input_event ev;
+	struct evdev_frame *frame;
+	bool overflow = false;
 	int rc;
-	const size_t maxevents = 256;
-	_unref_(evdev_frame) *frame = evdev_frame_new(maxevents);
 
+	if (!device->syn_dropped.frame)
+		device->syn_dropped.frame =
+			evdev_frame_new(evdev_sync_frame_size(device));
+
+	frame = device->syn_dropped.frame;
+	evdev_frame_reset(frame);
+
+	/* libevdev only gives us the delta to the state it had before the
+	 * SYN_DROPPED, i.e. the state we have processed. */
 	do {
 		rc = libevdev_next_event(device->evdev, LIBEVDEV_READ_FLAG_SYNC, &ev);
 		if (rc < 0)
 			break;
 
-		/* No ENOMEM check here because >maxevents really should never happen */
-		evdev_frame_append_input_event(frame, &ev);
+		/* Back-to-back ABS_MT_SLOT events are slots without
+		 * changes, only the last one is needed */
+		if (ev.type == EV_ABS && ev.code == ABS_MT_SLOT) {
+			size_t nevents;
+			struct evdev_event *events =
+				evdev_frame_get_events(frame, &nevents);
+
+			if (nevents > 1 &&
+			    evdev_usage_eq(events[nevents - 2].usage,
+					   EVDEV_ABS_MT_SLOT)) {
+				events[nevents - 2].value = ev.value;
+				continue;
+			}
+		}
+
+		if (evdev_frame_append_input_event(frame, &ev) == -ENOMEM)
+			overflow = true;
 	} while (rc == LIBEVDEV_READ_STATUS_SYNC);
 
-	evdev_device_dispatch_frame(libinput, device, frame);
+	if (overflow)
+		evdev_log_bug_libinput(device,
+				       "sync frame overflow, discarding events.\n");
+
+	device->syn_dropped.nevents += evdev_frame_get_count(frame) - 1;
+
+	/* Nothing changed while we weren't looking */
+	if (!evdev_frame_is_empty(frame))
+		evdev_device_dispatch_frame(libinput, device, frame);
 
 	return rc == -EAGAIN ? 0 : rc;
 }
@@ -1073,6 +1156,37 @@ evdev_note_time_delay(struct evdev_device *device, const struct input_event *ev)
 	}
 }
 
+static inline void
+evdev_note_syn_dropped(struct evdev_device *device)
+{
+	usec_t now = libinput_now(evdev_libinput_context(device));
+
+	if (device->syn_dropped.count++ == 0)
+		device->syn_dropped.first = now;
+	device->syn_dropped.last = now;
+
+	evdev_log_info_ratelimit(device,
+				 &device->syn_drop_limit,
+				 "SYN_DROPPED event - some input events have been lost.\n");
+}
+
+static void
+evdev_log_syn_dropped(struct evdev_device *device)
+{
+	usec_t now = libinput_now(evdev_libinput_context(device));
+
+	if (device->syn_dropped.count == 0)
+		return;
+
+	evdev_log_info(device,
+		       "%u SYN_DROPPED events over %us, %" PRIu64 " events "
+		       "resynced, last one %us ago\n",
+		       device->syn_dropped.count,
+		       usec_to_seconds(usec_sub(now, device->syn_dropped.first)),
+		       device->syn_dropped.nevents,
+		       usec_to_seconds(usec_sub(now, device->syn_dropped.last)));
+}
+
 static void
 evdev_device_dispatch(void *data)
 {
@@ -1089,10 +1203,7 @@ evdev_device_dispatch(void *data)
 	do {
 		rc = libevdev_next_event(device->evdev, LIBEVDEV_READ_FLAG_NORMAL, &ev);
 		if (rc == LIBEVDEV_READ_STATUS_SYNC) {
-			evdev_log_info_ratelimit(
-				device,
-				&device->syn_drop_limit,
-				"SYN_DROPPED event - some input events have been lost.\n");
+			evdev_note_syn_dropped(device);
 
 			/* send one more sync event so we handle all
 			   currently pending events before we sync up
@@ -1324,7 +1435,7 @@ evdev_read_wheel_click_prop(struct evdev_device *device,
 	int val;
 
 	*angle = DEFAULT_WHEEL_CLICK_ANGLE;
-	prop = udev_device_get_property_value(device->udev_device, prop);
+	prop = evdev_device_get_udev_property(device, prop);
 	if (!prop)
 		return false;
 
@@ -1349,7 +1460,7 @@ evdev_read_wheel_click_count_prop(struct evdev_device *device,
 {
 	int val;
 
-	prop = udev_device_get_property_value(device->udev_device, prop);
+	prop = evdev_device_get_udev_property(device, prop);
 	if (!prop)
 		return false;
 
@@ -1446,7 +1557,7 @@ evdev_read_dpi_prop(struct evdev_device *device)
 	if (device->tags & EVDEV_TAG_TRACKPOINT)
 		return DEFAULT_MOUSE_DPI;
 
-	mouse_dpi = udev_device_get_property_value(device->udev_device, "MOUSE_DPI");
+	mouse_dpi = evdev_device_get_udev_property(device, "MOUSE_DPI");
 	if (mouse_dpi) {
 		dpi = parse_mouse_dpi_property(mouse_dpi);
 		if (!dpi) {
@@ -2084,33 +2195,245 @@ evdev_configure_device(struct evdev_device *device,
 	return fallback_dispatch_create(&device->base);
 }
 
+static void
+evdev_log_timing(struct evdev_device *device)
+{
+	usec_t total = usec_from_uint64_t(0);
+
+	if (!log_is_logged(evdev_libinput_context(device), LIBINPUT_LOG_PRIORITY_DEBUG))
+		return;
+
+	device->timing[EVDEV_TIMING_QUIRKS] = device->base.quirks_time;
+
+	/* libwacom is part of the dispatch time, the quirks are fetched
+	 * before we configure the device */
+	ARRAY_FOR_EACH(device->timing, t) {
+		if (t - device->timing == EVDEV_TIMING_LIBWACOM)
+			continue;
+		total = usec_add(total, *t);
+	}
+
+#define ms(which_) (usec_as_uint64_t(device->timing[which_]) / 1000.0)
+	evdev_log_debug(device,
+			"timing: open %.2fms, libevdev %.2fms, quirks %.2fms, "
+			"libwacom %.2fms, dispatch %.2fms, plugins %.2fms, "
+			"pairing %.2fms, total %.2fms\n",
+			ms(EVDEV_TIMING_OPEN),
+			ms(EVDEV_TIMING_LIBEVDEV),
+			ms(EVDEV_TIMING_QUIRKS),
+			ms(EVDEV_TIMING_LIBWACOM),
+			ms(EVDEV_TIMING_DISPATCH),
+			ms(EVDEV_TIMING_PLUGINS),
+			ms(EVDEV_TIMING_PAIRING),
+			usec_as_uint64_t(total) / 1000.0);
+#undef ms
+}
+
+static uint32_t
+evdev_pairing_roles(struct evdev_device *device)
+{
+	uint32_t roles = bit(EVDEV_PAIRING_ANY);
+
+	if (device->tags & EVDEV_TAG_KEYBOARD)
+		roles |= bit(EVDEV_PAIRING_KEYBOARD);
+	if (device->tags & EVDEV_TAG_TRACKPOINT)
+		roles |= bit(EVDEV_PAIRING_TRACKPOINT);
+	if (device->tags & EVDEV_TAG_LID_SWITCH)
+		roles |= bit(EVDEV_PAIRING_LID_SWITCH);
+	if (device->tags & EVDEV_TAG_TABLET_MODE_SWITCH)
+		roles |= bit(EVDEV_PAIRING_TABLET_MODE_SWITCH);
+	if (device->seat_caps & EVDEV_DEVICE_TABLET)
+		roles |= bit(EVDEV_PAIRING_TABLET);
+	if ((device->seat_caps & EVDEV_DEVICE_TOUCH) ||
+	    ((device->seat_caps & EVDEV_DEVICE_POINTER) &&
+	     (device->tags & EVDEV_TAG_EXTERNAL_TOUCHPAD)))
+		roles |= bit(EVDEV_PAIRING_TOUCH);
+	if (device->tags & EVDEV_TAG_EXTERNAL_MOUSE)
+		roles |= bit(EVDEV_PAIRING_EXTERNAL_MOUSE);
+
+	return roles;
+}
+
+static inline struct list *
+evdev_pairing_role_list(struct evdev_device *device, unsigned int role)
+{
+	if (bit(role) & EVDEV_PAIRING_GROUP_ROLES)
+		return &device->base.group->pairing.role[role];
+
+	return &device->base.seat->pairing.role[role];
+}
+
+static inline struct list *
+evdev_pairing_wanted_by_list(struct evdev_device *device, unsigned int role)
+{
+	if (bit(role) & EVDEV_PAIRING_GROUP_ROLES)
+		return &device->base.group->pairing.wanted_by[role];
+
+	return &device->base.seat->pairing.wanted_by[role];
+}
+
+/**
+ * Returns true if the device wanting the roles of other was already
+ * notified through a role lower than role.
+ */
+static inline bool
+evdev_pairing_seen(struct evdev_device *wanting,
+		   struct evdev_device *other,
+		   unsigned int role)
+{
+	uint32_t common = wanting->pairing.wants & other->pairing.roles;
+
+	if (wanting->base.group != other->base.group)
+		common &= ~EVDEV_PAIRING_GROUP_ROLES;
+
+	return (common & (bit(role) - 1)) != 0;
+}
+
+static void
+evdev_pairing_register(struct evdev_device *device)
+{
+	uint32_t wants = device->dispatch->pairing_wants;
+
+	/* Wanting everything means walking the full seat list once */
+	if (wants & bit(EVDEV_PAIRING_ANY))
+		wants = bit(EVDEV_PAIRING_ANY);
+
+	device->pairing.roles = evdev_pairing_roles(device);
+	device->pairing.wants = wants;
+
+	for (unsigned int r = 0; r < EVDEV_PAIRING_NROLES; r++) {
+		device->pairing.role_link[r].device = device;
+		device->pairing.wants_link[r].device = device;
+
+		if (device->pairing.roles & bit(r))
+			list_append(evdev_pairing_role_list(device, r),
+				    &device->pairing.role_link[r].link);
+		if (device->pairing.wants & bit(r))
+			list_append(evdev_pairing_wanted_by_list(device, r),
+				    &device->pairing.wants_link[r].link);
+	}
+}
+
+static void
+evdev_pairing_unregister(struct evdev_device *device)
+{
+	if (device->pairing.roles == 0)
+		return;
+
+	for (unsigned int r = 0; r < EVDEV_PAIRING_NROLES; r++) {
+		if (device->pairing.roles & bit(r))
+			list_remove(&device->pairing.role_link[r].link);
+		if (device->pairing.wants & bit(r))
+			list_remove(&device->pairing.wants_link[r].link);
+	}
+
+	device->pairing.roles = 0;
+	device->pairing.wants = 0;
+}
+
+enum evdev_pairing_event {
+	PAIRING_ADDED,
+	PAIRING_REMOVED,
+	PAIRING_SUSPENDED,
+	PAIRING_RESUMED,
+};
+
+static inline void
+evdev_pairing_notify(struct evdev_device *device,
+		     struct evdev_device *other,
+		     enum evdev_pairing_event event)
+{
+	struct evdev_dispatch_interface *interface = device->dispatch->interface;
+
+	switch (event) {
+	case PAIRING_ADDED:
+		if (interface->device_added)
+			interface->device_added(device, other);
+		break;
+	case PAIRING_REMOVED:
+		if (interface->device_removed)
+			interface->device_removed(device, other);
+		break;
+	case PAIRING_SUSPENDED:
+		if (interface->device_suspended)
+			interface->device_suspended(device, other);
+		break;
+	case PAIRING_RESUMED:
+		if (interface->device_resumed)
+			interface->device_resumed(device, other);
+		break;
+	}
+}
+
+/**
+ * Notify every other device on the seat that wants one of the roles of
+ * device. A device in several of the wanted_by lists is only notified
+ * through the first one.
+ */
+static void
+evdev_pairing_notify_others(struct evdev_device *device,
+			    enum evdev_pairing_event event)
+{
+	uint32_t roles = device->pairing.roles;
+
+	for (unsigned int r = 0; r < EVDEV_PAIRING_NROLES; r++) {
+		struct evdev_pairing_link *l;
+
+		if ((roles & bit(r)) == 0)
+			continue;
+
+		list_for_each(l, evdev_pairing_wanted_by_list(device, r), link) {
+			struct evdev_device *d = l->device;
+
+			if (d == device || evdev_pairing_seen(d, device, r))
+				continue;
+
+			evdev_pairing_notify(d, device, event);
+		}
+	}
+}
+
 static void
 evdev_notify_added_device(struct evdev_device *device)
 {
-	struct libinput_device *dev;
+	usec_t start = usec_from_now();
+
+	evdev_pairing_register(device);
 
-	list_for_each(dev, &device->base.seat->devices_list, link) {
-		struct evdev_device *d = evdev_device(dev);
-		if (dev == &device->base)
+	/* Notify existing devices about addition of device */
+	evdev_pairing_notify_others(device, PAIRING_ADDED);
+
+	/* Notify new device about existing devices it can pair with and
+	 * whether those are suspended */
+	uint32_t wants = device->pairing.wants;
+	for (unsigned int r = 0; r < EVDEV_PAIRING_NROLES; r++) {
+		struct evdev_pairing_link *l;
+
+		if ((wants & bit(r)) == 0)
 			continue;
 
-		/* Notify existing device d about addition of device */
-		if (d->dispatch->interface->device_added)
-			d->dispatch->interface->device_added(d, device);
+		list_for_each(l, evdev_pairing_role_list(device, r), link) {
+			struct evdev_device *d = l->device;
 
-		/* Notify new device about existing device d */
-		if (device->dispatch->interface->device_added)
-			device->dispatch->interface->device_added(device, d);
+			if (d == device || evdev_pairing_seen(device, d, r))
+				continue;
 
-		/* Notify new device if existing device d is suspended */
-		if (d->is_suspended && device->dispatch->interface->device_suspended)
-			device->dispatch->interface->device_suspended(device, d);
+			evdev_pairing_notify(device, d, PAIRING_ADDED);
+			if (d->is_suspended)
+				evdev_pairing_notify(device, d, PAIRING_SUSPENDED);
+		}
 	}
+	evdev_timing_add(device, EVDEV_TIMING_PAIRING, start);
 
+	/* this is mostly the plugins' device_added callbacks */
+	start = usec_from_now();
 	notify_added_device(&device->base);
+	evdev_timing_add(device, EVDEV_TIMING_PLUGINS, start);
 
+	start = usec_from_now();
 	if (device->dispatch->interface->post_added)
 		device->dispatch->interface->post_added(device, device->dispatch);
+	evdev_timing_add(device, EVDEV_TIMING_PAIRING, start);
 }
 
 static bool
@@ -2146,6 +2469,53 @@ evdev_device_have_same_syspath(struct udev_device *udev_device, int fd)
 #endif
 }
 
+static inline uint64_t
+caps_hash_update(uint64_t hash, const void *data, size_t len)
+{
+	const unsigned char *bytes = data;
+
+	for (size_t i = 0; i < len; i++) {
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ULL;
+	}
+
+	return hash;
+}
+
+/**
+ * FNV-1a hash over the kernel's view of the device's identity and
+ * capabilities. This reads the fd directly rather than the libevdev
+ * context, we enable and disable codes on the latter.
+ */
+static uint64_t
+evdev_device_caps_hash(int fd)
+{
+	const unsigned int types[] = { 0, EV_KEY, EV_REL, EV_ABS,
+				       EV_MSC, EV_SW,  EV_LED };
+	unsigned long bits[NLONGS(KEY_CNT)];
+	struct input_id id = { 0 };
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	int rc;
+
+	rc = ioctl(fd, EVIOCGID, &id);
+	hash = caps_hash_update(hash, &rc, sizeof(rc));
+	hash = caps_hash_update(hash, &id, sizeof(id));
+
+	ARRAY_FOR_EACH(types, type) {
+		memset(bits, 0, sizeof(bits));
+		rc = ioctl(fd, EVIOCGBIT(*type, sizeof(bits)), bits);
+		hash = caps_hash_update(hash, &rc, sizeof(rc));
+		hash = caps_hash_update(hash, bits, sizeof(bits));
+	}
+
+	memset(bits, 0, sizeof(bits));
+	rc = ioctl(fd, EVIOCGPROP(sizeof(bits)), bits);
+	hash = caps_hash_update(hash, &rc, sizeof(rc));
+	hash = caps_hash_update(hash, bits, sizeof(bits));
+
+	return hash;
+}
+
 static bool
 evdev_set_device_group(struct evdev_device *device, struct udev_device *udev_device)
 {
@@ -2153,8 +2523,7 @@ evdev_set_device_group(struct evdev_device *device, struct udev_device *udev_dev
 	struct libinput_device_group *group = NULL;
 	const char *udev_group;
 
-	udev_group =
-		udev_device_get_property_value(udev_device, "LIBINPUT_DEVICE_GROUP");
+	udev_group = evdev_device_get_udev_property(device, "LIBINPUT_DEVICE_GROUP");
 	if (udev_group)
 		group = libinput_device_group_find_group(libinput, udev_group);
 
@@ -2312,53 +2681,120 @@ udev_device_should_be_ignored(struct udev_device *udev_device)
 	return value && !streq(value, "0");
 }
 
-struct evdev_device *
-evdev_device_create(struct libinput_seat *seat, struct udev_device *udev_device)
+int
+evdev_device_probe_open(struct libinput *libinput,
+			struct udev_device *udev_device,
+			struct evdev_device_probe *probe)
 {
-	struct libinput *libinput = seat->libinput;
-	struct evdev_device *device = NULL;
-	int rc;
-	int fd = -1;
-	int unhandled_device = 0;
 	const char *devnode = udev_device_get_devnode(udev_device);
 	_autofree_ char *sysname = str_sanitize(udev_device_get_sysname(udev_device));
+	int fd;
+
+	probe->fd = -1;
+	probe->evdev = NULL;
 
 	if (!devnode) {
 		log_info(libinput, "%s: no device node associated\n", sysname);
-		goto err;
+		return -ENODEV;
 	}
 
 	if (udev_device_should_be_ignored(udev_device)) {
 		log_debug(libinput, "%s: device is ignored\n", sysname);
-		goto err;
+		return -ENODEV;
 	}
 
 	/* Use non-blocking mode so that we can loop on read on
 	 * evdev_device_data() until all events on the fd are
 	 * read. */
+	usec_t start = usec_from_now();
 	fd = open_restricted(libinput, devnode, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+	probe->open_time = usec_sub(usec_from_now(), start);
 	if (fd < 0) {
 		log_info(libinput,
 			 "%s: opening input device '%s' failed (%s).\n",
 			 sysname,
 			 devnode,
 			 strerror(-fd));
-		goto err;
+		return fd;
 	}
 
-	if (!evdev_device_have_same_syspath(udev_device, fd))
+	if (!evdev_device_have_same_syspath(udev_device, fd)) {
+		close_restricted(libinput, fd);
+		return -ENODEV;
+	}
+
+	probe->fd = fd;
+
+	return 0;
+}
+
+void
+evdev_device_probe_run(struct evdev_device_probe *probe)
+{
+	if (probe->fd < 0)
+		return;
+
+	usec_t start = usec_from_now();
+
+	evdev_drain_fd(probe->fd);
+
+	if (libevdev_new_from_fd(probe->fd, &probe->evdev) != 0)
+		probe->evdev = NULL;
+
+	probe->caps_hash = evdev_device_caps_hash(probe->fd);
+
+	probe->libevdev_time = usec_sub(usec_from_now(), start);
+}
+
+void
+evdev_device_probe_cleanup(struct libinput *libinput, struct evdev_device_probe *probe)
+{
+	libevdev_free(probe->evdev);
+	probe->evdev = NULL;
+	if (probe->fd >= 0)
+		close_restricted(libinput, probe->fd);
+	probe->fd = -1;
+}
+
+struct evdev_device *
+evdev_device_create(struct libinput_seat *seat, struct udev_device *udev_device)
+{
+	struct evdev_device_probe probe;
+
+	if (evdev_device_probe_open(seat->libinput, udev_device, &probe) < 0)
+		return NULL;
+
+	evdev_device_probe_run(&probe);
+
+	return evdev_device_create_probed(seat, udev_device, &probe);
+}
+
+struct evdev_device *
+evdev_device_create_probed(struct libinput_seat *seat,
+			   struct udev_device *udev_device,
+			   struct evdev_device_probe *probe)
+{
+	struct libinput *libinput = seat->libinput;
+	struct evdev_device *device = NULL;
+	int fd = probe->fd;
+	int unhandled_device = 0;
+
+	/* The fd and the libevdev context are ours now */
+	probe->fd = -1;
+	if (fd < 0)
 		goto err;
 
 	device = zalloc(sizeof *device);
-	device->sysname = steal(&sysname);
+	device->sysname = str_sanitize(udev_device_get_sysname(udev_device));
+	device->timing[EVDEV_TIMING_OPEN] = probe->open_time;
+	device->timing[EVDEV_TIMING_LIBEVDEV] = probe->libevdev_time;
+	device->caps_hash = probe->caps_hash;
 
 	libinput_device_init(&device->base, seat);
 	libinput_seat_ref(seat);
 
-	evdev_drain_fd(fd);
-
-	rc = libevdev_new_from_fd(fd, &device->evdev);
-	if (rc != 0)
+	device->evdev = steal(&probe->evdev);
+	if (!device->evdev)
 		goto err;
 
 	libevdev_set_clock_id(device->evdev, CLOCK_MONOTONIC);
@@ -2417,12 +2853,16 @@ evdev_device_create(struct libinput_seat *seat, struct udev_device *udev_device)
 		       udev_tags & EVDEV_UDEV_TAG_TRACKBALL ? " Trackball" : "",
 		       udev_tags & EVDEV_UDEV_TAG_SWITCH ? " Switch" : "");
 
+	usec_t start = usec_from_now();
 	libinput_plugin_system_notify_device_new(&libinput->plugin_system,
 						 &device->base,
 						 device->evdev,
 						 device->udev_device);
+	evdev_timing_add(device, EVDEV_TIMING_PLUGINS, start);
 
+	start = usec_from_now();
 	device->dispatch = evdev_configure_device(device, udev_tags);
+	evdev_timing_add(device, EVDEV_TIMING_DISPATCH, start);
 	if (device->dispatch == NULL ||
 	    device->seat_caps == EVDEV_DEVICE_NO_CAPABILITIES)
 		goto err_notify;
@@ -2439,6 +2879,7 @@ evdev_device_create(struct libinput_seat *seat, struct udev_device *udev_device)
 	device->base.inject_evdev_frame = libinput_device_dispatch_frame;
 
 	evdev_notify_added_device(device);
+	evdev_log_timing(device);
 
 	return device;
 
@@ -2576,8 +3017,7 @@ evdev_read_calibration_prop(struct evdev_device *device)
 	const char *prop;
 	float calibration[6];
 
-	prop = udev_device_get_property_value(device->udev_device,
-					      "LIBINPUT_CALIBRATION_MATRIX");
+	prop = evdev_device_get_udev_property(device, "LIBINPUT_CALIBRATION_MATRIX");
 
 	if (prop == NULL)
 		return;
@@ -2602,7 +3042,7 @@ evdev_read_calibration_prop(struct evdev_device *device)
 int
 evdev_read_fuzz_prop(struct evdev_device *device, unsigned int code)
 {
-	const char *prop;
+	struct udev_property *prop;
 	char name[32];
 	int rc;
 	int fuzz = 0;
@@ -2612,11 +3052,11 @@ evdev_read_fuzz_prop(struct evdev_device *device, unsigned int code)
 	if (rc == -1)
 		return 0;
 
-	prop = udev_device_get_property_value(device->udev_device, name);
-	if (prop && (safe_atoi(prop, &fuzz) == false || fuzz < 0)) {
+	prop = libinput_device_find_udev_property(&device->base, name);
+	if (prop && (!udev_property_get_int(prop, &fuzz) || fuzz < 0)) {
 		evdev_log_bug_libinput(device,
 				       "invalid LIBINPUT_FUZZ property value: %s\n",
-				       prop);
+				       prop->value);
 		return 0;
 	}
 
@@ -2885,19 +3325,10 @@ evdev_stop_scroll(struct evdev_device *device,
 void
 evdev_notify_suspended_device(struct evdev_device *device)
 {
-	struct libinput_device *it;
-
 	if (device->is_suspended)
 		return;
 
-	list_for_each(it, &device->base.seat->devices_list, link) {
-		struct evdev_device *d = evdev_device(it);
-		if (it == &device->base)
-			continue;
-
-		if (d->dispatch->interface->device_suspended)
-			d->dispatch->interface->device_suspended(d, device);
-	}
+	evdev_pairing_notify_others(device, PAIRING_SUSPENDED);
 
 	device->is_suspended = true;
 }
@@ -2905,19 +3336,10 @@ evdev_notify_suspended_device(struct evdev_device *device)
 void
 evdev_notify_resumed_device(struct evdev_device *device)
 {
-	struct libinput_device *it;
-
 	if (!device->is_suspended)
 		return;
 
-	list_for_each(it, &device->base.seat->devices_list, link) {
-		struct evdev_device *d = evdev_device(it);
-		if (it == &device->base)
-			continue;
-
-		if (d->dispatch->interface->device_resumed)
-			d->dispatch->interface->device_resumed(d, device);
-	}
+	evdev_pairing_notify_others(device, PAIRING_RESUMED);
 
 	device->is_suspended = false;
 }
@@ -2972,6 +3394,14 @@ evdev_device_resume(struct evdev_device *device)
 		return -ENODEV;
 	}
 
+	/* Same node but e.g. a different firmware mode after the session
+	 * switch, our configuration no longer matches the device */
+	if (evdev_device_caps_hash(fd) != device->caps_hash) {
+		evdev_log_info(device, "device capabilities changed\n");
+		close_restricted(libinput, fd);
+		return -ENODEV;
+	}
+
 	evdev_drain_fd(fd);
 
 	device->fd = fd;
@@ -3000,21 +3430,13 @@ evdev_device_resume(struct evdev_device *device)
 void
 evdev_device_remove(struct evdev_device *device)
 {
-	struct libinput_device *dev;
-
 	evdev_log_info(device, "device removed\n");
+	evdev_log_syn_dropped(device);
 
 	libinput_timer_cancel(&device->scroll.timer);
 	libinput_timer_cancel(&device->middlebutton.timer);
 
-	list_for_each(dev, &device->base.seat->devices_list, link) {
-		struct evdev_device *d = evdev_device(dev);
-		if (dev == &device->base)
-			continue;
-
-		if (d->dispatch->interface->device_removed)
-			d->dispatch->interface->device_removed(d, device);
-	}
+	evdev_pairing_notify_others(device, PAIRING_REMOVED);
 
 	evdev_device_suspend(device);
 
@@ -3025,7 +3447,13 @@ evdev_device_remove(struct evdev_device *device)
 	 * skip re-opening a different device with the same node */
 	device->was_removed = true;
 
+	evdev_pairing_unregister(device);
 	list_remove(&device->base.link);
+	if (device->udev_hash_link.next)
+		list_remove(&device->udev_hash_link);
+
+	/* The quirks belong to the context, the device may outlive it */
+	libinput_device_release_quirks(&device->base);
 
 	notify_removed_device(&device->base);
 	libinput_device_unref(&device->base);
@@ -3043,6 +3471,9 @@ evdev_device_destroy(struct evdev_device *device)
 	if (device->base.group)
 		libinput_device_group_unref(device->base.group);
 
+	libinput_device_release_quirks(&device->base);
+	libinput_device_release_udev_properties(&device->base);
+
 	free(device->log_prefix_name);
 	free(device->sysname);
 	free(device->output_name);
@@ -3052,5 +3483,7 @@ evdev_device_destroy(struct evdev_device *device)
 	libinput_seat_unref(device->base.seat);
 	libevdev_free(device->evdev);
 	udev_device_unref(device->udev_device);
+	evdev_frame_unref(device->syn_dropped.frame);
+	key_count_reset(&device->key_count);
 	free(device);
 }
@@ -83,6 +83,39 @@ enum evdev_device_tags {
 	EVDEV_TAG_KEYPAD_SLIDE_SWITCH = bit(11),
 };
 
+/* The roles a device can play when pairing with other devices, e.g. a
+ * touchpad pairs with keyboards for disable-while-typing. A device may have
+ * several roles. EVDEV_PAIRING_ANY is held by every device, a dispatch that
+ * wants it is notified about all devices on the seat.
+ *
+ * Most roles are indexed per seat, the ones in EVDEV_PAIRING_GROUP_ROLES
+ * only ever pair within the same device group and are indexed per group.
+ */
+enum evdev_pairing_role {
+	EVDEV_PAIRING_KEYBOARD,
+	EVDEV_PAIRING_TRACKPOINT,
+	EVDEV_PAIRING_LID_SWITCH,
+	EVDEV_PAIRING_TABLET_MODE_SWITCH,
+	EVDEV_PAIRING_TABLET,
+	EVDEV_PAIRING_TOUCH, /* touchscreen or external touchpad */
+	EVDEV_PAIRING_EXTERNAL_MOUSE,
+	EVDEV_PAIRING_ANY,
+
+	EVDEV_PAIRING_NROLES,
+};
+
+static_assert(EVDEV_PAIRING_NROLES <= LIBINPUT_PAIRING_SLOTS,
+	      "Too many pairing roles for the seat registry");
+
+/* A touchpad only rotates with a tablet in the same device group */
+#define EVDEV_PAIRING_GROUP_ROLES bit(EVDEV_PAIRING_TABLET)
+
+struct evdev_pairing_link {
+	struct list link; /* libinput_seat or libinput_device_group
+			     ->pairing.role or .wanted_by */
+	struct evdev_device *device;
+};
+
 enum evdev_middlebutton_state {
 	MIDDLEBUTTON_IDLE,
 	MIDDLEBUTTON_LEFT_DOWN,
@@ -166,6 +199,21 @@ enum evdev_arbitration_state {
 	ARBITRATION_IGNORE_RECT,
 };
 
+/**
+ * The phases of device creation, see evdev_log_timing()
+ */
+enum evdev_device_timing {
+	EVDEV_TIMING_OPEN,
+	EVDEV_TIMING_LIBEVDEV,
+	EVDEV_TIMING_QUIRKS,   /* first lookup, before the dispatch */
+	EVDEV_TIMING_LIBWACOM, /* part of EVDEV_TIMING_DISPATCH */
+	EVDEV_TIMING_DISPATCH, /* includes the libwacom lookup */
+	EVDEV_TIMING_PLUGINS,
+	EVDEV_TIMING_PAIRING,
+
+	EVDEV_TIMING_COUNT,
+};
+
 struct evdev_device {
 	struct libinput_device base;
 
@@ -179,6 +227,9 @@ struct evdev_device {
 	char *log_prefix_name;
 	char *sysname;
 	bool was_removed;
+	bool session_suspended; /* kept across libinput_suspend() */
+	uint64_t caps_hash;     /* see evdev_device_caps_hash() */
+	struct list udev_hash_link; /* udev_input->device_hash, NULL if unused */
 	int fd;
 	enum evdev_device_seat_capability seat_caps;
 	enum evdev_device_tags tags;
@@ -188,7 +239,23 @@ struct evdev_device {
 	double trackpoint_multiplier; /* trackpoint constant multiplier */
 	bool use_velocity_averaging;  /* whether averaging should be applied on velocity
 					 calculation */
+	usec_t timing[EVDEV_TIMING_COUNT]; /* time spent creating the device */
+
+	struct {
+		uint32_t roles; /* bitmask of enum evdev_pairing_role, 0 if
+				   not registered */
+		uint32_t wants; /* copied from the dispatch */
+		struct evdev_pairing_link role_link[EVDEV_PAIRING_NROLES];
+		struct evdev_pairing_link wants_link[EVDEV_PAIRING_NROLES];
+	} pairing;
+
 	struct ratelimit syn_drop_limit; /* ratelimit for SYN_DROPPED logging */
+	struct {
+		struct evdev_frame *frame; /* reused by every resync */
+		unsigned int count;
+		uint64_t nevents; /* events replayed by all resyncs */
+		usec_t first, last;
+	} syn_dropped;
 	struct ratelimit
 		delay_warning_limit; /* ratelimit for delayd processing logging */
 	struct ratelimit nonpointer_rel_limit; /* ratelimit for REL_* events from
@@ -257,7 +324,7 @@ struct evdev_device {
 
 	/* Key counter used for multiplexing button events internally in
 	 * libinput. */
-	uint8_t key_count[KEY_CNT];
+	struct key_count key_count;
 
 	struct {
 		struct libinput_device_config_left_handed config;
@@ -371,6 +438,10 @@ struct evdev_dispatch {
 	enum evdev_dispatch_type dispatch_type;
 	struct evdev_dispatch_interface *interface;
 
+	/* Bitmask of enum evdev_pairing_role the device_added hook wants
+	 * to see, other devices are never passed to it */
+	uint32_t pairing_wants;
+
 	struct {
 		struct libinput_device_config_send_events config;
 		enum libinput_config_send_events_mode current_mode;
@@ -388,6 +459,49 @@ evdev_verify_dispatch_type(struct evdev_dispatch *dispatch,
 struct evdev_device *
 evdev_device_create(struct libinput_seat *seat, struct udev_device *device);
 
+/**
+ * Device creation split into steps so the expensive initial ioctls can be
+ * run for several devices at once, see udev_input_add_devices().
+ *
+ * evdev_device_probe_open() must be called from the caller's thread, it
+ * calls open_restricted(). evdev_device_probe_run() only touches the fd
+ * and may be called from any thread. evdev_device_create_probed() takes
+ * ownership of the fd and the libevdev context, anything left over must
+ * be released with evdev_device_probe_cleanup().
+ */
+struct evdev_device_probe {
+	int fd;
+	struct libevdev *evdev;
+
+	usec_t open_time;
+	usec_t libevdev_time;
+
+	uint64_t caps_hash;
+};
+
+int
+evdev_device_probe_open(struct libinput *libinput,
+			struct udev_device *udev_device,
+			struct evdev_device_probe *probe);
+
+void
+evdev_device_probe_run(struct evdev_device_probe *probe);
+
+void
+evdev_device_probe_cleanup(struct libinput *libinput,
+			   struct evdev_device_probe *probe);
+
+struct evdev_device *
+evdev_device_create_probed(struct libinput_seat *seat,
+			   struct udev_device *udev_device,
+			   struct evdev_device_probe *probe);
+
+static inline const char *
+evdev_device_get_udev_property(struct evdev_device *device, const char *key)
+{
+	return libinput_device_get_udev_property(&device->base, key);
+}
+
 static inline struct libinput *
 evdev_libinput_context(const struct evdev_device *device)
 {
@@ -1055,4 +1169,14 @@ button_code_from_usage(evdev_usage_t usage)
 	return button_code_from_uint32_t(code);
 }
 
+/**
+ * Add the time since start to the given device creation phase
+ */
+static inline void
+evdev_timing_add(struct evdev_device *device, enum evdev_device_timing which, usec_t start)
+{
+	device->timing[which] =
+		usec_add(device->timing[which], usec_sub(usec_from_now(), start));
+}
+
 #endif /* EVDEV_H */
@@ -32,37 +32,144 @@
 #define MOTION_TIMEOUT usec_from_millis(1000)
 #define FIRST_MOTION_TIME_INTERVAL usec_from_millis(7) /* random but good enough interval for very first event */
 
+/* Curves defined through libinput_config_accel_set_curve() are resampled
+ * into a table of CUSTOM_ACCEL_SPLINE_SEGMENTS uniform segments. Uniform
+ * piecewise-linear curves are already such a table. Either way the
+ * per-event lookup is a multiplication and one linear interpolation.
+ */
+#define CUSTOM_ACCEL_SPLINE_SEGMENTS (1 << 8)
+
 struct custom_accel_function {
 	usec_t last_time;
 	usec_t last_delta_time;
-	double step;
-	size_t npoints;
-	double points[];
+	double max_speed;   /* speed of the last control point */
+	double scale;       /* table segments per unit of speed */
+	double slope;       /* extrapolation slope beyond max_speed */
+	size_t nsegments;
+	double table[];     /* nsegments + 1 entries */
 };
 
+/* Fritsch-Carlson tangents for a monotone cubic Hermite spline, see
+ * https://en.wikipedia.org/wiki/Monotone_cubic_interpolation
+ */
+static void
+custom_accel_spline_tangents(const double *x,
+			     const double *y,
+			     size_t npoints,
+			     double *m)
+{
+	double secants[LIBINPUT_ACCEL_NPOINTS_MAX];
+
+	for (size_t k = 0; k < npoints - 1; k++)
+		secants[k] = (y[k + 1] - y[k]) / (x[k + 1] - x[k]);
+
+	m[0] = secants[0];
+	m[npoints - 1] = secants[npoints - 2];
+	for (size_t k = 1; k < npoints - 1; k++) {
+		if (secants[k - 1] * secants[k] <= 0)
+			m[k] = 0.0;
+		else
+			m[k] = (secants[k - 1] + secants[k]) / 2.0;
+	}
+
+	for (size_t k = 0; k < npoints - 1; k++) {
+		if (secants[k] == 0.0) {
+			m[k] = 0.0;
+			m[k + 1] = 0.0;
+			continue;
+		}
+
+		double a = m[k] / secants[k];
+		double b = m[k + 1] / secants[k];
+		double h = a * a + b * b;
+		if (h > 9.0) {
+			double t = 3.0 / sqrt(h);
+			m[k] = t * a * secants[k];
+			m[k + 1] = t * b * secants[k];
+		}
+	}
+}
+
+static double
+custom_accel_spline_eval(const double *x,
+			 const double *y,
+			 const double *m,
+			 size_t k,
+			 double speed)
+{
+	double h = x[k + 1] - x[k];
+	double t = (speed - x[k]) / h;
+	double t2 = t * t;
+	double t3 = t2 * t;
+
+	return (2 * t3 - 3 * t2 + 1) * y[k] + (t3 - 2 * t2 + t) * h * m[k] +
+	       (-2 * t3 + 3 * t2) * y[k + 1] + (t3 - t2) * h * m[k + 1];
+}
+
 static struct custom_accel_function *
-create_custom_accel_function(double step, const double *points, size_t npoints)
+create_custom_accel_function(const struct libinput_config_accel_custom_func *func)
 {
+	size_t npoints = func->npoints;
+	const double *x = func->x;
+	const double *y = func->points;
+	double m[LIBINPUT_ACCEL_NPOINTS_MAX];
+
 	if (npoints < LIBINPUT_ACCEL_NPOINTS_MIN ||
 	    npoints > LIBINPUT_ACCEL_NPOINTS_MAX)
 		return NULL;
 
-	if (step <= 0 || step > LIBINPUT_ACCEL_STEP_MAX)
-		return NULL;
-
 	for (size_t idx = 0; idx < npoints; idx++) {
-		if (points[idx] < LIBINPUT_ACCEL_POINT_MIN_VALUE ||
-		    points[idx] > LIBINPUT_ACCEL_POINT_MAX_VALUE)
+		if (y[idx] < LIBINPUT_ACCEL_POINT_MIN_VALUE ||
+		    y[idx] > LIBINPUT_ACCEL_POINT_MAX_VALUE)
 			return NULL;
 	}
 
+	if (func->has_x) {
+		if (x[0] != 0.0)
+			return NULL;
+
+		for (size_t idx = 1; idx < npoints; idx++) {
+			double step = x[idx] - x[idx - 1];
+			if (step <= 0 || step > LIBINPUT_ACCEL_STEP_MAX)
+				return NULL;
+		}
+		custom_accel_spline_tangents(x, y, npoints, m);
+	} else {
+		if (func->step <= 0 || func->step > LIBINPUT_ACCEL_STEP_MAX)
+			return NULL;
+	}
+
+	size_t nsegments = func->has_x ? CUSTOM_ACCEL_SPLINE_SEGMENTS : npoints - 1;
 	struct custom_accel_function *cf =
-		zalloc(sizeof(*cf) + npoints * sizeof(*points));
+		zalloc(sizeof(*cf) + (nsegments + 1) * sizeof(*cf->table));
 	cf->last_time = usec_from_uint64_t(0);
 	cf->last_delta_time = FIRST_MOTION_TIME_INTERVAL;
-	cf->step = step;
-	cf->npoints = npoints;
-	memcpy(cf->points, points, sizeof(*points) * npoints);
+	cf->max_speed = func->has_x ? x[npoints - 1] : func->step * (npoints - 1);
+	cf->nsegments = nsegments;
+	cf->scale = nsegments / cf->max_speed;
+
+	if (!func->has_x) {
+		memcpy(cf->table, y, sizeof(*y) * npoints);
+		/* if speed is greater than custom curve's max speed,
+		   use last 2 points for linear extrapolation */
+		cf->slope = (y[npoints - 1] - y[npoints - 2]) / func->step;
+		return cf;
+	}
+
+	size_t k = 0;
+	for (size_t i = 0; i <= nsegments; i++) {
+		double speed = cf->max_speed * i / nsegments;
+
+		while (k < npoints - 2 && speed > x[k + 1])
+			k++;
+
+		cf->table[i] = custom_accel_spline_eval(x, y, m, k, speed);
+	}
+	/* avoid rounding errors on the last point, it's our
+	 * extrapolation base */
+	cf->table[nsegments] = y[npoints - 1];
+	/* beyond the last point follow the tangent of the spline */
+	cf->slope = m[npoints - 1];
 
 	return cf;
 }
@@ -139,26 +246,21 @@ custom_accel_function_calculate_speed(struct custom_accel_function *cf,
 static double
 custom_accel_function_profile(struct custom_accel_function *cf, double speed_in)
 {
-	size_t npoints = cf->npoints;
-	double step = cf->step;
-	double *points = cf->points;
-
-	/* calculate the index of the first point used for interpolation */
-	size_t i = speed_in / step;
-
-	/* if speed is greater than custom curve's max speed,
-	   use last 2 points for linear extrapolation
-	   (same calculation as linear interpolation) */
-	i = min(i, npoints - 2);
-
-	/* the 2 points used for linear interpolation */
-	double x0 = step * i;
-	double x1 = step * (i + 1);
-	double y0 = points[i];
-	double y1 = points[i + 1];
-
-	/* linear interpolation */
-	double speed_out = (y0 * (x1 - speed_in) + y1 * (speed_in - x0)) / step;
+	double pos = speed_in * cf->scale;
+	double speed_out;
+
+	if (pos < cf->nsegments) {
+		/* linear interpolation between the two closest table entries */
+		size_t i = (size_t)pos;
+		double frac = pos - i;
+
+		speed_out = cf->table[i] + (cf->table[i + 1] - cf->table[i]) * frac;
+	} else {
+		/* if speed is greater than custom curve's max speed,
+		   extrapolate linearly from the last point */
+		speed_out = cf->table[cf->nsegments] +
+			    (speed_in - cf->max_speed) * cf->slope;
+	}
 
 	/* We moved (dx, dy) device units within the last N ms. This gives us a
 	 * given speed S in units/ms, that's our accel input. Our curve says map
@@ -300,26 +402,19 @@ custom_accelerator_set_accel_config(struct motion_filter *filter,
 	struct custom_accel_function *fallback = NULL, *motion = NULL, *scroll = NULL;
 
 	if (config->custom.fallback) {
-		fallback =
-			create_custom_accel_function(config->custom.fallback->step,
-						     config->custom.fallback->points,
-						     config->custom.fallback->npoints);
+		fallback = create_custom_accel_function(config->custom.fallback);
 		if (!fallback)
 			goto out;
 	}
 
 	if (config->custom.motion) {
-		motion = create_custom_accel_function(config->custom.motion->step,
-						      config->custom.motion->points,
-						      config->custom.motion->npoints);
+		motion = create_custom_accel_function(config->custom.motion);
 		if (!motion)
 			goto out;
 	}
 
 	if (config->custom.scroll) {
-		scroll = create_custom_accel_function(config->custom.scroll->step,
-						      config->custom.scroll->points,
-						      config->custom.scroll->npoints);
+		scroll = create_custom_accel_function(config->custom.scroll);
 		if (!scroll)
 			goto out;
 	}
@@ -428,13 +523,14 @@ create_custom_accelerator_filter(void)
 
 	/* the unit function by default, speed in = speed out,
 	   i.e. no acceleration */
-	const double default_step = 1.0;
-	const double default_points[2] = { 0.0, 1.0 };
+	const struct libinput_config_accel_custom_func default_func = {
+		.step = 1.0,
+		.npoints = 2,
+		.points = { 0.0, 1.0 },
+	};
 
 	/* initialize default acceleration, used as fallback */
-	f->funcs.fallback = create_custom_accel_function(default_step,
-							 default_points,
-							 ARRAY_LENGTH(default_points));
+	f->funcs.fallback = create_custom_accel_function(&default_func);
 	/* Don't initialize other acceleration functions. Those will be
 	   initialized if the user sets their points, otherwise the fallback
 	   acceleration function is used */
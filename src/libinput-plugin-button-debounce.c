@@ -760,15 +760,11 @@ debounce_plugin_device_added(struct libinput_plugin *libinput_plugin,
 	if (libinput_device_is_virtual(device))
 		return;
 
-	_unref_(udev_device) *udev_device = libinput_device_get_udev_device(device);
-	if (udev_device) {
-		const char *prop = udev_device_get_property_value(udev_device,
-								  "ID_INPUT_TOUCHPAD");
-		bool val;
-		if (parse_boolean_property(prop, &val) && val) {
-			return;
-		}
-	}
+	struct udev_property *prop =
+		libinput_device_find_udev_property(device, "ID_INPUT_TOUCHPAD");
+	bool val;
+	if (prop && udev_property_get_bool(prop, &val) && val)
+		return;
 
 	_unref_(quirks) *q = libinput_device_get_quirks(device);
 	bool result = false;
@@ -37,6 +37,7 @@
 #include "libinput-log.h"
 #include "libinput-plugin-lua.h"
 #include "libinput-plugin.h"
+#include "libinput-private.h"
 #include "libinput-util.h"
 #include "timer.h"
 
@@ -50,30 +51,6 @@ static const char libinput_key = 'l';            /* key to lua registry */
 
 DEFINE_TRIVIAL_CLEANUP_FUNC(lua_State *, lua_close);
 
-struct udev_property {
-	struct list link;
-	char *key;
-	char *value;
-};
-
-static inline struct udev_property *
-udev_property_new(const char *key, const char *value)
-{
-	struct udev_property *prop = zalloc(sizeof(*prop));
-	prop->key = safe_strdup(key);
-	prop->value = safe_strdup(value);
-	return prop;
-}
-
-static inline void
-udev_property_destroy(struct udev_property *prop)
-{
-	list_remove(&prop->link);
-	free(prop->key);
-	free(prop->value);
-	free(prop);
-}
-
 /* A thin wrapper struct that just needs to exist, all
  * the actual logic is struct libinput_lua_plugin */
 typedef struct {
@@ -90,7 +67,6 @@ typedef struct {
 	unsigned int vid;
 	unsigned int pid;
 	char *name;
-	struct list udev_properties_list;
 
 	struct libevdev *evdev;
 
@@ -171,24 +147,6 @@ lua_push_evdev_device(lua_State *L,
 	lua_device->name = safe_strdup(libinput_device_get_name(device));
 	lua_device->device_removed_refid = LUA_NOREF;
 	lua_device->frame_refid = LUA_NOREF;
-	list_init(&lua_device->udev_properties_list);
-
-	struct udev_list_entry *e = udev_device_get_properties_list_entry(udev_device);
-	while (e) {
-		const char *key = udev_list_entry_get_name(e);
-		if (strstartswith(key, "ID_INPUT_") &&
-		    !streq(key, "ID_INPUT_WIDTH_MM") &&
-		    !streq(key, "ID_INPUT_HEIGHT_MM")) {
-			const char *value = udev_list_entry_get_value(e);
-			if (!streq(value, "0")) {
-				struct udev_property *prop =
-					udev_property_new(key, value);
-				list_insert(&lua_device->udev_properties_list,
-					    &prop->link);
-			}
-		}
-		e = udev_list_entry_get_next(e);
-	}
 
 	list_insert(&plugin->evdev_devices, &lua_device->link);
 
@@ -371,10 +329,6 @@ remove_device(struct libinput_lua_plugin *plugin, EvdevDevice *evdev)
 	list_remove(&evdev->link);
 	list_init(&evdev->link); /* so we can list_remove in _gc */
 
-	struct udev_property *prop;
-	list_for_each_safe(prop, &evdev->udev_properties_list, link) {
-		udev_property_destroy(prop);
-	}
 	free_clear(&evdev->name);
 	evdev->device = libinput_device_unref(evdev->device);
 
@@ -836,10 +790,20 @@ evdevdevice_udev_properties(lua_State *L)
 	if (device->evdev == NULL)
 		return 1;
 
-	struct udev_property *prop;
-	list_for_each(prop, &device->udev_properties_list, link) {
-		lua_pushstring(L, prop->value);
-		lua_setfield(L, -2, prop->key); /* Assign to top-level table */
+	/* Shared with the rest of libinput, sorted so the ID_INPUT_ ones
+	 * are a contiguous range */
+	struct udev_property *props;
+	size_t nprops =
+		libinput_device_get_udev_properties(device->device, "ID_INPUT_", &props);
+	for (size_t i = 0; i < nprops; i++) {
+		const char *key = props[i].key;
+
+		if (streq(key, "ID_INPUT_WIDTH_MM") || streq(key, "ID_INPUT_HEIGHT_MM") ||
+		    streq(props[i].value, "0"))
+			continue;
+
+		lua_pushstring(L, props[i].value);
+		lua_setfield(L, -2, key); /* Assign to top-level table */
 	}
 
 	return 1;
@@ -1090,10 +1054,6 @@ evdevdevice_gc(lua_State *L)
 	luaL_argcheck(L, device != NULL, 1, EVDEV_DEVICE_METATABLE "expected");
 
 	list_remove(&device->link);
-	struct udev_property *prop;
-	list_for_each_safe(prop, &device->udev_properties_list, link) {
-		udev_property_destroy(prop);
-	}
 	free(device->name);
 
 	return 0;
@@ -36,6 +36,7 @@
 #endif
 
 #include "util-bits.h"
+#include "util-key-count.h"
 #include "util-newtype.h"
 
 #include "libinput-log.h"
@@ -46,6 +47,7 @@
 #include "libinput.h"
 #include "linux/input.h"
 #include "quirks.h"
+#include "timer.h"
 
 struct libinput_source;
 
@@ -183,6 +185,9 @@ struct phys_ellipsis {
 struct libinput_interface_backend {
 	int (*resume)(struct libinput *libinput);
 	void (*suspend)(struct libinput *libinput);
+	/* optional, NULL if only the default mode is supported */
+	int (*set_suspend_mode)(struct libinput *libinput,
+				enum libinput_suspend_mode mode);
 	void (*destroy)(struct libinput *libinput);
 	int (*device_change_seat)(struct libinput_device *device,
 				  const char *seat_name);
@@ -226,6 +231,10 @@ struct libinput {
 
 	bool quirks_initialized;
 	struct quirks_context *quirks;
+	struct {
+		int fd; /* inotify, see LIBINPUT_QUIRKS_RELOAD */
+		struct libinput_source *source;
+	} quirks_watch;
 
 	struct libinput_plugin_system plugin_system;
 
@@ -233,12 +242,19 @@ struct libinput {
 	struct {
 		WacomDeviceDatabase *db;
 		size_t refcount;
+		/* keeps the db around for a bit after the last unref */
+		struct libinput_timer grace_timer;
+		/* struct libwacom_device_entry, failed lookups expire with
+		 * the grace timer */
+		struct list devices;
 	} libwacom;
 #endif
 };
 
 typedef void (*libinput_seat_destroy_func)(struct libinput_seat *seat);
 
+#define LIBINPUT_PAIRING_SLOTS 8
+
 struct libinput_seat {
 	struct libinput *libinput;
 	struct list link;
@@ -252,7 +268,13 @@ struct libinput_seat {
 
 	uint32_t slot_map;
 
-	uint32_t button_count[KEY_CNT];
+	struct key_count key_count; /* keys and buttons down on this seat */
+
+	/* evdev device pairing registry, indexed by enum evdev_pairing_role */
+	struct {
+		struct list role[LIBINPUT_PAIRING_SLOTS];
+		struct list wanted_by[LIBINPUT_PAIRING_SLOTS];
+	} pairing;
 };
 
 struct libinput_device_config_tap {
@@ -359,6 +381,10 @@ struct libinput_config_accel_custom_func {
 	double step;
 	size_t npoints;
 	double points[LIBINPUT_ACCEL_NPOINTS_MAX];
+	/* true if set through libinput_config_accel_set_curve(), in which
+	 * case x holds the control point speeds and step is unused */
+	bool has_x;
+	double x[LIBINPUT_ACCEL_NPOINTS_MAX];
 };
 
 struct libinput_config_accel {
@@ -483,6 +509,14 @@ struct libinput_device_config_dwtp {
 	usec_t (*get_default_timeout)(struct libinput_device *device);
 };
 
+struct libinput_device_config_prediction {
+	int (*is_available)(struct libinput_device *device);
+	enum libinput_config_status (*set_horizon)(struct libinput_device *device,
+						   usec_t horizon);
+	usec_t (*get_horizon)(struct libinput_device *device);
+	usec_t (*get_default_horizon)(struct libinput_device *device);
+};
+
 struct libinput_device_config_rotation {
 	int (*is_available)(struct libinput_device *device);
 	enum libinput_config_status (*set_angle)(struct libinput_device *device,
@@ -514,6 +548,7 @@ struct libinput_device_config {
 	struct libinput_device_config_middle_emulation *middle_emulation;
 	struct libinput_device_config_dwt *dwt;
 	struct libinput_device_config_dwtp *dwtp;
+	struct libinput_device_config_prediction *prediction;
 	struct libinput_device_config_rotation *rotation;
 	struct libinput_device_config_gesture *gesture;
 	struct libinput_device_config_3fg_drag *drag_3fg;
@@ -524,6 +559,13 @@ struct libinput_device_group {
 	void *user_data;
 	char *identifier; /* unique identifier or NULL for singletons */
 
+	/* evdev device pairing registry for the roles that only pair
+	 * within the same device group, see libinput_seat */
+	struct {
+		struct list role[LIBINPUT_PAIRING_SLOTS];
+		struct list wanted_by[LIBINPUT_PAIRING_SLOTS];
+	} pairing;
+
 	struct list link;
 };
 
@@ -545,6 +587,21 @@ struct libinput_device {
 
 	void (*inject_evdev_frame)(struct libinput_device *device,
 				   struct evdev_frame *frame);
+
+	/* Cached for libinput_device_get_quirks(), may be NULL even if
+	 * quirks_fetched is true */
+	struct quirks *quirks;
+	bool quirks_fetched;
+	usec_t quirks_time; /* time spent fetching the quirks */
+
+	/* Snapshot of the udev properties sorted by key, built on the
+	 * first libinput_device_find_udev_property() */
+	struct {
+		struct udev_device *udev_device;
+		struct udev_property *props;
+		size_t nprops;
+		bool loaded;
+	} udev_props;
 };
 
 enum libinput_tablet_tool_axis {
@@ -738,6 +795,23 @@ libinput_device_init(struct libinput_device *device, struct libinput_seat *seat)
 bool
 libinput_device_has_model_quirk(struct libinput_device *device, enum quirk model_quirk);
 
+void
+libinput_device_release_quirks(struct libinput_device *device);
+
+struct udev_property *
+libinput_device_find_udev_property(struct libinput_device *device, const char *key);
+
+const char *
+libinput_device_get_udev_property(struct libinput_device *device, const char *key);
+
+size_t
+libinput_device_get_udev_properties(struct libinput_device *device,
+				    const char *prefix,
+				    struct udev_property **first);
+
+void
+libinput_device_release_udev_properties(struct libinput_device *device);
+
 bool
 libinput_device_is_virtual(struct libinput_device *device);
 
@@ -787,6 +861,13 @@ pointer_notify_motion(struct libinput_device *device,
 		      const struct normalized_coords *delta,
 		      const struct device_float_coords *raw);
 
+void
+pointer_notify_motion_predicted(struct libinput_device *device,
+				usec_t time,
+				const struct normalized_coords *delta,
+				const struct device_float_coords *raw,
+				const struct normalized_coords *predicted);
+
 void
 pointer_notify_motion_absolute(struct libinput_device *device,
 			       usec_t time,
@@ -1129,11 +1210,31 @@ point_in_rect(const struct device_coords *point, const struct device_coord_rect
 }
 
 #ifdef HAVE_LIBWACOM
+void
+libinput_libwacom_init(struct libinput *li);
+void
+libinput_libwacom_destroy(struct libinput *li);
 WacomDeviceDatabase *
 libinput_libwacom_ref(struct libinput *li);
 void
 libinput_libwacom_unref(struct libinput *li);
+
+WacomDevice *
+libinput_libwacom_get_device(struct libinput *li,
+			     const char *sysname,
+			     unsigned int bustype,
+			     unsigned int vid,
+			     unsigned int pid,
+			     const char *name);
 #else
+static inline void
+libinput_libwacom_init(struct libinput *li)
+{
+}
+static inline void
+libinput_libwacom_destroy(struct libinput *li)
+{
+}
 static inline void *
 libinput_libwacom_ref(struct libinput *li)
 {
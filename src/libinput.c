@@ -32,6 +32,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/epoll.h>
+#include <sys/inotify.h>
 #include <unistd.h>
 
 #include "util-input-event.h"
@@ -185,6 +186,7 @@ struct libinput_event_pointer {
 	usec_t time;
 	struct normalized_coords delta;
 	struct device_float_coords delta_raw;
+	struct normalized_coords predicted;
 	struct device_coords absolute;
 	struct discrete_coords discrete;
 	struct wheel_v120 v120;
@@ -638,6 +640,28 @@ libinput_event_pointer_get_dy_unaccelerated(struct libinput_event_pointer *event
 	return event->delta_raw.y;
 }
 
+LIBINPUT_EXPORT double
+libinput_event_pointer_get_dx_predicted(struct libinput_event_pointer *event)
+{
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_POINTER_MOTION);
+
+	return event->predicted.x;
+}
+
+LIBINPUT_EXPORT double
+libinput_event_pointer_get_dy_predicted(struct libinput_event_pointer *event)
+{
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_POINTER_MOTION);
+
+	return event->predicted.y;
+}
+
 LIBINPUT_EXPORT double
 libinput_event_pointer_get_absolute_x(struct libinput_event_pointer *event)
 {
@@ -1884,6 +1908,7 @@ libinput_init(struct libinput *libinput,
 	list_init(&libinput->seat_list);
 	list_init(&libinput->device_group_list);
 	list_init(&libinput->tool_list);
+	libinput->quirks_watch.fd = -1;
 
 	libinput_plugin_system_init(&libinput->plugin_system);
 
@@ -1893,9 +1918,140 @@ libinput_init(struct libinput *libinput,
 		return -1;
 	}
 
+	libinput_libwacom_init(libinput);
+
 	return 0;
 }
 
+static void
+libinput_reload_quirks(struct libinput *libinput)
+{
+	struct libinput_seat *seat;
+	struct libinput_device *device;
+	struct libinput_device **changed = NULL;
+	size_t nchanged = 0;
+
+	_unref_(quirks_context) *quirks = quirks_context_reload(libinput->quirks);
+	if (!quirks) {
+		log_error(libinput, "Failed to reload the device quirks, keeping the old ones\n");
+		return;
+	}
+
+	/* Devices whose quirks resolve to the same values simply switch
+	 * over to the new context, all others need to be re-added since
+	 * the quirks are only applied during device initialization */
+	list_for_each(seat, &libinput->seat_list, link) {
+		list_for_each(device, &seat->devices_list, link) {
+			if (!device->quirks_fetched)
+				continue;
+
+			_unref_(udev_device) *udev_device =
+				libinput_device_get_udev_device(device);
+			struct quirks *q = udev_device
+						   ? quirks_fetch_for_device(quirks, udev_device)
+						   : NULL;
+
+			if (quirks_equal(device->quirks, q)) {
+				quirks_unref(device->quirks);
+				device->quirks = q;
+				continue;
+			}
+
+			quirks_unref(q);
+			libinput_device_release_quirks(device);
+
+			changed = realloc(changed, (nchanged + 1) * sizeof(*changed));
+			if (!changed)
+				abort();
+			changed[nchanged++] = libinput_device_ref(device);
+		}
+	}
+
+	/* No quirks from the old context are referenced anymore */
+	struct quirks_context *old = libinput->quirks;
+	libinput->quirks = steal(&quirks);
+	quirks_context_unref(old);
+
+	log_info(libinput,
+		 "Reloaded the device quirks, %zu device(s) changed\n",
+		 nchanged);
+
+	for (size_t i = 0; i < nchanged; i++) {
+		device = changed[i];
+		_autofree_ char *seat_name = safe_strdup(device->seat->logical_name);
+
+		log_info(libinput,
+			 "%s: quirks changed, re-adding device\n",
+			 libinput_device_get_sysname(device));
+		libinput->interface_backend->device_change_seat(device, seat_name);
+		libinput_device_unref(device);
+	}
+	free(changed);
+}
+
+static void
+libinput_quirks_watch_dispatch(void *data)
+{
+	struct libinput *libinput = data;
+	union {
+		struct inotify_event event;
+		char buf[4096];
+	} u;
+	bool reload = false;
+	ssize_t len;
+
+	while ((len = read(libinput->quirks_watch.fd, u.buf, sizeof(u.buf))) > 0) {
+		for (char *ptr = u.buf; ptr < u.buf + len;) {
+			const struct inotify_event *event = (void *)ptr;
+
+			if (event->len > 0 && strendswith(event->name, ".quirks"))
+				reload = true;
+			ptr += sizeof(*event) + event->len;
+		}
+	}
+
+	/* Reload once for the whole batch, editors tend to generate a
+	 * few events per save */
+	if (reload)
+		libinput_reload_quirks(libinput);
+}
+
+static void
+libinput_quirks_watch_init(struct libinput *libinput)
+{
+	int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (fd < 0) {
+		log_error(libinput, "Failed to watch the device quirks: %m\n");
+		return;
+	}
+
+	if (quirks_context_add_watches(libinput->quirks, fd) == 0) {
+		close(fd);
+		return;
+	}
+
+	libinput->quirks_watch.source =
+		libinput_add_fd(libinput, fd, libinput_quirks_watch_dispatch, libinput);
+	if (!libinput->quirks_watch.source) {
+		close(fd);
+		return;
+	}
+
+	libinput->quirks_watch.fd = fd;
+	log_info(libinput, "Watching the device quirks for changes\n");
+}
+
+static void
+libinput_quirks_watch_destroy(struct libinput *libinput)
+{
+	if (libinput->quirks_watch.source)
+		libinput_remove_source(libinput, libinput->quirks_watch.source);
+	libinput->quirks_watch.source = NULL;
+	if (libinput->quirks_watch.fd >= 0)
+		close(libinput->quirks_watch.fd);
+	libinput->quirks_watch.fd = -1;
+}
+
 void
 libinput_init_quirks(struct libinput *libinput)
 {
@@ -1932,6 +2088,11 @@ libinput_init_quirks(struct libinput *libinput)
 	}
 
 	libinput->quirks = quirks;
+
+	/* For device bring-up: re-apply the quirks when the files change
+	 * instead of having to restart the compositor */
+	if (getenv("LIBINPUT_QUIRKS_RELOAD"))
+		libinput_quirks_watch_init(libinput);
 }
 
 static void
@@ -2000,6 +2161,8 @@ libinput_unref(struct libinput *libinput)
 		libinput_device_group_destroy(group);
 	}
 
+	libinput_quirks_watch_destroy(libinput);
+	libinput_libwacom_destroy(libinput);
 	libinput_timer_subsys_destroy(libinput);
 	libinput_drop_destroyed_sources(libinput);
 	quirks_context_unref(libinput->quirks);
@@ -2012,11 +2175,110 @@ libinput_unref(struct libinput *libinput)
 struct quirks *
 libinput_device_get_quirks(struct libinput_device *device)
 {
-	struct libinput *libinput = libinput_device_get_context(device);
-	_unref_(udev_device) *udev_device = libinput_device_get_udev_device(device);
-	if (udev_device)
-		return quirks_fetch_for_device(libinput->quirks, udev_device);
-	return NULL;
+	/* The quirks don't change for the lifetime of the device, fetch
+	 * them once and hand out references to that */
+	if (!device->quirks_fetched) {
+		struct libinput *libinput = libinput_device_get_context(device);
+		_unref_(udev_device) *udev_device =
+			libinput_device_get_udev_device(device);
+		usec_t start = usec_from_now();
+		if (udev_device)
+			device->quirks = quirks_fetch_for_device(libinput->quirks,
+								 udev_device);
+		device->quirks_fetched = true;
+		device->quirks_time = usec_sub(usec_from_now(), start);
+	}
+
+	return device->quirks ? quirks_ref(device->quirks) : NULL;
+}
+
+void
+libinput_device_release_quirks(struct libinput_device *device)
+{
+	device->quirks = quirks_unref(device->quirks);
+	device->quirks_fetched = false;
+}
+
+/* libudev keeps the properties in a list, every lookup walks it. Copy
+ * the pointers into a sorted array once instead. The strings stay owned
+ * by the udev device we keep a ref to. */
+static void
+libinput_device_load_udev_properties(struct libinput_device *device)
+{
+	struct udev_list_entry *e;
+	size_t n = 0, sz = 0;
+
+	device->udev_props.loaded = true;
+	device->udev_props.udev_device = libinput_device_get_udev_device(device);
+	if (!device->udev_props.udev_device)
+		return;
+
+	e = udev_device_get_properties_list_entry(device->udev_props.udev_device);
+	for (; e; e = udev_list_entry_get_next(e)) {
+		if (n == sz) {
+			sz = max(sz * 2, 32U);
+			device->udev_props.props =
+				realloc(device->udev_props.props,
+					sz * sizeof(*device->udev_props.props));
+			if (!device->udev_props.props)
+				abort();
+		}
+
+		device->udev_props.props[n++] = (struct udev_property){
+			.key = udev_list_entry_get_name(e),
+			.value = udev_list_entry_get_value(e),
+		};
+	}
+
+	udev_properties_sort(device->udev_props.props, n);
+	device->udev_props.nprops = n;
+}
+
+struct udev_property *
+libinput_device_find_udev_property(struct libinput_device *device, const char *key)
+{
+	if (!device->udev_props.loaded)
+		libinput_device_load_udev_properties(device);
+
+	return udev_properties_find(device->udev_props.props,
+				    device->udev_props.nprops,
+				    key);
+}
+
+const char *
+libinput_device_get_udev_property(struct libinput_device *device, const char *key)
+{
+	struct udev_property *prop = libinput_device_find_udev_property(device, key);
+
+	return prop ? prop->value : NULL;
+}
+
+/**
+ * Return the number of properties whose key starts with prefix, first is
+ * set to the first of those. They are sorted by key and contiguous.
+ */
+size_t
+libinput_device_get_udev_properties(struct libinput_device *device,
+				    const char *prefix,
+				    struct udev_property **first)
+{
+	if (!device->udev_props.loaded)
+		libinput_device_load_udev_properties(device);
+
+	return udev_properties_find_prefix(device->udev_props.props,
+					   device->udev_props.nprops,
+					   prefix,
+					   first);
+}
+
+void
+libinput_device_release_udev_properties(struct libinput_device *device)
+{
+	free(device->udev_props.props);
+	device->udev_props.props = NULL;
+	device->udev_props.nprops = 0;
+	device->udev_props.udev_device = udev_device_unref(device->udev_props.udev_device);
+	device->udev_props.loaded = false;
 }
 
 static void
@@ -2099,6 +2361,10 @@ libinput_seat_init(struct libinput_seat *seat,
 	seat->logical_name = safe_strdup(logical_name);
 	seat->destroy = destroy;
 	list_init(&seat->devices_list);
+	ARRAY_FOR_EACH(seat->pairing.role, l)
+		list_init(l);
+	ARRAY_FOR_EACH(seat->pairing.wanted_by, l)
+		list_init(l);
 	list_insert(&libinput->seat_list, &seat->link);
 }
 
@@ -2113,6 +2379,7 @@ static void
 libinput_seat_destroy(struct libinput_seat *seat)
 {
 	list_remove(&seat->link);
+	key_count_reset(&seat->key_count);
 	free(seat->logical_name);
 	free(seat->physical_name);
 	seat->destroy(seat);
@@ -2298,13 +2565,10 @@ update_seat_key_count(struct libinput_seat *seat,
 
 	switch (state) {
 	case LIBINPUT_KEY_STATE_PRESSED:
-		return ++seat->button_count[key];
+		return key_count_inc(&seat->key_count, key);
 	case LIBINPUT_KEY_STATE_RELEASED:
 		/* We might not have received the first PRESSED event. */
-		if (seat->button_count[key] == 0)
-			return 0;
-
-		return --seat->button_count[key];
+		return key_count_dec(&seat->key_count, key);
 	}
 
 	return 0;
@@ -2320,13 +2584,10 @@ update_seat_button_count(struct libinput_seat *seat,
 
 	switch (state) {
 	case LIBINPUT_BUTTON_STATE_PRESSED:
-		return ++seat->button_count[button];
+		return key_count_inc(&seat->key_count, button);
 	case LIBINPUT_BUTTON_STATE_RELEASED:
 		/* We might not have received the first PRESSED event. */
-		if (seat->button_count[button] == 0)
-			return 0;
-
-		return --seat->button_count[button];
+		return key_count_dec(&seat->key_count, button);
 	}
 
 	return 0;
@@ -2489,6 +2750,18 @@ pointer_notify_motion(struct libinput_device *device,
 		      usec_t time,
 		      const struct normalized_coords *delta,
 		      const struct device_float_coords *raw)
+{
+	const struct normalized_coords none = { 0.0, 0.0 };
+
+	pointer_notify_motion_predicted(device, time, delta, raw, &none);
+}
+
+void
+pointer_notify_motion_predicted(struct libinput_device *device,
+				usec_t time,
+				const struct normalized_coords *delta,
+				const struct device_float_coords *raw,
+				const struct normalized_coords *predicted)
 {
 	struct libinput_event_pointer *motion_event;
 
@@ -2501,6 +2774,7 @@ pointer_notify_motion(struct libinput_device *device,
 		.time = time,
 		.delta = *delta,
 		.delta_raw = *raw,
+		.predicted = *predicted,
 	};
 
 	post_device_event(device,
@@ -3363,6 +3637,24 @@ libinput_suspend(struct libinput *libinput)
 	libinput->interface_backend->suspend(libinput);
 }
 
+LIBINPUT_EXPORT int
+libinput_set_suspend_mode(struct libinput *libinput, enum libinput_suspend_mode mode)
+{
+	switch (mode) {
+	case LIBINPUT_SUSPEND_MODE_REMOVE_DEVICES:
+	case LIBINPUT_SUSPEND_MODE_KEEP_DEVICES:
+		break;
+	default:
+		log_bug_client(libinput, "invalid suspend mode %d\n", mode);
+		return -1;
+	}
+
+	if (!libinput->interface_backend->set_suspend_mode)
+		return mode == LIBINPUT_SUSPEND_MODE_REMOVE_DEVICES ? 0 : -1;
+
+	return libinput->interface_backend->set_suspend_mode(libinput, mode);
+}
+
 LIBINPUT_EXPORT void
 libinput_device_set_user_data(struct libinput_device *device, void *user_data)
 {
@@ -3948,6 +4240,10 @@ libinput_device_group_create(struct libinput *libinput, const char *identifier)
 	group = zalloc(sizeof *group);
 	group->refcount = 1;
 	group->identifier = safe_strdup(identifier);
+	ARRAY_FOR_EACH(group->pairing.role, l)
+		list_init(l);
+	ARRAY_FOR_EACH(group->pairing.wanted_by, l)
+		list_init(l);
 
 	list_init(&group->link);
 	list_insert(&libinput->device_group_list, &group->link);
@@ -4498,45 +4794,40 @@ libinput_device_config_accel_apply(struct libinput_device *device,
 	}
 }
 
-LIBINPUT_EXPORT enum libinput_config_status
-libinput_config_accel_set_points(struct libinput_config_accel *config,
-				 enum libinput_config_accel_type accel_type,
-				 double step,
-				 size_t npoints,
-				 const double *points)
+static inline bool
+libinput_config_accel_type_is_valid(enum libinput_config_accel_type accel_type)
 {
-	if (config->profile != LIBINPUT_CONFIG_ACCEL_PROFILE_CUSTOM)
-		return LIBINPUT_CONFIG_STATUS_INVALID;
-
 	switch (accel_type) {
 	case LIBINPUT_ACCEL_TYPE_FALLBACK:
 	case LIBINPUT_ACCEL_TYPE_MOTION:
 	case LIBINPUT_ACCEL_TYPE_SCROLL:
-		break;
-	default:
-		return LIBINPUT_CONFIG_STATUS_INVALID;
+		return true;
 	}
 
-	if (step <= 0 || step > LIBINPUT_ACCEL_STEP_MAX)
-		return LIBINPUT_CONFIG_STATUS_INVALID;
+	return false;
+}
 
+static inline bool
+libinput_config_accel_points_are_valid(size_t npoints, const double *points)
+{
 	if (npoints < LIBINPUT_ACCEL_NPOINTS_MIN ||
 	    npoints > LIBINPUT_ACCEL_NPOINTS_MAX)
-		return LIBINPUT_CONFIG_STATUS_INVALID;
+		return false;
 
 	for (size_t idx = 0; idx < npoints; idx++) {
 		if (points[idx] < LIBINPUT_ACCEL_POINT_MIN_VALUE ||
 		    points[idx] > LIBINPUT_ACCEL_POINT_MAX_VALUE)
-			return LIBINPUT_CONFIG_STATUS_INVALID;
+			return false;
 	}
 
-	struct libinput_config_accel_custom_func *func =
-		libinput_config_accel_custom_func_create();
-
-	func->step = step;
-	func->npoints = npoints;
-	memcpy(func->points, points, sizeof(*points) * npoints);
+	return true;
+}
 
+static void
+libinput_config_accel_set_custom_func(struct libinput_config_accel *config,
+				      enum libinput_config_accel_type accel_type,
+				      struct libinput_config_accel_custom_func *func)
+{
 	switch (accel_type) {
 	case LIBINPUT_ACCEL_TYPE_FALLBACK:
 		libinput_config_accel_custom_func_destroy(config->custom.fallback);
@@ -4551,6 +4842,74 @@ libinput_config_accel_set_points(struct libinput_config_accel *config,
 		config->custom.scroll = func;
 		break;
 	}
+}
+
+LIBINPUT_EXPORT enum libinput_config_status
+libinput_config_accel_set_points(struct libinput_config_accel *config,
+				 enum libinput_config_accel_type accel_type,
+				 double step,
+				 size_t npoints,
+				 const double *points)
+{
+	if (config->profile != LIBINPUT_CONFIG_ACCEL_PROFILE_CUSTOM)
+		return LIBINPUT_CONFIG_STATUS_INVALID;
+
+	if (!libinput_config_accel_type_is_valid(accel_type))
+		return LIBINPUT_CONFIG_STATUS_INVALID;
+
+	if (step <= 0 || step > LIBINPUT_ACCEL_STEP_MAX)
+		return LIBINPUT_CONFIG_STATUS_INVALID;
+
+	if (!libinput_config_accel_points_are_valid(npoints, points))
+		return LIBINPUT_CONFIG_STATUS_INVALID;
+
+	struct libinput_config_accel_custom_func *func =
+		libinput_config_accel_custom_func_create();
+
+	func->step = step;
+	func->npoints = npoints;
+	memcpy(func->points, points, sizeof(*points) * npoints);
+
+	libinput_config_accel_set_custom_func(config, accel_type, func);
+
+	return LIBINPUT_CONFIG_STATUS_SUCCESS;
+}
+
+LIBINPUT_EXPORT enum libinput_config_status
+libinput_config_accel_set_curve(struct libinput_config_accel *config,
+				enum libinput_config_accel_type accel_type,
+				size_t npoints,
+				const double *speeds,
+				const double *points)
+{
+	if (config->profile != LIBINPUT_CONFIG_ACCEL_PROFILE_CUSTOM)
+		return LIBINPUT_CONFIG_STATUS_INVALID;
+
+	if (!libinput_config_accel_type_is_valid(accel_type))
+		return LIBINPUT_CONFIG_STATUS_INVALID;
+
+	if (!libinput_config_accel_points_are_valid(npoints, points))
+		return LIBINPUT_CONFIG_STATUS_INVALID;
+
+	if (speeds[0] != 0.0)
+		return LIBINPUT_CONFIG_STATUS_INVALID;
+
+	for (size_t idx = 1; idx < npoints; idx++) {
+		double step = speeds[idx] - speeds[idx - 1];
+		if (step <= 0 || step > LIBINPUT_ACCEL_STEP_MAX)
+			return LIBINPUT_CONFIG_STATUS_INVALID;
+	}
+
+	struct libinput_config_accel_custom_func *func =
+		libinput_config_accel_custom_func_create();
+
+	func->step = 0.0;
+	func->npoints = npoints;
+	func->has_x = true;
+	memcpy(func->x, speeds, sizeof(*speeds) * npoints);
+	memcpy(func->points, points, sizeof(*points) * npoints);
+
+	libinput_config_accel_set_custom_func(config, accel_type, func);
 
 	return LIBINPUT_CONFIG_STATUS_SUCCESS;
 }
@@ -5047,6 +5406,48 @@ libinput_device_config_dwtp_get_default_timeout(struct libinput_device *device)
 	return usec_to_millis(device->config.dwtp->get_default_timeout(device));
 }
 
+LIBINPUT_EXPORT int
+libinput_device_config_prediction_is_available(struct libinput_device *device)
+{
+	if (!device->config.prediction)
+		return 0;
+
+	return device->config.prediction->is_available(device);
+}
+
+LIBINPUT_EXPORT enum libinput_config_status
+libinput_device_config_prediction_set_horizon(struct libinput_device *device,
+					      uint32_t millis)
+{
+	if (millis > 50)
+		return LIBINPUT_CONFIG_STATUS_INVALID;
+
+	if (!libinput_device_config_prediction_is_available(device))
+		return millis ? LIBINPUT_CONFIG_STATUS_UNSUPPORTED
+			      : LIBINPUT_CONFIG_STATUS_SUCCESS;
+
+	usec_t horizon = usec_from_millis(millis);
+	return device->config.prediction->set_horizon(device, horizon);
+}
+
+LIBINPUT_EXPORT uint32_t
+libinput_device_config_prediction_get_horizon(struct libinput_device *device)
+{
+	if (!libinput_device_config_prediction_is_available(device))
+		return 0;
+
+	return usec_to_millis(device->config.prediction->get_horizon(device));
+}
+
+LIBINPUT_EXPORT uint32_t
+libinput_device_config_prediction_get_default_horizon(struct libinput_device *device)
+{
+	if (!libinput_device_config_prediction_is_available(device))
+		return 0;
+
+	return usec_to_millis(device->config.prediction->get_default_horizon(device));
+}
+
 LIBINPUT_EXPORT int
 libinput_device_config_rotation_is_available(struct libinput_device *device)
 {
@@ -5243,6 +5644,78 @@ libinput_tablet_tool_config_eraser_button_get_default_button(
 }
 
 #ifdef HAVE_LIBWACOM
+/* Loading the database means parsing every .tablet file, keep it around
+ * for a bit so replugging a tablet doesn't load it again */
+static usec_t LIBWACOM_GRACE_PERIOD = { 30 * 1000000 }; /* µs */
+
+struct libwacom_device_entry {
+	struct list link;
+	unsigned int bustype;
+	unsigned int vid;
+	unsigned int pid;
+	char *name;
+	WacomDevice *device; /* NULL if not known to libwacom */
+};
+
+static void
+libinput_libwacom_grace_timeout(usec_t now, void *data)
+{
+	struct libinput *li = data;
+	struct libwacom_device_entry *entry;
+
+	if (li->libwacom.refcount > 0)
+		return;
+
+	libwacom_database_destroy(li->libwacom.db);
+	li->libwacom.db = NULL;
+
+	/* The next database may know about the devices we failed to look
+	 * up, e.g. after a libwacom update. */
+	list_for_each_safe(entry, &li->libwacom.devices, link) {
+		if (entry->device)
+			continue;
+		free(entry->name);
+		list_remove(&entry->link);
+		free(entry);
+	}
+}
+
+void
+libinput_libwacom_init(struct libinput *li)
+{
+	if (getenv("LIBINPUT_RUNNING_TEST_SUITE"))
+		LIBWACOM_GRACE_PERIOD = usec_from_millis(150);
+
+	list_init(&li->libwacom.devices);
+	libinput_timer_init(&li->libwacom.grace_timer,
+			    li,
+			    "libwacom",
+			    libinput_libwacom_grace_timeout,
+			    li);
+}
+
+void
+libinput_libwacom_destroy(struct libinput *li)
+{
+	struct libwacom_device_entry *entry;
+
+	list_for_each_safe(entry, &li->libwacom.devices, link) {
+		if (entry->device)
+			libwacom_destroy(entry->device);
+		free(entry->name);
+		list_remove(&entry->link);
+		free(entry);
+	}
+
+	libinput_timer_cancel(&li->libwacom.grace_timer);
+	libinput_timer_destroy(&li->libwacom.grace_timer);
+
+	if (li->libwacom.db) {
+		libwacom_database_destroy(li->libwacom.db);
+		li->libwacom.db = NULL;
+	}
+}
+
 WacomDeviceDatabase *
 libinput_libwacom_ref(struct libinput *li)
 {
@@ -5258,6 +5731,7 @@ libinput_libwacom_ref(struct libinput *li)
 		li->libwacom.refcount = 0;
 	}
 
+	libinput_timer_cancel(&li->libwacom.grace_timer);
 	li->libwacom.refcount++;
 	db = li->libwacom.db;
 	return db;
@@ -5271,9 +5745,60 @@ libinput_libwacom_unref(struct libinput *li)
 
 	assert(li->libwacom.refcount >= 1);
 
-	if (--li->libwacom.refcount == 0) {
-		libwacom_database_destroy(li->libwacom.db);
-		li->libwacom.db = NULL;
+	if (--li->libwacom.refcount == 0)
+		libinput_timer_set(&li->libwacom.grace_timer,
+				   usec_add(libinput_now(li), LIBWACOM_GRACE_PERIOD));
+}
+
+/**
+ * Look up the libwacom device for the given evdev node. A successful
+ * lookup is cached for the lifetime of the context, a failed lookup until
+ * the database is released after the grace period.
+ * The returned device is owned by the context and must not be destroyed
+ * by the caller.
+ */
+WacomDevice *
+libinput_libwacom_get_device(struct libinput *li,
+			     const char *sysname,
+			     unsigned int bustype,
+			     unsigned int vid,
+			     unsigned int pid,
+			     const char *name)
+{
+	struct libwacom_device_entry *entry;
+	WacomDeviceDatabase *db;
+	WacomDevice *wacom;
+	char event_path[64];
+
+	list_for_each(entry, &li->libwacom.devices, link) {
+		if (entry->bustype == bustype && entry->vid == vid &&
+		    entry->pid == pid && streq(entry->name, name)) {
+			log_debug(li, "%s: libwacom: using the cached lookup\n", sysname);
+			return entry->device;
+		}
 	}
+
+	db = libinput_libwacom_ref(li);
+	if (!db)
+		return NULL;
+
+	log_debug(li, "%s: libwacom: looking up the device\n", sysname);
+
+	snprintf(event_path, sizeof(event_path), "/dev/input/%s", sysname);
+	wacom = libwacom_new_from_path(db, event_path, WFALLBACK_NONE, NULL);
+	if (!wacom)
+		wacom = libwacom_new_from_usbid(db, vid, pid, NULL);
+
+	libinput_libwacom_unref(li);
+
+	entry = zalloc(sizeof(*entry));
+	entry->bustype = bustype;
+	entry->vid = vid;
+	entry->pid = pid;
+	entry->name = safe_strdup(name);
+	entry->device = wacom;
+	list_insert(&li->libwacom.devices, &entry->link);
+
+	return wacom;
 }
 #endif
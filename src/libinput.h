@@ -1409,6 +1409,53 @@ libinput_event_pointer_get_dx_unaccelerated(struct libinput_event_pointer *event
 double
 libinput_event_pointer_get_dy_unaccelerated(struct libinput_event_pointer *event);
 
+/**
+ * @ingroup event_pointer
+ *
+ * Return the predicted x offset of the pointer, relative to the position
+ * after applying libinput_event_pointer_get_dx(). For pointer events that
+ * are not of type @ref LIBINPUT_EVENT_POINTER_MOTION, this function
+ * returns 0.
+ *
+ * The prediction is where the pointer is expected to be after the
+ * horizon configured with libinput_device_config_prediction_set_horizon(),
+ * in the same coordinate space as libinput_event_pointer_get_dx(). It
+ * is an offset for presentation only and must not be accumulated. When
+ * the motion stops, libinput sends a motion event with a zero delta and
+ * a zero prediction.
+ *
+ * If prediction is disabled on the device, this function returns 0.
+ *
+ * @note It is an application bug to call this function for events other than
+ * @ref LIBINPUT_EVENT_POINTER_MOTION.
+ *
+ * @return The predicted relative x offset of the pointer
+ *
+ * @since 1.32
+ */
+double
+libinput_event_pointer_get_dx_predicted(struct libinput_event_pointer *event);
+
+/**
+ * @ingroup event_pointer
+ *
+ * Return the predicted y offset of the pointer, relative to the position
+ * after applying libinput_event_pointer_get_dy(). For pointer events that
+ * are not of type @ref LIBINPUT_EVENT_POINTER_MOTION, this function
+ * returns 0.
+ *
+ * See libinput_event_pointer_get_dx_predicted() for details.
+ *
+ * @note It is an application bug to call this function for events other than
+ * @ref LIBINPUT_EVENT_POINTER_MOTION.
+ *
+ * @return The predicted relative y offset of the pointer
+ *
+ * @since 1.32
+ */
+double
+libinput_event_pointer_get_dy_predicted(struct libinput_event_pointer *event);
+
 /**
  * @ingroup event_pointer
  *
@@ -3952,6 +3999,55 @@ libinput_resume(struct libinput *libinput);
 void
 libinput_suspend(struct libinput *libinput);
 
+/**
+ * @ingroup base
+ *
+ * The behavior of libinput_suspend() and libinput_resume() for
+ * existing devices.
+ *
+ * @since 1.32
+ */
+enum libinput_suspend_mode {
+	/**
+	 * libinput_suspend() removes all devices, libinput_resume() adds
+	 * them again as new devices. This is the default.
+	 */
+	LIBINPUT_SUSPEND_MODE_REMOVE_DEVICES = 0,
+	/**
+	 * libinput_suspend() closes the devices' file descriptors but keeps
+	 * the devices and their configuration, no @ref
+	 * LIBINPUT_EVENT_DEVICE_REMOVED event is sent. libinput_resume()
+	 * re-opens those devices. A device that is no longer present or
+	 * whose capabilities changed while suspended is removed and, where
+	 * applicable, added again as a new device.
+	 */
+	LIBINPUT_SUSPEND_MODE_KEEP_DEVICES,
+};
+
+/**
+ * @ingroup base
+ *
+ * Set the behavior of libinput_suspend() and libinput_resume() for
+ * existing devices. This is typically used by compositors that suspend
+ * the context on VT switch and would otherwise have to re-apply the
+ * device configuration when the session becomes active again.
+ *
+ * Only contexts created with libinput_udev_create_context() support
+ * @ref LIBINPUT_SUSPEND_MODE_KEEP_DEVICES. Changing the mode while the
+ * context is suspended takes effect on the next libinput_suspend().
+ *
+ * @param libinput A previously initialized libinput context
+ * @param mode The suspend mode
+ *
+ * @return 0 on success or -1 if the mode is not supported by this
+ * context
+ *
+ * @since 1.32
+ */
+int
+libinput_set_suspend_mode(struct libinput *libinput,
+			  enum libinput_suspend_mode mode);
+
 /**
  * @ingroup base
  *
@@ -5907,6 +6003,52 @@ libinput_config_accel_set_points(struct libinput_config_accel *accel_config,
 				 size_t npoints,
 				 const double *points);
 
+/**
+ * @ingroup config
+ *
+ * Defines the acceleration function for a given movement type
+ * in an acceleration configuration with the profile
+ * @ref LIBINPUT_CONFIG_ACCEL_PROFILE_CUSTOM, using control points that
+ * are not necessarily spaced uniformly along the x-axis.
+ *
+ * Movement types are specific to each device, @see libinput_config_accel_type.
+ *
+ * The custom acceleration function is defined by the ``n`` points
+ * (speeds[0], points[0]), (speeds[1], points[1]), ...,
+ * (speeds[n - 1], points[n - 1]).
+ * The x-axis represents the device-speed in device units per millisecond.
+ * The y-axis represents the pointer-speed. The first speed must be 0 and
+ * the speeds must be strictly increasing, the distance between two
+ * consecutive speeds is subject to the same limits as the step in
+ * libinput_config_accel_set_points().
+ *
+ * Unlike libinput_config_accel_set_points(), the curve between the control
+ * points is a monotone cubic interpolation, i.e. it is smooth and does not
+ * overshoot the given points. Beyond the last point the curve is
+ * extrapolated linearly.
+ *
+ * It is up to the user to define those values in accordance with device DPI
+ * and screen DPI.
+ *
+ * @param accel_config The acceleration configuration to modify.
+ * @param accel_type The movement type to configure a custom function for.
+ * @param npoints The number of points of the custom acceleration function.
+ * @param speeds The points' x-values of the custom acceleration function.
+ * @param points The points' y-values of the custom acceleration function.
+ *
+ * @return A config status code.
+ *
+ * @see libinput_config_accel
+ * @see libinput_config_accel_set_points
+ * @since 1.32
+ */
+enum libinput_config_status
+libinput_config_accel_set_curve(struct libinput_config_accel *accel_config,
+				enum libinput_config_accel_type accel_type,
+				size_t npoints,
+				const double *speeds,
+				const double *points);
+
 /**
  * @ingroup config
  *
@@ -7009,6 +7151,87 @@ libinput_device_config_dwtp_get_timeout(struct libinput_device *device);
 uint32_t
 libinput_device_config_dwtp_get_default_timeout(struct libinput_device *device);
 
+/**
+ * @ingroup config
+ *
+ * Check if this device supports motion prediction. With motion
+ * prediction enabled, each @ref LIBINPUT_EVENT_POINTER_MOTION event
+ * carries a prediction of the pointer position a configurable time
+ * ahead, see libinput_event_pointer_get_dx_predicted(). A compositor may
+ * draw the pointer at the predicted position to hide some of the
+ * device's latency.
+ *
+ * @param device The device to configure
+ * @return 0 if this device does not support motion prediction, or 1
+ * otherwise.
+ *
+ * @see libinput_device_config_prediction_set_horizon
+ * @see libinput_device_config_prediction_get_horizon
+ * @see libinput_device_config_prediction_get_default_horizon
+ *
+ * @since 1.32
+ */
+int
+libinput_device_config_prediction_is_available(struct libinput_device *device);
+
+/**
+ * @ingroup config
+ *
+ * Set how far ahead the motion is predicted. A horizon of 0 disables
+ * motion prediction. The maximum horizon is 50ms.
+ *
+ * @param device The device to configure
+ * @param millis The prediction horizon in milliseconds
+ *
+ * @return A config status code. Disabling motion prediction on a device
+ * that does not support it always succeeds.
+ *
+ * @see libinput_device_config_prediction_is_available
+ * @see libinput_device_config_prediction_get_horizon
+ * @see libinput_device_config_prediction_get_default_horizon
+ *
+ * @since 1.32
+ */
+enum libinput_config_status
+libinput_device_config_prediction_set_horizon(struct libinput_device *device,
+					      uint32_t millis);
+
+/**
+ * @ingroup config
+ *
+ * Get the current motion prediction horizon.
+ *
+ * @param device The device to configure
+ * @return The prediction horizon in milliseconds, 0 if disabled or not
+ * available.
+ *
+ * @see libinput_device_config_prediction_is_available
+ * @see libinput_device_config_prediction_set_horizon
+ * @see libinput_device_config_prediction_get_default_horizon
+ *
+ * @since 1.32
+ */
+uint32_t
+libinput_device_config_prediction_get_horizon(struct libinput_device *device);
+
+/**
+ * @ingroup config
+ *
+ * Get the default motion prediction horizon. Motion prediction is
+ * disabled by default.
+ *
+ * @param device The device to configure
+ * @return The default prediction horizon in milliseconds
+ *
+ * @see libinput_device_config_prediction_is_available
+ * @see libinput_device_config_prediction_set_horizon
+ * @see libinput_device_config_prediction_get_horizon
+ *
+ * @since 1.32
+ */
+uint32_t
+libinput_device_config_prediction_get_default_horizon(struct libinput_device *device);
+
 /**
  * @ingroup config
  *
@@ -31,15 +31,22 @@
 #undef NDEBUG /* You don't get to disable asserts here */
 #include <assert.h>
 #include <dirent.h>
+#include <fcntl.h>
 #include <fnmatch.h>
 #include <libgen.h>
 #include <libudev.h>
 #include <stdlib.h>
+#include <sys/inotify.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #ifdef __FreeBSD__
 #include <kenv.h>
 #endif
 
+#include "util-stringbuf.h"
+
 #include "libinput-util.h"
+#include "libinput-version.h"
 #include "libinput-versionsort.h"
 #include "quirks.h"
 
@@ -69,6 +76,18 @@ struct quirk_array {
 	size_t nelements;
 };
 
+union property_value {
+	bool b;
+	uint32_t u;
+	int32_t i;
+	char *s;
+	double d;
+	struct quirk_dimensions dim;
+	struct quirk_range range;
+	struct quirk_tuples tuples;
+	struct quirk_array array;
+};
+
 /**
  * Generic value holder for the property types we support. The type
  * identifies which value in the union is defined and we expect callers to
@@ -80,17 +99,7 @@ struct property {
 
 	enum quirk id;
 	enum property_type type;
-	union {
-		bool b;
-		uint32_t u;
-		int32_t i;
-		char *s;
-		double d;
-		struct quirk_dimensions dim;
-		struct quirk_range range;
-		struct quirk_tuples tuples;
-		struct quirk_array array;
-	} value;
+	union property_value value;
 };
 
 enum match_flags {
@@ -159,12 +168,19 @@ struct section {
 
 	bool has_match;    /* to check for empty sections */
 	bool has_property; /* to check for empty sections */
+	bool cached;       /* strings point into the cache mapping */
+
+	size_t index;         /* position in quirks_context.sections */
+	uint32_t prematched;  /* M_DMI/M_DT bits known to match this context */
 
 	char *name; /* the [Section Name] */
 	struct match match;
 	struct list properties;
 };
 
+#define QUIRK_NMODEL_QUIRKS (_QUIRK_LAST_MODEL_QUIRK_ - QUIRK_MODEL_ALPS_SERIAL_TOUCHPAD)
+#define QUIRK_NATTR_QUIRKS (_QUIRK_LAST_ATTR_QUIRK_ - QUIRK_ATTR_SIZE_HINT)
+
 /**
  * The struct returned to the caller. It contains the
  * properties for a given device.
@@ -177,11 +193,42 @@ struct quirks {
 	struct property **properties;
 	size_t nproperties;
 
+	/* The last property assigned for each quirk, indexed by
+	 * quirk_lookup_index(), see quirks_build_lookup() */
+	struct property *lookup[QUIRK_NMODEL_QUIRKS + QUIRK_NATTR_QUIRKS];
+
 	/* Special properties for AttrEventCode and AttrInputCode, these are
 	 * owned by us, not the section */
 	struct list floating_properties;
 };
 
+/**
+ * A list of sections sharing the same vendor/product key, in the order
+ * of quirks_context.sections.
+ */
+struct quirks_index_bucket {
+	uint64_t key; /* see quirks_index_key() */
+	struct section **sections;
+	size_t nsections;
+};
+
+/**
+ * Lookup index for the sections, built once the context is complete.
+ *
+ * Sections with a MatchVendor are hashed by vendor and product (or
+ * vendor only if they don't have a MatchProduct), all other sections are
+ * on the unkeyed list and checked for every device. Sections whose
+ * MatchDMIModalias or MatchDeviceTree cannot match this context are
+ * not in the index at all.
+ */
+struct quirks_index {
+	struct quirks_index_bucket *buckets;
+	size_t nbuckets; /* power of two */
+
+	struct section **unkeyed;
+	size_t nunkeyed;
+};
+
 /**
  * Quirk matching context, initialized once with quirks_init_subsystem()
  */
@@ -195,10 +242,20 @@ struct quirks_context {
 	char *dmi;
 	char *dt;
 
+	/* where the sections came from, for quirks_context_reload() */
+	char *data_path;
+	char *override_file;
+	char *xdg_quirks_dir;
+
 	struct list sections;
 
 	/* list of quirks handed to libinput, just for bookkeeping */
 	struct list quirks;
+
+	/* mmap'd compiled cache, if any, see quirks_compile_cache() */
+	void *cache;
+	size_t cache_size;
+	struct quirks_index index;
 };
 
 LIBINPUT_ATTRIBUTE_PRINTF(3, 0)
@@ -327,6 +384,8 @@ quirk_get_name(enum quirk q)
 		return "AttrTabletSmoothing";
 	case QUIRK_ATTR_THUMB_SIZE_THRESHOLD:
 		return "AttrThumbSizeThreshold";
+	case QUIRK_ATTR_TOUCHPAD_MAX_FRAME_RATE:
+		return "AttrTouchpadMaxFrameRate";
 	case QUIRK_ATTR_MSC_TIMESTAMP:
 		return "AttrMscTimestamp";
 	case QUIRK_ATTR_EVENT_CODE:
@@ -575,14 +634,19 @@ section_destroy(struct section *s)
 {
 	struct property *p;
 
-	free(s->name);
-	free(s->match.name);
-	free(s->match.uniq);
-	free(s->match.dmi);
-	free(s->match.dt);
+	if (!s->cached) {
+		free(s->name);
+		free(s->match.name);
+		free(s->match.uniq);
+		free(s->match.dmi);
+		free(s->match.dt);
+	}
 
-	list_for_each_safe(p, &s->properties, link)
+	list_for_each_safe(p, &s->properties, link) {
+		if (s->cached && p->type == PT_STRING)
+			p->value.s = NULL;
 		property_cleanup(p);
+	}
 
 	assert(list_empty(&s->properties));
 
@@ -895,6 +959,13 @@ parse_attr(struct quirks_context *ctx,
 		p->type = PT_UINT;
 		p->value.u = v;
 		rc = true;
+	} else if (streq(key, quirk_get_name(QUIRK_ATTR_TOUCHPAD_MAX_FRAME_RATE))) {
+		p->id = QUIRK_ATTR_TOUCHPAD_MAX_FRAME_RATE;
+		if (!safe_atou(value, &v))
+			goto out;
+		p->type = PT_UINT;
+		p->value.u = v;
+		rc = true;
 	} else if (streq(key, quirk_get_name(QUIRK_ATTR_MSC_TIMESTAMP))) {
 		p->id = QUIRK_ATTR_MSC_TIMESTAMP;
 		if (!streq(value, "watch"))
@@ -1205,6 +1276,20 @@ is_data_file(const struct dirent *dir)
 	return strendswith(dir->d_name, ".quirks");
 }
 
+static inline int
+scan_data_files(const char *data_path, struct dirent ***namelist)
+{
+	return scandir(data_path, namelist, is_data_file, versionsort);
+}
+
+static inline void
+free_namelist(struct dirent **namelist, int n)
+{
+	for (int i = 0; i < n; i++)
+		free(namelist[i]);
+	free(namelist);
+}
+
 static inline bool
 parse_files(struct quirks_context *ctx,
 	    const char *data_path,
@@ -1214,7 +1299,7 @@ parse_files(struct quirks_context *ctx,
 	int ndev = -1;
 	int idx = 0;
 
-	ndev = scandir(data_path, &namelist, is_data_file, versionsort);
+	ndev = scan_data_files(data_path, &namelist);
 	if (ndev <= 0) {
 		if (allow_empty_directory)
 			return true;
@@ -1232,23 +1317,672 @@ parse_files(struct quirks_context *ctx,
 			break;
 	}
 
-	for (int i = 0; i < ndev; i++)
-		free(namelist[i]);
-	free(namelist);
+	free_namelist(namelist, ndev);
 
 	return idx == ndev;
 }
 
-struct quirks_context *
-quirks_init_subsystem(const char *data_path,
-		      const char *override_file,
-		      libinput_log_handler log_handler,
-		      struct libinput *libinput,
-		      enum quirks_log_type log_type)
+/* The compiled cache is a single file in the data directory:
+ *
+ *   struct quirks_cache_header
+ *   struct quirks_cache_source[nsources]
+ *   struct quirks_cache_section[nsections]
+ *   struct quirks_cache_property[nproperties]
+ *   char strings[strings_size]
+ *
+ * Each block starts 8-byte aligned. All strings are offsets into the
+ * string table, offset 0 is the empty string and means "not set".
+ *
+ * The cache is only used if the list of data files and their size and
+ * mtime still match the sources it was compiled from. Anything else
+ * (the override file, the XDG runtime directory) is always parsed.
+ */
+#define QUIRKS_CACHE_MAGIC "LIQUIRKC"
+#define QUIRKS_CACHE_VERSION 1
+
+struct quirks_cache_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t value_size; /* sizeof(union property_value) */
+	uint32_t last_model_quirk;
+	uint32_t last_attr_quirk;
+	char libinput_version[32];
+	uint32_t nsources;
+	uint32_t nsections;
+	uint32_t nproperties;
+	uint32_t strings_size;
+};
+
+struct quirks_cache_source {
+	uint32_t filename;
+	uint32_t padding;
+	int64_t size;
+	int64_t mtime_sec;
+	int64_t mtime_nsec;
+};
+
+struct quirks_cache_section {
+	uint32_t name;
+	uint32_t first_property;
+	uint32_t nproperties;
+	uint32_t bits;
+	uint32_t match_name;
+	uint32_t match_uniq;
+	uint32_t match_dmi;
+	uint32_t match_dt;
+	uint32_t bus;
+	uint32_t vendor;
+	uint32_t version;
+	uint32_t udev_type;
+	uint32_t product[64];
+};
+
+struct quirks_cache_property {
+	uint32_t id;
+	uint32_t type;
+	union property_value value; /* for PT_STRING value.u is the offset */
+};
+
+struct quirks_cache_layout {
+	size_t sources;
+	size_t sections;
+	size_t properties;
+	size_t strings;
+	size_t size;
+};
+
+static inline size_t
+quirks_cache_align(size_t offset)
 {
-	_unref_(quirks_context) *ctx = zalloc(sizeof *ctx);
+	return (offset + 7) & ~(size_t)7;
+}
 
-	assert(data_path);
+static struct quirks_cache_layout
+quirks_cache_get_layout(const struct quirks_cache_header *hdr)
+{
+	struct quirks_cache_layout l;
+
+	l.sources = quirks_cache_align(sizeof(*hdr));
+	l.sections = quirks_cache_align(
+		l.sources + hdr->nsources * sizeof(struct quirks_cache_source));
+	l.properties = quirks_cache_align(
+		l.sections + hdr->nsections * sizeof(struct quirks_cache_section));
+	l.strings = quirks_cache_align(
+		l.properties +
+		hdr->nproperties * sizeof(struct quirks_cache_property));
+	l.size = l.strings + hdr->strings_size;
+
+	return l;
+}
+
+static inline void
+quirks_cache_init_header(struct quirks_cache_header *hdr)
+{
+	memset(hdr, 0, sizeof(*hdr));
+	memcpy(hdr->magic, QUIRKS_CACHE_MAGIC, sizeof(hdr->magic));
+	hdr->version = QUIRKS_CACHE_VERSION;
+	hdr->value_size = sizeof(union property_value);
+	hdr->last_model_quirk = _QUIRK_LAST_MODEL_QUIRK_;
+	hdr->last_attr_quirk = _QUIRK_LAST_ATTR_QUIRK_;
+	snprintf(hdr->libinput_version,
+		 sizeof(hdr->libinput_version),
+		 "%s",
+		 LIBINPUT_VERSION);
+}
+
+static inline bool
+quirks_cache_source_matches(const struct quirks_cache_source *src,
+			    const struct stat *st)
+{
+	return src->size == (int64_t)st->st_size &&
+	       src->mtime_sec == (int64_t)st->st_mtim.tv_sec &&
+	       src->mtime_nsec == (int64_t)st->st_mtim.tv_nsec;
+}
+
+static inline void
+quirks_cache_source_fill(struct quirks_cache_source *src, const struct stat *st)
+{
+	src->size = st->st_size;
+	src->mtime_sec = st->st_mtim.tv_sec;
+	src->mtime_nsec = st->st_mtim.tv_nsec;
+}
+
+static uint32_t
+quirks_cache_add_string(struct stringbuf *strings, const char *str)
+{
+	size_t offset = strings->len;
+
+	if (!str)
+		return 0;
+
+	if (stringbuf_append_string(strings, str) < 0)
+		abort();
+	strings->len++; /* keep the terminating null byte */
+
+	return offset;
+}
+
+static bool
+quirks_cache_write(struct quirks_context *ctx,
+		   const char *data_path,
+		   struct dirent **namelist,
+		   int nfiles)
+{
+	struct quirks_cache_header hdr;
+	struct section *s;
+	struct property *p;
+	size_t nsections = 0, nproperties = 0;
+
+	quirks_cache_init_header(&hdr);
+
+	list_for_each(s, &ctx->sections, link) {
+		nsections++;
+		list_for_each(p, &s->properties, link)
+			nproperties++;
+	}
+
+	_autofree_ struct quirks_cache_source *sources =
+		zalloc(nfiles * sizeof(*sources));
+	_autofree_ struct quirks_cache_section *sections =
+		zalloc(max(nsections, 1U) * sizeof(*sections));
+	_autofree_ struct quirks_cache_property *properties =
+		zalloc(max(nproperties, 1U) * sizeof(*properties));
+	_destroy_(stringbuf) *strings = stringbuf_new();
+	strings->len = 1; /* offset 0 is the empty string */
+
+	for (int i = 0; i < nfiles; i++) {
+		char path[PATH_MAX];
+		struct stat st;
+
+		snprintf(path, sizeof(path), "%s/%s", data_path, namelist[i]->d_name);
+		if (stat(path, &st) < 0) {
+			qlog_error(ctx, "%s: failed to stat: %m\n", path);
+			return false;
+		}
+
+		sources[i].filename =
+			quirks_cache_add_string(strings, namelist[i]->d_name);
+		quirks_cache_source_fill(&sources[i], &st);
+	}
+
+	size_t sidx = 0, pidx = 0;
+	list_for_each(s, &ctx->sections, link) {
+		struct quirks_cache_section *cs = &sections[sidx++];
+
+		cs->name = quirks_cache_add_string(strings, s->name);
+		cs->first_property = pidx;
+		cs->bits = s->match.bits;
+		cs->match_name = quirks_cache_add_string(strings, s->match.name);
+		cs->match_uniq = quirks_cache_add_string(strings, s->match.uniq);
+		cs->match_dmi = quirks_cache_add_string(strings, s->match.dmi);
+		cs->match_dt = quirks_cache_add_string(strings, s->match.dt);
+		cs->bus = s->match.bus;
+		cs->vendor = s->match.vendor;
+		cs->version = s->match.version;
+		cs->udev_type = s->match.udev_type;
+		memcpy(cs->product, s->match.product, sizeof(cs->product));
+
+		list_for_each(p, &s->properties, link) {
+			struct quirks_cache_property *cp = &properties[pidx++];
+
+			cp->id = p->id;
+			cp->type = p->type;
+			if (p->type == PT_STRING)
+				cp->value.u = quirks_cache_add_string(strings,
+								      p->value.s);
+			else
+				cp->value = p->value;
+			cs->nproperties++;
+		}
+	}
+
+	hdr.nsources = nfiles;
+	hdr.nsections = nsections;
+	hdr.nproperties = nproperties;
+	hdr.strings_size = strings->len;
+
+	struct quirks_cache_layout layout = quirks_cache_get_layout(&hdr);
+	_autofree_ char *data = zalloc(layout.size);
+	memcpy(data, &hdr, sizeof(hdr));
+	memcpy(data + layout.sources, sources, nfiles * sizeof(*sources));
+	memcpy(data + layout.sections, sections, nsections * sizeof(*sections));
+	memcpy(data + layout.properties, properties, nproperties * sizeof(*properties));
+	memcpy(data + layout.strings, strings->data, strings->len);
+
+	/* Write to a temporary file and rename it so a concurrent
+	 * quirks_init_subsystem() never sees a partial file */
+	_autofree_ char *cache_path =
+		strdup_printf("%s/%s", data_path, QUIRKS_CACHE_FILENAME);
+	_autofree_ char *tmp_path = strdup_printf("%s.XXXXXX", cache_path);
+	int fd = mkostemp(tmp_path, O_CLOEXEC);
+	if (fd < 0) {
+		qlog_error(ctx, "%s: failed to create file: %m\n", tmp_path);
+		return false;
+	}
+
+	size_t written = 0;
+	while (written < layout.size) {
+		ssize_t rc = write(fd, data + written, layout.size - written);
+		if (rc < 0) {
+			if (errno == EINTR)
+				continue;
+			qlog_error(ctx, "%s: failed to write: %m\n", tmp_path);
+			break;
+		}
+		written += rc;
+	}
+
+	if (written < layout.size || fchmod(fd, 0644) < 0 ||
+	    rename(tmp_path, cache_path) < 0) {
+		if (written == layout.size)
+			qlog_error(ctx, "%s: failed to install: %m\n", cache_path);
+		close(fd);
+		unlink(tmp_path);
+		return false;
+	}
+
+	close(fd);
+
+	qlog_info(ctx,
+		  "%s: compiled %zu sections from %d files\n",
+		  cache_path,
+		  nsections,
+		  nfiles);
+
+	return true;
+}
+
+static inline const char *
+quirks_cache_string(const char *strings, uint32_t offset)
+{
+	return offset ? &strings[offset] : NULL;
+}
+
+static bool
+quirks_cache_is_fresh(const char *data_path,
+		      const struct quirks_cache_header *hdr,
+		      const struct quirks_cache_source *sources,
+		      const char *strings)
+{
+	struct dirent **namelist;
+	bool fresh = false;
+	int nfiles = scan_data_files(data_path, &namelist);
+
+	if (nfiles <= 0)
+		return false;
+
+	if ((uint32_t)nfiles != hdr->nsources)
+		goto out;
+
+	for (int i = 0; i < nfiles; i++) {
+		const struct quirks_cache_source *src = &sources[i];
+		char path[PATH_MAX];
+		struct stat st;
+
+		if (!streq(namelist[i]->d_name, &strings[src->filename]))
+			goto out;
+
+		snprintf(path, sizeof(path), "%s/%s", data_path, namelist[i]->d_name);
+		if (stat(path, &st) < 0 || !quirks_cache_source_matches(src, &st))
+			goto out;
+	}
+
+	fresh = true;
+out:
+	free_namelist(namelist, nfiles);
+	return fresh;
+}
+
+static inline bool
+quirks_cache_string_is_valid(const struct quirks_cache_header *hdr, uint32_t offset)
+{
+	return offset < hdr->strings_size;
+}
+
+static bool
+quirks_cache_is_valid(const struct quirks_cache_header *hdr,
+		      const struct quirks_cache_source *sources,
+		      const struct quirks_cache_section *sections,
+		      const struct quirks_cache_property *properties,
+		      const char *strings)
+{
+	/* strings are null-terminated and the table ends with one, so any
+	 * offset within the table is a valid string */
+	if (hdr->strings_size == 0 || strings[hdr->strings_size - 1] != '\0')
+		return false;
+
+	for (uint32_t i = 0; i < hdr->nsources; i++) {
+		if (!quirks_cache_string_is_valid(hdr, sources[i].filename))
+			return false;
+	}
+
+	for (uint32_t i = 0; i < hdr->nsections; i++) {
+		const struct quirks_cache_section *cs = &sections[i];
+
+		if (!quirks_cache_string_is_valid(hdr, cs->name) ||
+		    !quirks_cache_string_is_valid(hdr, cs->match_name) ||
+		    !quirks_cache_string_is_valid(hdr, cs->match_uniq) ||
+		    !quirks_cache_string_is_valid(hdr, cs->match_dmi) ||
+		    !quirks_cache_string_is_valid(hdr, cs->match_dt))
+			return false;
+
+		if (cs->first_property > hdr->nproperties ||
+		    cs->nproperties > hdr->nproperties - cs->first_property)
+			return false;
+
+		if (cs->bits & ~(M_LAST | (M_LAST - 1)))
+			return false;
+
+		/* the matching code relies on these being set */
+		if (((cs->bits & M_NAME) && !cs->match_name) ||
+		    ((cs->bits & M_UNIQ) && !cs->match_uniq) ||
+		    ((cs->bits & M_DMI) && !cs->match_dmi) ||
+		    ((cs->bits & M_DT) && !cs->match_dt))
+			return false;
+
+		if (cs->product[ARRAY_LENGTH(cs->product) - 1] != 0)
+			return false;
+	}
+
+	for (uint32_t i = 0; i < hdr->nproperties; i++) {
+		const struct quirks_cache_property *cp = &properties[i];
+		bool valid_id =
+			(cp->id >= QUIRK_MODEL_ALPS_SERIAL_TOUCHPAD &&
+			 cp->id < _QUIRK_LAST_MODEL_QUIRK_) ||
+			(cp->id >= QUIRK_ATTR_SIZE_HINT && cp->id < _QUIRK_LAST_ATTR_QUIRK_);
+
+		if (!valid_id || cp->type > PT_UINT_ARRAY)
+			return false;
+
+		if (cp->type == PT_STRING &&
+		    (!cp->value.u || !quirks_cache_string_is_valid(hdr, cp->value.u)))
+			return false;
+
+		if (cp->type == PT_TUPLES &&
+		    cp->value.tuples.ntuples > ARRAY_LENGTH(cp->value.tuples.tuples))
+			return false;
+
+		if (cp->type == PT_UINT_ARRAY &&
+		    cp->value.array.nelements > ARRAY_LENGTH(cp->value.array.data.u))
+			return false;
+	}
+
+	return true;
+}
+
+/**
+ * Load the sections from the compiled cache in data_path if it exists and
+ * is still up-to-date with the data files. The cache is mapped for the
+ * lifetime of the context and all strings point into that mapping.
+ *
+ * @return true if the sections were loaded from the cache
+ */
+static bool
+quirks_cache_load(struct quirks_context *ctx, const char *data_path)
+{
+	_autofree_ char *cache_path =
+		strdup_printf("%s/%s", data_path, QUIRKS_CACHE_FILENAME);
+	struct quirks_cache_header expected;
+	struct stat st;
+	void *map;
+
+	int fd = open(cache_path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return false;
+
+	if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(expected)) {
+		close(fd);
+		return false;
+	}
+
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return false;
+
+	const struct quirks_cache_header *hdr = map;
+	quirks_cache_init_header(&expected);
+	if (memcmp(hdr->magic, expected.magic, sizeof(hdr->magic)) != 0 ||
+	    hdr->version != expected.version ||
+	    hdr->value_size != expected.value_size ||
+	    hdr->last_model_quirk != expected.last_model_quirk ||
+	    hdr->last_attr_quirk != expected.last_attr_quirk ||
+	    memcmp(hdr->libinput_version,
+		   expected.libinput_version,
+		   sizeof(hdr->libinput_version)) != 0) {
+		qlog_debug(ctx, "%s: incompatible cache, ignoring\n", cache_path);
+		goto error;
+	}
+
+	/* guard against overflow in the layout calculation */
+	if (hdr->nsources > st.st_size || hdr->nsections > st.st_size ||
+	    hdr->nproperties > st.st_size || hdr->strings_size > st.st_size)
+		goto error;
+
+	struct quirks_cache_layout layout = quirks_cache_get_layout(hdr);
+	if (layout.size != (size_t)st.st_size)
+		goto error;
+
+	const char *base = map;
+	const struct quirks_cache_source *sources =
+		(const struct quirks_cache_source *)(base + layout.sources);
+	const struct quirks_cache_section *sections =
+		(const struct quirks_cache_section *)(base + layout.sections);
+	const struct quirks_cache_property *properties =
+		(const struct quirks_cache_property *)(base + layout.properties);
+	const char *strings = base + layout.strings;
+
+	if (!quirks_cache_is_valid(hdr, sources, sections, properties, strings)) {
+		qlog_error(ctx, "%s: cache is corrupt, ignoring\n", cache_path);
+		goto error;
+	}
+
+	if (!quirks_cache_is_fresh(data_path, hdr, sources, strings)) {
+		qlog_debug(ctx, "%s: cache is stale, ignoring\n", cache_path);
+		goto error;
+	}
+
+	for (uint32_t i = 0; i < hdr->nsections; i++) {
+		const struct quirks_cache_section *cs = &sections[i];
+		struct section *s = zalloc(sizeof(*s));
+
+		list_init(&s->properties);
+		s->cached = true;
+		s->has_match = true;
+		s->has_property = true;
+		s->name = (char *)quirks_cache_string(strings, cs->name);
+		s->match.bits = cs->bits;
+		s->match.name = (char *)quirks_cache_string(strings, cs->match_name);
+		s->match.uniq = (char *)quirks_cache_string(strings, cs->match_uniq);
+		s->match.dmi = (char *)quirks_cache_string(strings, cs->match_dmi);
+		s->match.dt = (char *)quirks_cache_string(strings, cs->match_dt);
+		s->match.bus = cs->bus;
+		s->match.vendor = cs->vendor;
+		s->match.version = cs->version;
+		s->match.udev_type = cs->udev_type;
+		memcpy(s->match.product, cs->product, sizeof(s->match.product));
+
+		for (uint32_t j = 0; j < cs->nproperties; j++) {
+			const struct quirks_cache_property *cp =
+				&properties[cs->first_property + j];
+			struct property *p = property_new();
+
+			p->id = cp->id;
+			p->type = cp->type;
+			if (p->type == PT_STRING)
+				p->value.s = (char *)quirks_cache_string(strings,
+									 cp->value.u);
+			else
+				p->value = cp->value;
+			list_append(&s->properties, &p->link);
+		}
+
+		list_append(&ctx->sections, &s->link);
+	}
+
+	ctx->cache = map;
+	ctx->cache_size = st.st_size;
+
+	qlog_debug(ctx,
+		   "%s: loaded %u sections from cache\n",
+		   cache_path,
+		   hdr->nsections);
+
+	return true;
+
+error:
+	munmap(map, st.st_size);
+	return false;
+}
+
+static inline uint64_t
+quirks_index_key(uint32_t vendor, uint32_t product)
+{
+	/* product 0 is the terminator in match.product and means
+	 * "any product" here */
+	return ((uint64_t)vendor << 32) | product;
+}
+
+static inline size_t
+quirks_index_hash(uint64_t key, size_t nbuckets)
+{
+	/* Fibonacci hashing, vid/pid are anything but random */
+	return (key * 0x9e3779b97f4a7c15ULL) >> 32 & (nbuckets - 1);
+}
+
+static struct quirks_index_bucket *
+quirks_index_find(const struct quirks_index *index, uint64_t key)
+{
+	if (index->nbuckets == 0)
+		return NULL;
+
+	size_t idx = quirks_index_hash(key, index->nbuckets);
+	while (index->buckets[idx].sections) {
+		if (index->buckets[idx].key == key)
+			return &index->buckets[idx];
+		idx = (idx + 1) & (index->nbuckets - 1);
+	}
+
+	return NULL;
+}
+
+static void
+quirks_index_insert(struct quirks_index *index, uint64_t key, struct section *s)
+{
+	size_t idx = quirks_index_hash(key, index->nbuckets);
+	struct quirks_index_bucket *b;
+
+	while (index->buckets[idx].sections && index->buckets[idx].key != key)
+		idx = (idx + 1) & (index->nbuckets - 1);
+
+	b = &index->buckets[idx];
+	b->key = key;
+
+	/* sections are inserted in order, so a duplicate MatchProduct
+	 * entry shows up as the last element */
+	if (b->nsections > 0 && b->sections[b->nsections - 1] == s)
+		return;
+
+	b->sections = realloc(b->sections, (b->nsections + 1) * sizeof(*b->sections));
+	if (!b->sections)
+		abort();
+	b->sections[b->nsections++] = s;
+}
+
+static void
+quirks_index_build(struct quirks_context *ctx)
+{
+	struct quirks_index *index = &ctx->index;
+	struct section *s;
+	size_t nsections = 0, nkeys = 0;
+
+	list_for_each(s, &ctx->sections, link) {
+		s->index = nsections++;
+		s->prematched = 0;
+
+		/* DMI and DT never change for a context, so check once
+		 * here instead of on every device */
+		if (s->match.bits & M_DMI) {
+			if (!ctx->dmi || fnmatch(s->match.dmi, ctx->dmi, 0) != 0)
+				continue;
+			s->prematched |= M_DMI;
+		}
+		if (s->match.bits & M_DT) {
+			if (!ctx->dt || fnmatch(s->match.dt, ctx->dt, 0) != 0)
+				continue;
+			s->prematched |= M_DT;
+		}
+
+		if (s->match.bits & M_VID) {
+			if (s->match.bits & M_PID) {
+				ARRAY_FOR_EACH(s->match.product, pid) {
+					if (*pid == 0)
+						break;
+					nkeys++;
+				}
+			} else {
+				nkeys++;
+			}
+		} else {
+			index->nunkeyed++;
+		}
+	}
+
+	/* keep the load factor at or below 0.5 */
+	index->nbuckets = 1;
+	while (index->nbuckets < nkeys * 2)
+		index->nbuckets <<= 1;
+	index->buckets = zalloc(index->nbuckets * sizeof(*index->buckets));
+	index->unkeyed = zalloc(max(index->nunkeyed, 1U) * sizeof(*index->unkeyed));
+	index->nunkeyed = 0;
+
+	list_for_each(s, &ctx->sections, link) {
+		uint32_t vendor = s->match.vendor;
+
+		if ((s->match.bits & (M_DMI | M_DT)) != s->prematched)
+			continue;
+
+		if (!(s->match.bits & M_VID)) {
+			index->unkeyed[index->nunkeyed++] = s;
+		} else if (s->match.bits & M_PID) {
+			ARRAY_FOR_EACH(s->match.product, pid) {
+				if (*pid == 0)
+					break;
+				quirks_index_insert(index,
+						    quirks_index_key(vendor, *pid),
+						    s);
+			}
+		} else {
+			quirks_index_insert(index, quirks_index_key(vendor, 0), s);
+		}
+	}
+
+	qlog_debug(ctx,
+		   "indexed %zu sections, %zu keys, %zu unkeyed\n",
+		   nsections,
+		   nkeys,
+		   index->nunkeyed);
+}
+
+static void
+quirks_index_destroy(struct quirks_index *index)
+{
+	for (size_t i = 0; i < index->nbuckets; i++)
+		free(index->buckets[i].sections);
+	free(index->buckets);
+	free(index->unkeyed);
+	index->buckets = NULL;
+	index->unkeyed = NULL;
+	index->nbuckets = 0;
+	index->nunkeyed = 0;
+}
+
+static struct quirks_context *
+quirks_context_new(libinput_log_handler log_handler,
+		   struct libinput *libinput,
+		   enum quirks_log_type log_type)
+{
+	struct quirks_context *ctx = zalloc(sizeof *ctx);
 
 	ctx->refcount = 1;
 	ctx->log_handler = log_handler;
@@ -1257,6 +1991,21 @@ quirks_init_subsystem(const char *data_path,
 	list_init(&ctx->quirks);
 	list_init(&ctx->sections);
 
+	return ctx;
+}
+
+struct quirks_context *
+quirks_init_subsystem(const char *data_path,
+		      const char *override_file,
+		      libinput_log_handler log_handler,
+		      struct libinput *libinput,
+		      enum quirks_log_type log_type)
+{
+	_unref_(quirks_context) *ctx =
+		quirks_context_new(log_handler, libinput, log_type);
+
+	assert(data_path);
+
 	qlog_debug(ctx, "%s is data root\n", data_path);
 
 	ctx->dmi = init_dmi();
@@ -1264,7 +2013,7 @@ quirks_init_subsystem(const char *data_path,
 	if (!ctx->dmi && !ctx->dt)
 		return NULL;
 
-	if (!parse_files(ctx, data_path, false))
+	if (!quirks_cache_load(ctx, data_path) && !parse_files(ctx, data_path, false))
 		return NULL;
 
 	if (override_file && !parse_file(ctx, override_file))
@@ -1279,9 +2028,87 @@ quirks_init_subsystem(const char *data_path,
 	if (!parse_files(ctx, xdg_runtime_quirks_dir, true))
 		return NULL;
 
+	quirks_index_build(ctx);
+
+	ctx->data_path = safe_strdup(data_path);
+	ctx->override_file = safe_strdup(override_file);
+	ctx->xdg_quirks_dir = steal(&xdg_runtime_quirks_dir);
+
 	return steal(&ctx);
 }
 
+struct quirks_context *
+quirks_context_reload(struct quirks_context *ctx)
+{
+	return quirks_init_subsystem(ctx->data_path,
+				     ctx->override_file,
+				     ctx->log_handler,
+				     ctx->libinput,
+				     ctx->log_type);
+}
+
+int
+quirks_context_add_watches(struct quirks_context *ctx, int inotify_fd)
+{
+	const uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM |
+			      IN_DELETE | IN_ONLYDIR;
+	_autofree_ char *override_dir = NULL;
+	const char *dirs[3] = { ctx->data_path, ctx->xdg_quirks_dir, NULL };
+	int nwatches = 0;
+
+	if (ctx->override_file) {
+		override_dir = safe_strdup(ctx->override_file);
+		dirs[2] = dirname(override_dir);
+	}
+
+	ARRAY_FOR_EACH(dirs, d) {
+		if (!*d)
+			continue;
+
+		/* The XDG and override directories usually don't exist */
+		if (inotify_add_watch(inotify_fd, *d, mask) < 0) {
+			qlog_debug(ctx, "%s: not watching for changes: %m\n", *d);
+			continue;
+		}
+
+		qlog_debug(ctx, "%s: watching for changes\n", *d);
+		nwatches++;
+	}
+
+	return nwatches;
+}
+
+bool
+quirks_compile_cache(const char *data_path,
+		     libinput_log_handler log_handler,
+		     enum quirks_log_type log_type)
+{
+	_unref_(quirks_context) *ctx = quirks_context_new(log_handler, NULL, log_type);
+	struct dirent **namelist;
+	bool rc = false;
+
+	assert(data_path);
+
+	int nfiles = scan_data_files(data_path, &namelist);
+	if (nfiles <= 0) {
+		qlog_error(ctx, "%s: failed to find data files\n", data_path);
+		return false;
+	}
+
+	for (int i = 0; i < nfiles; i++) {
+		char path[PATH_MAX];
+
+		snprintf(path, sizeof(path), "%s/%s", data_path, namelist[i]->d_name);
+		if (!parse_file(ctx, path))
+			goto out;
+	}
+
+	rc = quirks_cache_write(ctx, data_path, namelist, nfiles);
+out:
+	free_namelist(namelist, nfiles);
+	return rc;
+}
+
 struct quirks_context *
 quirks_context_ref(struct quirks_context *ctx)
 {
@@ -1312,13 +2139,44 @@ quirks_context_unref(struct quirks_context *ctx)
 		section_destroy(s);
 	}
 
+	quirks_index_destroy(&ctx->index);
+
+	if (ctx->cache)
+		munmap(ctx->cache, ctx->cache_size);
+
 	free(ctx->dmi);
 	free(ctx->dt);
+	free(ctx->data_path);
+	free(ctx->override_file);
+	free(ctx->xdg_quirks_dir);
 	free(ctx);
 
 	return NULL;
 }
 
+static inline ssize_t
+quirk_lookup_index(enum quirk which)
+{
+	if (which >= QUIRK_MODEL_ALPS_SERIAL_TOUCHPAD && which < _QUIRK_LAST_MODEL_QUIRK_)
+		return which - QUIRK_MODEL_ALPS_SERIAL_TOUCHPAD;
+	if (which >= QUIRK_ATTR_SIZE_HINT && which < _QUIRK_LAST_ATTR_QUIRK_)
+		return QUIRK_NMODEL_QUIRKS + which - QUIRK_ATTR_SIZE_HINT;
+	return -1;
+}
+
+static void
+quirks_build_lookup(struct quirks *q)
+{
+	/* Sections are applied in order, so the last property wins */
+	for (size_t i = 0; i < q->nproperties; i++) {
+		struct property *p = q->properties[i];
+		ssize_t idx = quirk_lookup_index(p->id);
+
+		assert(idx >= 0);
+		q->lookup[idx] = p;
+	}
+}
+
 static struct quirks *
 quirks_new(void)
 {
@@ -1333,15 +2191,25 @@ quirks_new(void)
 	return q;
 }
 
+struct quirks *
+quirks_ref(struct quirks *q)
+{
+	assert(q->refcount > 0);
+	q->refcount++;
+
+	return q;
+}
+
 struct quirks *
 quirks_unref(struct quirks *q)
 {
 	if (!q)
 		return NULL;
 
-	/* We don't really refcount, but might
-	 * as well have the API in place */
-	assert(q->refcount == 1);
+	assert(q->refcount > 0);
+	q->refcount--;
+	if (q->refcount > 0)
+		return NULL;
 
 	for (size_t i = 0; i < q->nproperties; i++) {
 		property_unref(q->properties[i]);
@@ -1682,11 +2550,9 @@ quirk_match_section(struct quirks_context *ctx,
 				matched_flags |= flag;
 			break;
 		case M_DMI:
-			if (fnmatch(s->match.dmi, m->dmi, 0) == 0)
-				matched_flags |= flag;
-			break;
 		case M_DT:
-			if (fnmatch(s->match.dt, m->dt, 0) == 0)
+			/* checked once in quirks_index_build() */
+			if (s->prematched & flag)
 				matched_flags |= flag;
 			break;
 		case M_UDEV_TYPE:
@@ -1724,8 +2590,49 @@ quirks_fetch_for_device(struct quirks_context *ctx, struct udev_device *udev_dev
 	_unref_(quirks) *q = quirks_new();
 	_free_(match) *m = match_new(udev_device, ctx->dmi, ctx->dt);
 
-	struct section *s;
-	list_for_each(s, &ctx->sections, link) {
+	/* Candidates are the sections for our vendor/product, the ones for
+	 * our vendor and any product, and the unkeyed ones. Each list is
+	 * in section order, merge them so later sections still override
+	 * earlier ones. */
+	struct section *const *lists[3] = { ctx->index.unkeyed, NULL, NULL };
+	size_t lens[3] = { ctx->index.nunkeyed, 0, 0 };
+	size_t pos[3] = { 0 };
+
+	if (m->bits & M_VID) {
+		const struct quirks_index_bucket *b = NULL;
+
+		/* product 0 would look up the vendor-only bucket */
+		if (m->product[0] != 0)
+			b = quirks_index_find(&ctx->index,
+					      quirks_index_key(m->vendor,
+							       m->product[0]));
+		if (b) {
+			lists[1] = b->sections;
+			lens[1] = b->nsections;
+		}
+		b = quirks_index_find(&ctx->index, quirks_index_key(m->vendor, 0));
+		if (b) {
+			lists[2] = b->sections;
+			lens[2] = b->nsections;
+		}
+	}
+
+	while (true) {
+		struct section *s = NULL;
+		size_t which = 0;
+
+		for (size_t i = 0; i < ARRAY_LENGTH(lists); i++) {
+			if (pos[i] == lens[i])
+				continue;
+			if (!s || lists[i][pos[i]]->index < s->index) {
+				s = lists[i][pos[i]];
+				which = i;
+			}
+		}
+		if (!s)
+			break;
+
+		pos[which]++;
 		quirk_match_section(ctx, q, s, m, udev_device);
 	}
 
@@ -1733,6 +2640,7 @@ quirks_fetch_for_device(struct quirks_context *ctx, struct udev_device *udev_dev
 		return NULL;
 	}
 
+	quirks_build_lookup(q);
 	list_insert(&ctx->quirks, &q->link);
 
 	return steal(&q);
@@ -1741,14 +2649,69 @@ quirks_fetch_for_device(struct quirks_context *ctx, struct udev_device *udev_dev
 static inline struct property *
 quirk_find_prop(struct quirks *q, enum quirk which)
 {
-	/* Run backwards to only handle the last one assigned */
-	for (ssize_t i = q->nproperties - 1; i >= 0; i--) {
-		struct property *p = q->properties[i];
-		if (p->id == which)
-			return p;
+	ssize_t idx = quirk_lookup_index(which);
+
+	return idx >= 0 ? q->lookup[idx] : NULL;
+}
+
+static bool
+property_value_equal(const struct property *a, const struct property *b)
+{
+	if (a->type != b->type)
+		return false;
+
+	switch (a->type) {
+	case PT_UINT:
+		return a->value.u == b->value.u;
+	case PT_INT:
+		return a->value.i == b->value.i;
+	case PT_STRING:
+		return streq(a->value.s, b->value.s);
+	case PT_BOOL:
+		return a->value.b == b->value.b;
+	case PT_DIMENSION:
+		return a->value.dim.x == b->value.dim.x &&
+		       a->value.dim.y == b->value.dim.y;
+	case PT_RANGE:
+		return a->value.range.lower == b->value.range.lower &&
+		       a->value.range.upper == b->value.range.upper;
+	case PT_DOUBLE:
+		return a->value.d == b->value.d;
+	case PT_TUPLES:
+		return a->value.tuples.ntuples == b->value.tuples.ntuples &&
+		       memcmp(a->value.tuples.tuples,
+			      b->value.tuples.tuples,
+			      a->value.tuples.ntuples *
+				      sizeof(a->value.tuples.tuples[0])) == 0;
+	case PT_UINT_ARRAY:
+		return a->value.array.nelements == b->value.array.nelements &&
+		       memcmp(a->value.array.data.u,
+			      b->value.array.data.u,
+			      a->value.array.nelements *
+				      sizeof(a->value.array.data.u[0])) == 0;
 	}
 
-	return NULL;
+	return false;
+}
+
+bool
+quirks_equal(struct quirks *a, struct quirks *b)
+{
+	if (!a || !b)
+		return a == b;
+
+	ARRAY_FOR_EACH(a->lookup, pa) {
+		struct property *pb = b->lookup[pa - a->lookup];
+
+		if (!*pa || !pb) {
+			if (*pa != pb)
+				return false;
+		} else if (!property_value_equal(*pa, pb)) {
+			return false;
+		}
+	}
+
+	return true;
 }
 
 bool
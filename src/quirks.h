@@ -111,6 +111,7 @@ enum quirk {
 	QUIRK_ATTR_TABLET_SMOOTHING,
 	QUIRK_ATTR_THUMB_PRESSURE_THRESHOLD,
 	QUIRK_ATTR_THUMB_SIZE_THRESHOLD,
+	QUIRK_ATTR_TOUCHPAD_MAX_FRAME_RATE,
 	QUIRK_ATTR_TOUCH_SIZE_RANGE,
 	QUIRK_ATTR_TPKBCOMBO_LAYOUT,
 	QUIRK_ATTR_TRACKPOINT_INTEGRATION,
@@ -173,6 +174,31 @@ quirks_init_subsystem(const char *data_path,
 		      struct libinput *libinput,
 		      enum quirks_log_type log_type);
 
+/**
+ * The file name of the compiled quirks cache within the data directory.
+ */
+#define QUIRKS_CACHE_FILENAME "quirks.cache"
+
+/**
+ * Compile the data files in data_path into a binary cache file
+ * QUIRKS_CACHE_FILENAME in that same directory.
+ *
+ * quirks_init_subsystem() maps this file instead of parsing the data
+ * files for as long as the set of data files, their sizes and
+ * modification times are unchanged. The override file and the quirks in
+ * the XDG runtime directory are never cached.
+ *
+ * @param data_path The directory containing the various data files
+ * @param log_handler The libinput log handler called for debugging output
+ *
+ * @return true on success or false if the data files failed to parse or
+ * the cache could not be written
+ */
+bool
+quirks_compile_cache(const char *data_path,
+		     libinput_log_handler log_handler,
+		     enum quirks_log_type log_type);
+
 /**
  * Clean up after ourselves. This function must be called
  * as the last call to the quirks subsystem.
@@ -190,6 +216,24 @@ DEFINE_UNREF_CLEANUP_FUNC(quirks_context);
 struct quirks_context *
 quirks_context_ref(struct quirks_context *ctx);
 
+/**
+ * Create a new quirks context from the same data directory, override file
+ * and runtime directory as ctx. The existing context is not modified.
+ *
+ * @return A new quirks context or NULL on error
+ */
+struct quirks_context *
+quirks_context_reload(struct quirks_context *ctx);
+
+/**
+ * Add inotify watches for all directories the context has read quirks
+ * from. Directories that do not exist are skipped.
+ *
+ * @return The number of watches added
+ */
+int
+quirks_context_add_watches(struct quirks_context *ctx, int inotify_fd);
+
 /**
  * Fetch the quirks for a given device. If no quirks are defined, this
  * function returns NULL.
@@ -199,6 +243,14 @@ quirks_context_ref(struct quirks_context *ctx);
 struct quirks *
 quirks_fetch_for_device(struct quirks_context *ctx, struct udev_device *device);
 
+/**
+ * Increase the refcount by one.
+ *
+ * @return The quirks struct passed in
+ */
+struct quirks *
+quirks_ref(struct quirks *q);
+
 /**
  * Reduce the refcount by one. When the refcount reaches zero, the
  * associated struct is released.
@@ -210,6 +262,13 @@ quirks_unref(struct quirks *q);
 
 DEFINE_UNREF_CLEANUP_FUNC(quirks);
 
+/**
+ * Returns true if both quirk lists resolve to the same value for every
+ * quirk. Either may be NULL.
+ */
+bool
+quirks_equal(struct quirks *a, struct quirks *b);
+
 /**
  * Returns true if the given quirk applies is in this quirk list.
  */
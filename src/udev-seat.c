@@ -24,9 +24,12 @@
 
 #include "config.h"
 
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
 
 #include "evdev.h"
 #include "udev-seat.h"
@@ -41,53 +44,98 @@ udev_seat_create(struct udev_input *input,
 static struct udev_seat *
 udev_seat_get_named(struct udev_input *input, const char *seat_name);
 
+static inline struct list *
+device_hash_bucket(struct udev_input *input, dev_t devnum)
+{
+	size_t idx = (major(devnum) * 31 + minor(devnum)) % UDEV_INPUT_DEVICE_HASH_SIZE;
+
+	return &input->device_hash[idx];
+}
+
 static inline bool
-filter_duplicates(struct udev_seat *udev_seat, struct udev_device *udev_device)
+device_matches(struct evdev_device *device, dev_t devnum, const char *syspath)
 {
-	struct libinput_device *device;
-	const char *new_syspath = udev_device_get_syspath(udev_device);
-	bool ignore_device = false;
+	return udev_device_get_devnum(device->udev_device) == devnum &&
+	       streq(udev_device_get_syspath(device->udev_device), syspath);
+}
 
-	if (!udev_seat)
-		return false;
+/**
+ * Look up a device by devnum and syspath. The syspath is compared as well
+ * because a devnum is reused as soon as its node goes away.
+ */
+static struct evdev_device *
+udev_input_find_device(struct udev_input *input, struct udev_device *udev_device)
+{
+	dev_t devnum = udev_device_get_devnum(udev_device);
+	const char *syspath = udev_device_get_syspath(udev_device);
+	struct evdev_device *device;
 
-	list_for_each(device, &udev_seat->base.devices_list, link) {
-		const char *syspath;
+	if (!syspath)
+		return NULL;
 
-		_unref_(udev_device) *ud = libinput_device_get_udev_device(device);
-		if (!ud)
-			continue;
+	list_for_each(device, device_hash_bucket(input, devnum), udev_hash_link) {
+		if (device_matches(device, devnum, syspath))
+			return device;
+	}
 
-		syspath = udev_device_get_syspath(ud);
-		if (syspath && new_syspath && streq(syspath, new_syspath))
-			ignore_device = true;
+	return NULL;
+}
 
-		if (ignore_device)
-			break;
+static inline bool
+filter_duplicates(struct udev_input *input,
+		  struct udev_seat *udev_seat,
+		  struct udev_device *udev_device)
+{
+	dev_t devnum = udev_device_get_devnum(udev_device);
+	const char *syspath = udev_device_get_syspath(udev_device);
+	struct evdev_device *device;
+
+	if (!udev_seat || !syspath)
+		return false;
+
+	list_for_each(device, device_hash_bucket(input, devnum), udev_hash_link) {
+		if (device->base.seat == &udev_seat->base &&
+		    device_matches(device, devnum, syspath))
+			return true;
 	}
 
-	return ignore_device;
+	return false;
+}
+
+static inline const char *
+device_get_seat(struct udev_device *udev_device)
+{
+	const char *device_seat;
+
+	device_seat = udev_device_get_property_value(udev_device, "ID_SEAT");
+	if (!device_seat)
+		device_seat = default_seat;
+
+	return device_seat;
+}
+
+static inline bool
+device_is_ours(struct udev_device *udev_device, struct udev_input *input)
+{
+	return streq(device_get_seat(udev_device), input->seat_id) &&
+	       !ignore_litest_test_suite_device(udev_device);
 }
 
 static int
-device_added(struct udev_device *udev_device,
-	     struct udev_input *input,
-	     const char *seat_name)
+device_added_probed(struct udev_device *udev_device,
+		    struct udev_input *input,
+		    const char *seat_name,
+		    struct evdev_device_probe *probe)
 {
 	struct evdev_device *device;
 	const char *devnode, *sysname;
 	const char *device_seat, *output_name;
 	struct udev_seat *seat;
 
-	device_seat = udev_device_get_property_value(udev_device, "ID_SEAT");
-	if (!device_seat)
-		device_seat = default_seat;
-
-	if (!streq(device_seat, input->seat_id))
+	if (!device_is_ours(udev_device, input))
 		return 0;
 
-	if (ignore_litest_test_suite_device(udev_device))
-		return 0;
+	device_seat = device_get_seat(udev_device);
 
 	devnode = udev_device_get_devnode(udev_device);
 	sysname = udev_device_get_sysname(udev_device);
@@ -104,7 +152,7 @@ device_added(struct udev_device *udev_device,
 	 * up the udev monitor and enumerating all current devices may show
 	 * up in both lists. Filter those out.
 	 */
-	if (filter_duplicates(seat, udev_device))
+	if (filter_duplicates(input, seat, udev_device))
 		return 0;
 
 	if (seat)
@@ -115,7 +163,10 @@ device_added(struct udev_device *udev_device,
 			return -1;
 	}
 
-	device = evdev_device_create(&seat->base, udev_device);
+	if (probe)
+		device = evdev_device_create_probed(&seat->base, udev_device, probe);
+	else
+		device = evdev_device_create(&seat->base, udev_device);
 	libinput_seat_unref(&seat->base);
 
 	if (device == EVDEV_UNHANDLED_DEVICE) {
@@ -134,6 +185,9 @@ device_added(struct udev_device *udev_device,
 		return 0;
 	}
 
+	list_insert(device_hash_bucket(input, udev_device_get_devnum(udev_device)),
+		    &device->udev_hash_link);
+
 	evdev_read_calibration_prop(device);
 
 	output_name = udev_device_get_property_value(udev_device, "WL_OUTPUT");
@@ -142,29 +196,153 @@ device_added(struct udev_device *udev_device,
 	return 0;
 }
 
+static int
+device_added(struct udev_device *udev_device,
+	     struct udev_input *input,
+	     const char *seat_name)
+{
+	return device_added_probed(udev_device, input, seat_name, NULL);
+}
+
 static void
 device_removed(struct udev_device *udev_device, struct udev_input *input)
 {
+	dev_t devnum = udev_device_get_devnum(udev_device);
+	const char *syspath = udev_device_get_syspath(udev_device);
 	struct evdev_device *device;
-	struct udev_seat *seat;
-	const char *syspath;
 
-	syspath = udev_device_get_syspath(udev_device);
-	list_for_each(seat, &input->base.seat_list, base.link) {
-		list_for_each_safe(device, &seat->base.devices_list, base.link) {
-			if (streq(syspath,
-				  udev_device_get_syspath(device->udev_device))) {
-				evdev_device_remove(device);
-				break;
-			}
-		}
+	if (!syspath)
+		return;
+
+	/* One device per seat may have this syspath */
+	list_for_each_safe(device, device_hash_bucket(input, devnum), udev_hash_link) {
+		if (device_matches(device, devnum, syspath))
+			evdev_device_remove(device);
+	}
+}
+
+/* More threads than this don't help, the kernel serializes most of it */
+#define PROBE_MAX_THREADS 8
+
+struct probe_batch {
+	struct udev_device **devices;
+	struct evdev_device_probe *probes;
+	size_t ndevices;
+	size_t size;
+	size_t next; /* next probe to run, shared between threads */
+};
+
+static void *
+probe_batch_thread(void *data)
+{
+	struct probe_batch *batch = data;
+	size_t idx;
+
+	while ((idx = __atomic_fetch_add(&batch->next, 1, __ATOMIC_RELAXED)) <
+	       batch->ndevices)
+		evdev_device_probe_run(&batch->probes[idx]);
+
+	return NULL;
+}
+
+/**
+ * Run the libevdev setup for all devices in the batch on a few threads.
+ * This is the bulk of the ioctls needed for a device and doesn't depend
+ * on anything else, unlike the rest of device creation which calls into
+ * the caller, libudev and the quirks and must stay on this thread.
+ */
+static void
+probe_batch_run(struct probe_batch *batch)
+{
+	pthread_t threads[PROBE_MAX_THREADS - 1];
+	size_t nthreads = 0;
+	long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+	size_t max_threads = min(batch->ndevices, PROBE_MAX_THREADS);
+
+	if (ncpus > 0)
+		max_threads = min(max_threads, (size_t)ncpus);
+
+	/* This thread is one of the workers */
+	while (nthreads + 1 < max_threads) {
+		if (pthread_create(&threads[nthreads], NULL, probe_batch_thread, batch) != 0)
+			break;
+		nthreads++;
+	}
+
+	probe_batch_thread(batch);
+
+	for (size_t i = 0; i < nthreads; i++)
+		pthread_join(threads[i], NULL);
+}
+
+static void
+probe_batch_add(struct probe_batch *batch,
+		struct udev_input *input,
+		struct udev_device *device)
+{
+	if (batch->ndevices == batch->size) {
+		batch->size = max(batch->size * 2, 16U);
+		batch->devices =
+			realloc(batch->devices, batch->size * sizeof(*batch->devices));
+		batch->probes =
+			realloc(batch->probes, batch->size * sizeof(*batch->probes));
+		if (!batch->devices || !batch->probes)
+			abort();
+	}
+
+	/* opening calls into the caller, so this stays in order on
+	 * this thread */
+	batch->devices[batch->ndevices] = udev_device_ref(device);
+	evdev_device_probe_open(&input->base, device, &batch->probes[batch->ndevices]);
+	batch->ndevices++;
+}
+
+/**
+ * Probe all devices in the batch in parallel, then add them in the order
+ * they were added to the batch so the device order is the same as if
+ * they had been created one-by-one. The batch is empty afterwards.
+ */
+static int
+probe_batch_commit(struct probe_batch *batch, struct udev_input *input)
+{
+	int rc = 0;
+
+	if (batch->ndevices == 0)
+		return 0;
+
+	probe_batch_run(batch);
+
+	for (size_t i = 0; i < batch->ndevices; i++) {
+		struct udev_device *device = batch->devices[i];
+		struct evdev_device_probe *probe = &batch->probes[i];
+
+		if (rc == 0 && device_added_probed(device, input, NULL, probe) < 0)
+			rc = -1;
+
+		/* anything not taken by the device, e.g. duplicates */
+		evdev_device_probe_cleanup(&input->base, probe);
+		udev_device_unref(device);
 	}
+
+	batch->ndevices = 0;
+	batch->next = 0;
+
+	return rc;
+}
+
+static void
+probe_batch_release(struct probe_batch *batch)
+{
+	free(batch->devices);
+	free(batch->probes);
 }
 
 static int
 udev_input_add_devices(struct udev_input *input, struct udev *udev)
 {
 	struct udev_list_entry *entry;
+	struct probe_batch batch = { 0 };
+	int rc;
 
 	_unref_(udev_enumerate) *e = udev_enumerate_new(udev);
 	udev_enumerate_add_match_subsystem(e, "input");
@@ -190,32 +368,110 @@ udev_input_add_devices(struct udev_input *input, struct udev *udev)
 			continue;
 		}
 
-		if (device_added(device, input, NULL) < 0) {
-			return -1;
+		if (!device_is_ours(device, input))
+			continue;
+
+		/* Kept across a suspend and already re-opened */
+		if (udev_input_find_device(input, device))
+			continue;
+
+		probe_batch_add(&batch, input, device);
+	}
+
+	rc = probe_batch_commit(&batch, input);
+	probe_batch_release(&batch);
+
+	return rc;
+}
+
+/* Upper limit of monitor events handled per wakeup, anything left over
+ * keeps the fd readable and is handled on the next one */
+#define UDEV_MONITOR_BATCH_MAX 256
+
+static inline bool
+is_same_node(struct udev_device *a, struct udev_device *b)
+{
+	return udev_device_get_devnum(a) == udev_device_get_devnum(b) &&
+	       streq(udev_device_get_syspath(a), udev_device_get_syspath(b));
+}
+
+/**
+ * Drop the events in a batch that cancel out or would be ignored anyway:
+ * an add followed by a remove of the same node is a flap and the add is
+ * not needed, an add after an add of the same node is a duplicate.
+ * Dropped events are unref'd and set to NULL.
+ */
+static void
+udev_events_coalesce(struct udev_device **events, size_t nevents)
+{
+	for (size_t i = 1; i < nevents; i++) {
+		bool is_add = streq(udev_device_get_action(events[i]), "add");
+
+		for (size_t j = i; j-- > 0;) {
+			if (!events[j] || !is_same_node(events[i], events[j]))
+				continue;
+
+			/* Only the closest earlier event for this node matters */
+			if (streq(udev_device_get_action(events[j]), "add")) {
+				/* For add+remove the remove still goes through
+				 * in case the add was a duplicate of an
+				 * existing device, otherwise it's a noop */
+				size_t drop = is_add ? i : j;
+				udev_device_unref(events[drop]);
+				events[drop] = NULL;
+			}
+			break;
 		}
 	}
-	return 0;
 }
 
 static void
 evdev_udev_handler(void *data)
 {
 	struct udev_input *input = data;
-	const char *action;
+	struct udev_device *events[UDEV_MONITOR_BATCH_MAX];
+	struct udev_device *udev_device;
+	struct probe_batch batch = { 0 };
+	size_t nevents = 0;
+
+	/* The monitor socket is non-blocking, drain what's there */
+	while (nevents < ARRAY_LENGTH(events) &&
+	       (udev_device = udev_monitor_receive_device(input->udev_monitor))) {
+		const char *action = udev_device_get_action(udev_device);
+
+		if (!action ||
+		    !strstartswith(udev_device_get_sysname(udev_device), "event") ||
+		    (!streq(action, "add") && !streq(action, "remove"))) {
+			udev_device_unref(udev_device);
+			continue;
+		}
 
-	_unref_(udev_device) *udev_device =
-		udev_monitor_receive_device(input->udev_monitor);
-	if (!udev_device)
-		return;
+		events[nevents++] = udev_device;
+	}
 
-	action = udev_device_get_action(udev_device);
-	if (!action || !strstartswith(udev_device_get_sysname(udev_device), "event"))
-		return;
+	udev_events_coalesce(events, nevents);
 
-	if (streq(action, "add"))
-		device_added(udev_device, input, NULL);
-	else if (streq(action, "remove"))
-		device_removed(udev_device, input);
+	/* Consecutive adds are probed together, a remove flushes them so
+	 * the events are still applied in order. Duplicates of existing
+	 * devices skip the batch so we don't open them for nothing. */
+	for (size_t i = 0; i < nevents; i++) {
+		udev_device = events[i];
+		if (!udev_device)
+			continue;
+
+		if (!streq(udev_device_get_action(udev_device), "add")) {
+			probe_batch_commit(&batch, input);
+			device_removed(udev_device, input);
+		} else if (device_is_ours(udev_device, input) &&
+			   !udev_input_find_device(input, udev_device)) {
+			probe_batch_add(&batch, input, udev_device);
+		}
+
+		udev_device_unref(udev_device);
+	}
+
+	probe_batch_commit(&batch, input);
+	probe_batch_release(&batch);
 }
 
 static void
@@ -233,6 +489,51 @@ udev_input_remove_devices(struct udev_input *input)
 	}
 }
 
+static void
+udev_input_keep_devices(struct udev_input *input)
+{
+	struct evdev_device *device;
+	struct udev_seat *seat;
+
+	list_for_each(seat, &input->base.seat_list, base.link) {
+		list_for_each(device, &seat->base.devices_list, base.link) {
+			/* Devices disabled via the send events mode stay as
+			 * they are, see udev_input_resume_devices() */
+			if (device->fd == -1)
+				continue;
+
+			evdev_device_suspend(device);
+			device->session_suspended = true;
+		}
+	}
+}
+
+static void
+udev_input_resume_devices(struct udev_input *input)
+{
+	struct evdev_device *device;
+	struct udev_seat *seat;
+
+	list_for_each_safe(seat, &input->base.seat_list, base.link) {
+		libinput_seat_ref(&seat->base);
+		list_for_each_safe(device, &seat->base.devices_list, base.link) {
+			/* A device suspended before the session was may have
+			 * changed too but we have no reason to re-open it
+			 * now. Remove it and let the enumeration add it back
+			 * the same way a full suspend would. */
+			if (!device->session_suspended) {
+				evdev_device_remove(device);
+				continue;
+			}
+
+			device->session_suspended = false;
+			if (evdev_device_resume(device) != 0)
+				evdev_device_remove(device);
+		}
+		libinput_seat_unref(&seat->base);
+	}
+}
+
 static void
 udev_input_disable(struct libinput *libinput)
 {
@@ -246,7 +547,10 @@ udev_input_disable(struct libinput *libinput)
 	libinput_remove_source(&input->base, input->udev_monitor_source);
 	input->udev_monitor_source = NULL;
 
-	udev_input_remove_devices(input);
+	if (input->suspend_mode == LIBINPUT_SUSPEND_MODE_KEEP_DEVICES)
+		udev_input_keep_devices(input);
+	else
+		udev_input_remove_devices(input);
 }
 
 static int
@@ -288,6 +592,10 @@ udev_input_enable(struct libinput *libinput)
 		return -1;
 	}
 
+	/* Re-open devices kept across the suspend before the enumeration
+	 * so it only needs to add what's new */
+	udev_input_resume_devices(input);
+
 	if (udev_input_add_devices(input, udev) < 0) {
 		udev_input_disable(libinput);
 		return -1;
@@ -304,6 +612,9 @@ udev_input_destroy(struct libinput *input)
 	if (input == NULL)
 		return;
 
+	/* Anything kept by a suspend in LIBINPUT_SUSPEND_MODE_KEEP_DEVICES */
+	udev_input_remove_devices(udev_input);
+
 	udev_unref(udev_input->udev);
 	free(udev_input->seat_id);
 }
@@ -363,9 +674,20 @@ udev_device_change_seat(struct libinput_device *device, const char *seat_name)
 	return rc;
 }
 
+static int
+udev_input_set_suspend_mode(struct libinput *libinput, enum libinput_suspend_mode mode)
+{
+	struct udev_input *input = (struct udev_input *)libinput;
+
+	input->suspend_mode = mode;
+
+	return 0;
+}
+
 static const struct libinput_interface_backend interface_backend = {
 	.resume = udev_input_enable,
 	.suspend = udev_input_disable,
+	.set_suspend_mode = udev_input_set_suspend_mode,
 	.destroy = udev_input_destroy,
 	.device_change_seat = udev_device_change_seat,
 };
@@ -390,6 +712,8 @@ libinput_udev_create_context(const struct libinput_interface *interface,
 	}
 
 	input->udev = udev_ref(udev);
+	ARRAY_FOR_EACH(input->device_hash, bucket)
+		list_init(bucket);
 
 	return &input->base;
 }
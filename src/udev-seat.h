@@ -30,6 +30,8 @@
 
 #include "libinput-private.h"
 
+#define UDEV_INPUT_DEVICE_HASH_SIZE 64
+
 struct udev_seat {
 	struct libinput_seat base;
 };
@@ -40,6 +42,10 @@ struct udev_input {
 	struct udev_monitor *udev_monitor;
 	struct libinput_source *udev_monitor_source;
 	char *seat_id;
+	enum libinput_suspend_mode suspend_mode;
+
+	/* All devices across all seats, hashed by devnum */
+	struct list device_hash[UDEV_INPUT_DEVICE_HASH_SIZE];
 };
 
 #endif
@@ -93,6 +93,39 @@ long_set_bit_state(unsigned long *array, int bit, int state)
 		long_clear_bit(array, bit);
 }
 
+/**
+ * Returns the index of the first bit set at or after start, or -1 if
+ * none is set. Scans a word at a time.
+ */
+static inline int
+long_find_next_bit(const unsigned long *array, size_t nlongs, unsigned int start)
+{
+	size_t idx = start / LONG_BITS;
+	unsigned long word;
+
+	if (idx >= nlongs)
+		return -1;
+
+	word = array[idx] & (~0UL << (start % LONG_BITS));
+	while (word == 0) {
+		if (++idx >= nlongs)
+			return -1;
+		word = array[idx];
+	}
+
+	return idx * LONG_BITS + __builtin_ctzl(word);
+}
+
+/**
+ * Iterate over all bits set in the array. The array may be modified in
+ * the loop body, bits cleared or set after the current one are taken
+ * into account.
+ */
+#define long_bit_for_each(array_, nlongs_, bit_)                      \
+	for (int bit_ = long_find_next_bit((array_), (nlongs_), 0);   \
+	     bit_ >= 0;                                               \
+	     bit_ = long_find_next_bit((array_), (nlongs_), bit_ + 1))
+
 static inline bool
 long_any_bit_set(unsigned long *array, size_t size)
 {
@@ -0,0 +1,170 @@
+/*
+ * Copyright © 2025 Red Hat, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "config.h"
+
+#include <assert.h>
+#include <linux/input.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util-bits.h"
+
+/**
+ * Press count for every key code. Almost all keys are either up or down
+ * once, so the state is a bitmap with the extra presses of keys held
+ * more than once (the same key on two devices, a button held physically
+ * and emulated, ...) in a small sparse table.
+ *
+ * A zeroed struct key_count is a valid, empty one. Call key_count_reset()
+ * to release the table.
+ */
+struct key_count {
+	unsigned long down[NLONGS(KEY_CNT)];
+
+	struct key_count_extra {
+		uint16_t key;
+		uint32_t count; /* presses beyond the first */
+	} *extra;
+	size_t nextra;
+	size_t extra_size;
+};
+
+static inline struct key_count_extra *
+key_count_find_extra(const struct key_count *kc, unsigned int key)
+{
+	for (size_t i = 0; i < kc->nextra; i++) {
+		if (kc->extra[i].key == key)
+			return &kc->extra[i];
+	}
+
+	return NULL;
+}
+
+static inline uint32_t
+key_count_get(const struct key_count *kc, unsigned int key)
+{
+	assert(key < KEY_CNT);
+
+	if (!long_bit_is_set(kc->down, key))
+		return 0;
+
+	if (kc->nextra > 0) {
+		struct key_count_extra *e = key_count_find_extra(kc, key);
+		if (e)
+			return 1 + e->count;
+	}
+
+	return 1;
+}
+
+static inline bool
+key_count_is_down(const struct key_count *kc, unsigned int key)
+{
+	assert(key < KEY_CNT);
+
+	return long_bit_is_set(kc->down, key);
+}
+
+/**
+ * Iterate over all keys that are down at least once
+ */
+#define key_count_for_each_down(kc_, key_) \
+	long_bit_for_each((kc_)->down, ARRAY_LENGTH((kc_)->down), key_)
+
+static inline bool
+key_count_any_down(const struct key_count *kc)
+{
+	return long_any_bit_set((unsigned long *)kc->down, ARRAY_LENGTH(kc->down));
+}
+
+/**
+ * Returns the new press count of the key
+ */
+static inline uint32_t
+key_count_inc(struct key_count *kc, unsigned int key)
+{
+	struct key_count_extra *e;
+
+	assert(key < KEY_CNT);
+
+	if (!long_bit_is_set(kc->down, key)) {
+		long_set_bit(kc->down, key);
+		return 1;
+	}
+
+	e = key_count_find_extra(kc, key);
+	if (e)
+		return 1 + ++e->count;
+
+	if (kc->nextra == kc->extra_size) {
+		kc->extra_size = kc->extra_size ? kc->extra_size * 2 : 4;
+		kc->extra = realloc(kc->extra, kc->extra_size * sizeof(*kc->extra));
+		if (!kc->extra)
+			abort();
+	}
+
+	e = &kc->extra[kc->nextra++];
+	*e = (struct key_count_extra){ .key = key, .count = 1 };
+
+	return 2;
+}
+
+/**
+ * Returns the new press count of the key. Releasing a key that is not
+ * down is a noop, use key_count_is_down() to check for it.
+ */
+static inline uint32_t
+key_count_dec(struct key_count *kc, unsigned int key)
+{
+	struct key_count_extra *e;
+
+	assert(key < KEY_CNT);
+
+	if (!long_bit_is_set(kc->down, key))
+		return 0;
+
+	e = kc->nextra > 0 ? key_count_find_extra(kc, key) : NULL;
+	if (!e) {
+		long_clear_bit(kc->down, key);
+		return 0;
+	}
+
+	if (--e->count > 0)
+		return 1 + e->count;
+
+	*e = kc->extra[--kc->nextra];
+
+	return 1;
+}
+
+static inline void
+key_count_reset(struct key_count *kc)
+{
+	free(kc->extra);
+	memset(kc, 0, sizeof(*kc));
+}
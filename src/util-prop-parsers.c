@@ -24,6 +24,7 @@
 #include "util-prop-parsers.h"
 
 #include <libevdev/libevdev.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "util-macros.h"
@@ -560,3 +561,102 @@ out:
 
 	return mask;
 }
+
+static int
+udev_property_cmp(const void *a, const void *b)
+{
+	const struct udev_property *pa = a, *pb = b;
+
+	return strcmp(pa->key, pb->key);
+}
+
+/**
+ * Sort the properties by key, all other udev_properties_*() functions
+ * expect a sorted array.
+ */
+void
+udev_properties_sort(struct udev_property *props, size_t nprops)
+{
+	if (nprops > 0)
+		qsort(props, nprops, sizeof(*props), udev_property_cmp);
+}
+
+struct udev_property *
+udev_properties_find(struct udev_property *props, size_t nprops, const char *key)
+{
+	struct udev_property needle = { .key = key };
+
+	if (nprops == 0)
+		return NULL;
+
+	return bsearch(&needle, props, nprops, sizeof(*props), udev_property_cmp);
+}
+
+/**
+ * Return the number of properties whose key starts with prefix, first is
+ * set to the first of those. They are sorted by key and contiguous.
+ */
+size_t
+udev_properties_find_prefix(struct udev_property *props,
+			    size_t nprops,
+			    const char *prefix,
+			    struct udev_property **first)
+{
+	size_t lo = 0, hi = nprops, n = 0;
+
+	/* lower bound of prefix */
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (strcmp(props[mid].key, prefix) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	while (lo + n < nprops && strstartswith(props[lo + n].key, prefix))
+		n++;
+
+	*first = n > 0 ? &props[lo] : NULL;
+
+	return n;
+}
+
+/**
+ * Parse the property as boolean, the result is cached. Returns false if
+ * the value is not a valid boolean.
+ */
+bool
+udev_property_get_bool(struct udev_property *prop, bool *value)
+{
+	if (prop->bool_state == UDEV_PROPERTY_UNPARSED)
+		prop->bool_state = parse_boolean_property(prop->value, &prop->boolean)
+					   ? UDEV_PROPERTY_VALID
+					   : UDEV_PROPERTY_INVALID;
+
+	if (prop->bool_state == UDEV_PROPERTY_INVALID)
+		return false;
+
+	*value = prop->boolean;
+
+	return true;
+}
+
+/**
+ * Parse the property as integer, the result is cached. Returns false if
+ * the value is not a valid integer.
+ */
+bool
+udev_property_get_int(struct udev_property *prop, int *value)
+{
+	if (prop->int_state == UDEV_PROPERTY_UNPARSED)
+		prop->int_state = safe_atoi(prop->value, &prop->integer)
+					  ? UDEV_PROPERTY_VALID
+					  : UDEV_PROPERTY_INVALID;
+
+	if (prop->int_state == UDEV_PROPERTY_INVALID)
+		return false;
+
+	*value = prop->integer;
+
+	return true;
+}
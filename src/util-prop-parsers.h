@@ -84,3 +84,41 @@ enum {
 
 uint32_t
 parse_evdev_abs_prop(const char *prop, struct input_absinfo *abs);
+
+enum udev_property_state {
+	UDEV_PROPERTY_UNPARSED = 0,
+	UDEV_PROPERTY_VALID,
+	UDEV_PROPERTY_INVALID,
+};
+
+/**
+ * A udev property with its typed values parsed on demand and cached. The
+ * strings are owned by the caller, usually the udev device.
+ */
+struct udev_property {
+	const char *key;
+	const char *value;
+
+	enum udev_property_state bool_state;
+	bool boolean;
+	enum udev_property_state int_state;
+	int integer;
+};
+
+void
+udev_properties_sort(struct udev_property *props, size_t nprops);
+
+struct udev_property *
+udev_properties_find(struct udev_property *props, size_t nprops, const char *key);
+
+size_t
+udev_properties_find_prefix(struct udev_property *props,
+			    size_t nprops,
+			    const char *prefix,
+			    struct udev_property **first);
+
+bool
+udev_property_get_bool(struct udev_property *prop, bool *value);
+
+bool
+udev_property_get_int(struct udev_property *prop, int *value);
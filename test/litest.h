@@ -446,6 +446,8 @@ enum litest_device_type {
 	LITEST_SYNAPTICS_RMI4,
 	LITEST_SYNAPTICS_TOPBUTTONPAD,
 	LITEST_SYNAPTICS_TOUCHPAD,
+	LITEST_TOUCHPAD_MAX_FRAME_RATE,
+	LITEST_TOUCHPAD_MSC_TIMESTAMP,
 	LITEST_TOUCHPAD_PALMPRESSURE_ZERO,
 	LITEST_WACOM_INTUOS5_FINGER,
 
@@ -1379,6 +1381,7 @@ _litest_timeout(struct libinput *li, const char *func, int lineno, int millis);
 #define litest_timeout_3fg_drag_or_swipe(li_) litest_timeout(li_, 90)
 #define litest_timeout_3fg_drag(li_) litest_timeout(li_, 800)
 #define litest_timeout_eraser_button(li_) litest_timeout(li_, 50)
+#define litest_timeout_libwacom(li_) litest_timeout(li_, 200)
 
 struct litest_logcapture {
 	char **errors;
@@ -562,6 +562,21 @@ START_TEST(path_suspend)
 }
 END_TEST
 
+START_TEST(path_suspend_mode)
+{
+	int rc;
+	void *userdata = &rc;
+
+	_unref_(libinput) *li = libinput_path_create_context(&simple_interface, userdata);
+	litest_assert_notnull(li);
+
+	rc = libinput_set_suspend_mode(li, LIBINPUT_SUSPEND_MODE_KEEP_DEVICES);
+	litest_assert_int_eq(rc, -1);
+	rc = libinput_set_suspend_mode(li, LIBINPUT_SUSPEND_MODE_REMOVE_DEVICES);
+	litest_assert_int_eq(rc, 0);
+}
+END_TEST
+
 START_TEST(path_double_suspend)
 {
 	struct libinput *li;
@@ -1015,6 +1030,7 @@ TEST_COLLECTION(path)
 	litest_add(path_force_destroy, LITEST_ANY, LITEST_ANY);
 	litest_add_no_device(path_set_user_data);
 	litest_add_no_device(path_suspend);
+	litest_add_no_device(path_suspend_mode);
 	litest_add_no_device(path_double_suspend);
 	litest_add_no_device(path_double_resume);
 	litest_add_no_device(path_add_device_suspend_resume);
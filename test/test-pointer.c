@@ -2699,6 +2699,136 @@ START_TEST(pointer_accel_config)
 }
 END_TEST
 
+START_TEST(pointer_accel_config_curve)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput_device *device = dev->libinput_device;
+	enum libinput_config_status status;
+	enum libinput_config_status valid = LIBINPUT_CONFIG_STATUS_SUCCESS,
+				    invalid = LIBINPUT_CONFIG_STATUS_INVALID;
+	enum libinput_config_accel_type accel_types[] = {
+		LIBINPUT_ACCEL_TYPE_FALLBACK,
+		LIBINPUT_ACCEL_TYPE_MOTION,
+		LIBINPUT_ACCEL_TYPE_SCROLL,
+	};
+	struct custom_curve_test {
+		double speeds[4];
+		double points[4];
+		enum libinput_config_status expected_status;
+	} tests[] = {
+		{ { 0.0, 0.5, 1.0, 1.5 }, { 1.0, 2.0, 2.5, 2.6 }, valid },
+		{ { 0.0, 0.1, 2.0, 30.0 }, { 0.0, 0.3, 4.0, 45.0 }, valid },
+		{ { 0.0, 1.0, 2.0, 3.0 }, { 1.0, 3.0, 1.0, 4.5 }, valid },
+		{ { 0.1, 0.5, 1.0, 1.5 }, { 1.0, 2.0, 2.5, 2.6 }, invalid },
+		{ { 0.0, 0.5, 0.5, 1.5 }, { 1.0, 2.0, 2.5, 2.6 }, invalid },
+		{ { 0.0, 1.0, 0.5, 1.5 }, { 1.0, 2.0, 2.5, 2.6 }, invalid },
+		{ { 0.0, 1.0, 1e10, 2e10 }, { 1.0, 2.0, 2.5, 2.6 }, invalid },
+		{ { 0.0, 1.0, 2.0, 3.0 }, { 1.0, 2.0, -2.5, 2.6 }, invalid },
+		{ { 0.0, 1.0, 2.0, 3.0 }, { 1.0, 2.0, 1e10, 2.6 }, invalid },
+	};
+
+	litest_assert(libinput_device_config_accel_is_available(device));
+
+	ARRAY_FOR_EACH(tests, t) {
+		ARRAY_FOR_EACH(accel_types, accel_type) {
+			struct libinput_config_accel *config =
+				libinput_config_accel_create(
+					LIBINPUT_CONFIG_ACCEL_PROFILE_CUSTOM);
+
+			status = libinput_config_accel_set_curve(config,
+								 *accel_type,
+								 ARRAY_LENGTH(t->points),
+								 t->speeds,
+								 t->points);
+			litest_assert_int_eq(status, t->expected_status);
+
+			status = libinput_device_config_accel_apply(device, config);
+			litest_assert_enum_eq(status, LIBINPUT_CONFIG_STATUS_SUCCESS);
+			litest_assert_enum_eq(libinput_device_config_accel_get_profile(device),
+					      LIBINPUT_CONFIG_ACCEL_PROFILE_CUSTOM);
+
+			libinput_config_accel_destroy(config);
+		}
+	}
+
+	/* curves only apply to the custom profile */
+	struct libinput_config_accel *config =
+		libinput_config_accel_create(LIBINPUT_CONFIG_ACCEL_PROFILE_FLAT);
+	status = libinput_config_accel_set_curve(config,
+						 LIBINPUT_ACCEL_TYPE_MOTION,
+						 ARRAY_LENGTH(tests[0].points),
+						 tests[0].speeds,
+						 tests[0].points);
+	litest_assert_enum_eq(status, invalid);
+	libinput_config_accel_destroy(config);
+}
+END_TEST
+
+static void
+pointer_accel_apply_curve(struct litest_device *dev, double factor)
+{
+	/* non-uniform speeds so the curve goes through the spline */
+	double speeds[] = { 0.0, 0.5, 2.0, 10.0, 100.0 };
+	double points[ARRAY_LENGTH(speeds)];
+	enum libinput_config_status status;
+
+	ARRAY_FOR_EACH(speeds, s)
+		points[s - speeds] = *s * factor;
+
+	struct libinput_config_accel *config =
+		libinput_config_accel_create(LIBINPUT_CONFIG_ACCEL_PROFILE_CUSTOM);
+	status = libinput_config_accel_set_curve(config,
+						 LIBINPUT_ACCEL_TYPE_MOTION,
+						 ARRAY_LENGTH(points),
+						 speeds,
+						 points);
+	litest_assert_enum_eq(status, LIBINPUT_CONFIG_STATUS_SUCCESS);
+	status = libinput_device_config_accel_apply(dev->libinput_device, config);
+	litest_assert_enum_eq(status, LIBINPUT_CONFIG_STATUS_SUCCESS);
+	libinput_config_accel_destroy(config);
+}
+
+START_TEST(pointer_accel_config_curve_motion)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct {
+		double factor;
+		int dx, dy;
+	} tests[] = {
+		{ 1.0, 5, 0 },
+		{ 1.0, 1, -3 },
+		{ 2.0, 5, 0 },
+		{ 2.0, -2, 4 },
+		{ 3.0, 1, 1 },
+	};
+
+	ARRAY_FOR_EACH(tests, t) {
+		pointer_accel_apply_curve(dev, t->factor);
+		litest_drain_events(li);
+
+		litest_event(dev, EV_REL, REL_X, t->dx);
+		litest_event(dev, EV_REL, REL_Y, t->dy);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+		litest_dispatch(li);
+
+		_destroy_(libinput_event) *event = libinput_get_event(li);
+		struct libinput_event_pointer *ptrev = litest_is_motion_event(event);
+
+		/* A curve of out = in * factor accelerates by factor at
+		 * every speed */
+		litest_assert_double_eq_epsilon(libinput_event_pointer_get_dx(ptrev),
+						t->dx * t->factor,
+						0.001);
+		litest_assert_double_eq_epsilon(libinput_event_pointer_get_dy(ptrev),
+						t->dy * t->factor,
+						0.001);
+		litest_assert_double_eq(libinput_event_pointer_get_dx_unaccelerated(ptrev),
+					t->dx);
+	}
+}
+END_TEST
+
 START_TEST(pointer_accel_profile_invalid)
 {
 	struct litest_device *dev = litest_current_device();
@@ -3990,6 +4120,8 @@ TEST_COLLECTION(pointer)
 	litest_add(pointer_accel_profile_defaults, LITEST_TOUCHPAD, LITEST_ANY);
 	litest_add(pointer_accel_config_reset_to_defaults, LITEST_RELATIVE, LITEST_ANY);
 	litest_add(pointer_accel_config, LITEST_RELATIVE, LITEST_ANY);
+	litest_add(pointer_accel_config_curve, LITEST_RELATIVE, LITEST_ANY);
+	litest_add(pointer_accel_config_curve_motion, LITEST_RELATIVE, LITEST_POINTINGSTICK);
 	litest_add(pointer_accel_profile_invalid, LITEST_RELATIVE, LITEST_ANY);
 	litest_add(pointer_accel_profile_noaccel, LITEST_ANY, LITEST_TOUCHPAD|LITEST_RELATIVE|LITEST_TABLET);
 	litest_add(pointer_accel_profile_flat_motion_relative, LITEST_RELATIVE, LITEST_TOUCHPAD);
@@ -79,6 +79,9 @@ data_dir_destroy(struct data_dir *dd)
 		free(dd->filename);
 	}
 	if (dd->dirname) {
+		_autofree_ char *cache =
+			strdup_printf("%s/%s", dd->dirname, QUIRKS_CACHE_FILENAME);
+		unlink(cache);
 		rmdir(dd->dirname);
 		free(dd->dirname);
 	}
@@ -1105,6 +1108,7 @@ START_TEST(quirks_parse_uint_attr)
 		QUIRK_ATTR_PALM_SIZE_THRESHOLD,
 		QUIRK_ATTR_PALM_PRESSURE_THRESHOLD,
 		QUIRK_ATTR_THUMB_PRESSURE_THRESHOLD,
+		QUIRK_ATTR_TOUCHPAD_MAX_FRAME_RATE,
 	};
 	/* clang-format off */
 	struct qtest_uint test_values[] = {
@@ -1532,6 +1536,320 @@ START_TEST(quirks_ctx_ref)
 }
 END_TEST
 
+START_TEST(quirks_section_order)
+{
+	struct litest_device *dev = litest_current_device();
+	_unref_(udev_device) *ud =
+		libinput_device_get_udev_device(dev->libinput_device);
+	struct quirk_dimensions dim;
+	char quirks_file[1024];
+	unsigned int vid = libevdev_get_id_vendor(dev->evdev);
+	unsigned int pid = libevdev_get_id_product(dev->evdev);
+
+	/* Vendor/product, vendor-only and unkeyed sections are looked up
+	 * separately, the last one in the file must still win */
+	snprintf(quirks_file,
+		 sizeof(quirks_file),
+		 "[vendor only]\n"
+		 "MatchVendor=0x%04X\n"
+		 "AttrSizeHint=10x10\n"
+		 "\n"
+		 "[vendor and product]\n"
+		 "MatchVendor=0x%04X\n"
+		 "MatchProduct=0x%04X\n"
+		 "AttrSizeHint=20x20\n"
+		 "\n"
+		 "[udev type]\n"
+		 "MatchUdevType=mouse\n"
+		 "AttrSizeHint=30x30\n"
+		 "\n"
+		 "[vendor only again]\n"
+		 "MatchVendor=0x%04X\n"
+		 "AttrSizeHint=40x40\n"
+		 "\n"
+		 "[other product]\n"
+		 "MatchVendor=0x%04X\n"
+		 "MatchProduct=0x%04X\n"
+		 "AttrSizeHint=50x50\n",
+		 vid,
+		 vid,
+		 pid,
+		 vid,
+		 vid,
+		 (pid + 1) & 0xffff);
+
+	_destroy_(data_dir) *dd = data_dir_new(quirks_file);
+	_unref_(quirks_context) *ctx =
+		quirks_init_subsystem(dd->dirname,
+				      NULL,
+				      log_handler,
+				      NULL,
+				      QLOG_CUSTOM_LOG_PRIORITIES);
+	litest_assert_notnull(ctx);
+
+	_unref_(quirks) *q = quirks_fetch_for_device(ctx, ud);
+	litest_assert_notnull(q);
+	litest_assert(quirks_get_dimensions(q, QUIRK_ATTR_SIZE_HINT, &dim));
+	litest_assert_int_eq(dim.x, 40U);
+	litest_assert_int_eq(dim.y, 40U);
+}
+END_TEST
+
+static void
+data_dir_rewrite(struct data_dir *dd, const char *file_content)
+{
+	_autofclose_ FILE *fp = fopen(dd->filename, "w");
+#ifndef __clang_analyzer__
+	litest_assert_notnull(fp);
+#else
+	assert(fp);
+#endif
+	int rc = fputs(file_content, fp); // NOLINT: unix.Stream
+	litest_assert_errno_success(rc);
+}
+
+static void
+quirks_assert_size_hint(struct quirks_context *ctx,
+			struct udev_device *ud,
+			size_t w,
+			size_t h)
+{
+	struct quirk_dimensions dim;
+
+	_unref_(quirks) *q = quirks_fetch_for_device(ctx, ud);
+	litest_assert_notnull(q);
+	litest_assert(quirks_get_dimensions(q, QUIRK_ATTR_SIZE_HINT, &dim));
+	litest_assert_int_eq(dim.x, w);
+	litest_assert_int_eq(dim.y, h);
+}
+
+START_TEST(quirks_cache)
+{
+	struct litest_device *dev = litest_current_device();
+	_unref_(udev_device) *ud =
+		libinput_device_get_udev_device(dev->libinput_device);
+	const char quirks_file[] =
+		"[Section name]\n"
+		"MatchUdevType=mouse\n"
+		"MatchName=*\n"
+		"AttrSizeHint=10x20\n"
+		"AttrLidSwitchReliability=reliable\n";
+	_destroy_(data_dir) *dd = data_dir_new(quirks_file);
+
+	litest_assert(
+		quirks_compile_cache(dd->dirname, log_handler, QLOG_CUSTOM_LOG_PRIORITIES));
+
+	_unref_(quirks_context) *ctx =
+		quirks_init_subsystem(dd->dirname,
+				      NULL,
+				      log_handler,
+				      NULL,
+				      QLOG_CUSTOM_LOG_PRIORITIES);
+	litest_assert_notnull(ctx);
+
+	quirks_assert_size_hint(ctx, ud, 10, 20);
+
+	_unref_(quirks) *q = quirks_fetch_for_device(ctx, ud);
+	char *str;
+	litest_assert(quirks_get_string(q, QUIRK_ATTR_LID_SWITCH_RELIABILITY, &str));
+	litest_assert_str_eq(str, "reliable");
+}
+END_TEST
+
+START_TEST(quirks_cache_stale)
+{
+	struct litest_device *dev = litest_current_device();
+	_unref_(udev_device) *ud =
+		libinput_device_get_udev_device(dev->libinput_device);
+	const char quirks_file[] =
+		"[Section name]\n"
+		"MatchUdevType=mouse\n"
+		"AttrSizeHint=10x20\n";
+	const char quirks_file_modified[] =
+		"[Section name]\n"
+		"MatchUdevType=mouse\n"
+		"AttrSizeHint=100x200\n";
+	_destroy_(data_dir) *dd = data_dir_new(quirks_file);
+
+	litest_assert(
+		quirks_compile_cache(dd->dirname, log_handler, QLOG_CUSTOM_LOG_PRIORITIES));
+
+	data_dir_rewrite(dd, quirks_file_modified);
+
+	_unref_(quirks_context) *ctx =
+		quirks_init_subsystem(dd->dirname,
+				      NULL,
+				      log_handler,
+				      NULL,
+				      QLOG_CUSTOM_LOG_PRIORITIES);
+	litest_assert_notnull(ctx);
+	quirks_assert_size_hint(ctx, ud, 100, 200);
+}
+END_TEST
+
+START_TEST(quirks_reload)
+{
+	struct litest_device *dev = litest_current_device();
+	_unref_(udev_device) *ud =
+		libinput_device_get_udev_device(dev->libinput_device);
+	const char quirks_file[] =
+		"[Section name]\n"
+		"MatchUdevType=mouse\n"
+		"AttrSizeHint=10x20\n";
+	const char quirks_file_modified[] =
+		"[Section name]\n"
+		"MatchUdevType=mouse\n"
+		"AttrSizeHint=100x200\n";
+	_destroy_(data_dir) *dd = data_dir_new(quirks_file);
+
+	_unref_(quirks_context) *ctx =
+		quirks_init_subsystem(dd->dirname,
+				      NULL,
+				      log_handler,
+				      NULL,
+				      QLOG_CUSTOM_LOG_PRIORITIES);
+	litest_assert_notnull(ctx);
+	quirks_assert_size_hint(ctx, ud, 10, 20);
+
+	data_dir_rewrite(dd, quirks_file_modified);
+
+	_unref_(quirks_context) *reloaded = quirks_context_reload(ctx);
+	litest_assert_notnull(reloaded);
+	quirks_assert_size_hint(reloaded, ud, 100, 200);
+
+	/* The original context is not modified */
+	quirks_assert_size_hint(ctx, ud, 10, 20);
+
+	_unref_(quirks) *q1 = quirks_fetch_for_device(ctx, ud);
+	_unref_(quirks) *q2 = quirks_fetch_for_device(reloaded, ud);
+	litest_assert(!quirks_equal(q1, q2));
+}
+END_TEST
+
+START_TEST(quirks_reload_unchanged)
+{
+	struct litest_device *dev = litest_current_device();
+	_unref_(udev_device) *ud =
+		libinput_device_get_udev_device(dev->libinput_device);
+	const char quirks_file[] =
+		"[Section name]\n"
+		"MatchUdevType=mouse\n"
+		"AttrSizeHint=10x20\n";
+	_destroy_(data_dir) *dd = data_dir_new(quirks_file);
+
+	_unref_(quirks_context) *ctx =
+		quirks_init_subsystem(dd->dirname,
+				      NULL,
+				      log_handler,
+				      NULL,
+				      QLOG_CUSTOM_LOG_PRIORITIES);
+	litest_assert_notnull(ctx);
+
+	data_dir_rewrite(dd, quirks_file);
+
+	_unref_(quirks_context) *reloaded = quirks_context_reload(ctx);
+	litest_assert_notnull(reloaded);
+	quirks_assert_size_hint(reloaded, ud, 10, 20);
+
+	_unref_(quirks) *q1 = quirks_fetch_for_device(ctx, ud);
+	_unref_(quirks) *q2 = quirks_fetch_for_device(reloaded, ud);
+	litest_assert(quirks_equal(q1, q2));
+	litest_assert(quirks_equal(NULL, NULL));
+	litest_assert(!quirks_equal(q1, NULL));
+}
+END_TEST
+
+START_TEST(quirks_reload_libinput)
+{
+	struct litest_device *dev = litest_current_device();
+	const char quirks_file[] =
+		"[Section name]\n"
+		"MatchUdevType=mouse\n"
+		"AttrSizeHint=10x20\n";
+	const char quirks_file_modified[] =
+		"[Section name]\n"
+		"MatchUdevType=mouse\n"
+		"AttrSizeHint=100x200\n";
+	_destroy_(data_dir) *dd = data_dir_new(quirks_file);
+	_autofree_ char *quirks_dir = safe_strdup(getenv("LIBINPUT_QUIRKS_DIR"));
+
+	setenv("LIBINPUT_QUIRKS_DIR", dd->dirname, 1);
+	setenv("LIBINPUT_QUIRKS_RELOAD", "1", 1);
+
+	_litest_context_destroy_ struct libinput *li = litest_create_context();
+	struct libinput_device *device =
+		libinput_path_add_device(li, libevdev_uinput_get_devnode(dev->uinput));
+	litest_assert_notnull(device);
+	litest_drain_events(li);
+
+	/* Same content, the device stays as-is */
+	data_dir_rewrite(dd, quirks_file);
+	litest_dispatch(li);
+	litest_assert_empty_queue(li);
+
+	/* Changed quirks re-add the device */
+	data_dir_rewrite(dd, quirks_file_modified);
+	litest_dispatch(li);
+
+	_destroy_(libinput_event) *removed = libinput_get_event(li);
+	litest_assert_notnull(removed);
+	litest_assert_event_type(removed, LIBINPUT_EVENT_DEVICE_REMOVED);
+	litest_assert_ptr_eq(libinput_event_get_device(removed), device);
+
+	_destroy_(libinput_event) *added = libinput_get_event(li);
+	litest_assert_notnull(added);
+	litest_assert_event_type(added, LIBINPUT_EVENT_DEVICE_ADDED);
+	litest_assert_empty_queue(li);
+
+	if (quirks_dir)
+		setenv("LIBINPUT_QUIRKS_DIR", quirks_dir, 1);
+	unsetenv("LIBINPUT_QUIRKS_RELOAD");
+}
+END_TEST
+
+START_TEST(quirks_cache_corrupt)
+{
+	struct litest_device *dev = litest_current_device();
+	_unref_(udev_device) *ud =
+		libinput_device_get_udev_device(dev->libinput_device);
+	const char quirks_file[] =
+		"[Section name]\n"
+		"MatchUdevType=mouse\n"
+		"AttrSizeHint=10x20\n";
+	_destroy_(data_dir) *dd = data_dir_new(quirks_file);
+
+	litest_assert(
+		quirks_compile_cache(dd->dirname, log_handler, QLOG_CUSTOM_LOG_PRIORITIES));
+
+	_autofree_ char *cache =
+		strdup_printf("%s/%s", dd->dirname, QUIRKS_CACHE_FILENAME);
+	int rc = truncate(cache, 64);
+	litest_assert_errno_success(rc);
+
+	_unref_(quirks_context) *ctx =
+		quirks_init_subsystem(dd->dirname,
+				      NULL,
+				      log_handler,
+				      NULL,
+				      QLOG_CUSTOM_LOG_PRIORITIES);
+	litest_assert_notnull(ctx);
+	quirks_assert_size_hint(ctx, ud, 10, 20);
+}
+END_TEST
+
+START_TEST(quirks_cache_parse_error)
+{
+	const char quirks_file[] =
+		"[Section name]\n"
+		"MatchUdevType=mouse\n"
+		"AttrSizeHint=banana\n";
+	_destroy_(data_dir) *dd = data_dir_new(quirks_file);
+
+	litest_assert(
+		!quirks_compile_cache(dd->dirname, log_handler, QLOG_CUSTOM_LOG_PRIORITIES));
+}
+END_TEST
+
 TEST_COLLECTION(quirks)
 {
 	/* clang-format off */
@@ -1584,6 +1902,8 @@ TEST_COLLECTION(quirks)
 	litest_add_for_device(quirks_parse_bool_attr, LITEST_MOUSE);
 	litest_add_for_device(quirks_parse_integration_attr, LITEST_MOUSE);
 
+	litest_add_for_device(quirks_section_order, LITEST_MOUSE);
+
 	litest_add_for_device(quirks_model_one, LITEST_MOUSE);
 	litest_add_for_device(quirks_model_zero, LITEST_MOUSE);
 	litest_with_parameters(params, "enable_model", 'b') {
@@ -1597,5 +1917,13 @@ TEST_COLLECTION(quirks)
 
 	litest_add_deviceless(quirks_call_NULL);
 	litest_add_deviceless(quirks_ctx_ref);
+
+	litest_add_for_device(quirks_cache, LITEST_MOUSE);
+	litest_add_for_device(quirks_cache_stale, LITEST_MOUSE);
+	litest_add_for_device(quirks_cache_corrupt, LITEST_MOUSE);
+	litest_add_for_device(quirks_reload, LITEST_MOUSE);
+	litest_add_for_device(quirks_reload_unchanged, LITEST_MOUSE);
+	litest_add_for_device(quirks_reload_libinput, LITEST_MOUSE);
+	litest_add_deviceless(quirks_cache_parse_error);
 	/* clang-format on */
 }
@@ -7446,6 +7446,87 @@ START_TEST(huion_static_btn_tool_pen_disable_quirk_on_prox_out)
 }
 END_TEST
 
+#ifdef HAVE_LIBWACOM
+static bool
+device_is_known_to_libwacom(struct litest_device *dev)
+{
+	const char *devnode = libevdev_uinput_get_devnode(dev->uinput);
+	bool known = false;
+
+	WacomDeviceDatabase *db = libwacom_database_new();
+	if (db) {
+		WacomDevice *d =
+			libwacom_new_from_path(db, devnode, WFALLBACK_NONE, NULL);
+		if (!d)
+			d = libwacom_new_from_usbid(db,
+						    libevdev_get_id_vendor(dev->evdev),
+						    libevdev_get_id_product(dev->evdev),
+						    NULL);
+		if (d) {
+			known = true;
+			libwacom_destroy(d);
+		}
+		libwacom_database_destroy(db);
+	}
+
+	return known;
+}
+#endif
+
+START_TEST(tablet_libwacom_cache)
+{
+#ifdef HAVE_LIBWACOM
+	struct litest_device *dev = litest_current_device();
+	const char *devnode = libevdev_uinput_get_devnode(dev->uinput);
+	bool known = device_is_known_to_libwacom(dev);
+	struct libinput_device *device;
+
+	_litest_context_destroy_ struct libinput *li = litest_create_context();
+	libinput_log_set_priority(li, LIBINPUT_LOG_PRIORITY_DEBUG);
+
+	litest_with_logcapture(li, capture) {
+		device = libinput_path_add_device(li, devnode);
+		litest_assert_notnull(device);
+		litest_assert_strv_substring(capture->debugs,
+					     "libwacom: looking up the device");
+		litest_assert_strv_no_substring(capture->debugs,
+						"libwacom: using the cached lookup");
+
+		/* Replugging within the grace period never looks up again,
+		 * whether or not libwacom knows the device */
+		libinput_path_remove_device(device);
+		litest_drain_events(li);
+		strv_free(steal(&capture->debugs));
+
+		device = libinput_path_add_device(li, devnode);
+		litest_assert_notnull(device);
+		litest_assert_strv_substring(capture->debugs,
+					     "libwacom: using the cached lookup");
+		litest_assert_strv_no_substring(capture->debugs,
+						"libwacom: looking up the device");
+
+		/* After the grace period only the failed lookup is retried */
+		libinput_path_remove_device(device);
+		litest_drain_events(li);
+		litest_timeout_libwacom(li);
+		strv_free(steal(&capture->debugs));
+
+		device = libinput_path_add_device(li, devnode);
+		litest_assert_notnull(device);
+		if (known)
+			litest_assert_strv_substring(capture->debugs,
+						     "libwacom: using the cached lookup");
+		else
+			litest_assert_strv_substring(capture->debugs,
+						     "libwacom: looking up the device");
+		litest_drain_events(li);
+	}
+#else
+	return LITEST_SKIP;
+#endif
+}
+END_TEST
+
 START_TEST(tablet_smoothing)
 {
 #ifdef HAVE_LIBWACOM
@@ -8235,6 +8316,8 @@ TEST_COLLECTION(tablet)
 	}
 
 	litest_add_for_device(tablet_smoothing, LITEST_WACOM_HID4800_PEN);
+
+	litest_add(tablet_libwacom_cache, LITEST_TABLET, LITEST_TOTEM);
 	/* clang-format on */
 }
 
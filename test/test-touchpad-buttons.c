@@ -1933,6 +1933,49 @@ START_TEST(clickpad_middleemulation_click_middle_right)
 }
 END_TEST
 
+static void
+clickpad_click_at(struct litest_device *dev, double x, double y, unsigned int button)
+{
+	struct libinput *li = dev->libinput;
+
+	litest_touch_down(dev, 0, x, y);
+	litest_event(dev, EV_KEY, BTN_LEFT, 1);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	litest_event(dev, EV_KEY, BTN_LEFT, 0);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	litest_touch_up(dev, 0);
+
+	litest_assert_button_event(li, button, LIBINPUT_BUTTON_STATE_PRESSED);
+	litest_assert_button_event(li, button, LIBINPUT_BUTTON_STATE_RELEASED);
+	litest_assert_empty_queue(li);
+}
+
+START_TEST(clickpad_middleemulation_toggle_middle_area)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+
+	litest_enable_buttonareas(dev);
+	litest_disable_middleemu(dev);
+	litest_drain_events(li);
+
+	/* The middle button area only exists without middle button
+	 * emulation, toggling it moves the right button's edge */
+	for (int i = 0; i < 2; i++) {
+		clickpad_click_at(dev, 48, 95, BTN_MIDDLE);
+		clickpad_click_at(dev, 52, 95, BTN_MIDDLE);
+		clickpad_click_at(dev, 80, 95, BTN_RIGHT);
+
+		litest_enable_middleemu(dev);
+		clickpad_click_at(dev, 48, 95, BTN_LEFT);
+		clickpad_click_at(dev, 52, 95, BTN_RIGHT);
+		clickpad_click_at(dev, 80, 95, BTN_RIGHT);
+
+		litest_disable_middleemu(dev);
+	}
+}
+END_TEST
+
 START_TEST(clickpad_middleemulation_click_enable_while_down)
 {
 	struct litest_device *dev = litest_current_device();
@@ -2136,6 +2179,7 @@ TEST_COLLECTION(touchpad_buttons)
 	litest_add(clickpad_middleemulation_click, LITEST_CLICKPAD, LITEST_ANY);
 	litest_add(clickpad_middleemulation_click_middle_left, LITEST_CLICKPAD, LITEST_ANY);
 	litest_add(clickpad_middleemulation_click_middle_right, LITEST_CLICKPAD, LITEST_ANY);
+	litest_add(clickpad_middleemulation_toggle_middle_area, LITEST_CLICKPAD, LITEST_ANY);
 	litest_add(clickpad_middleemulation_click_enable_while_down, LITEST_CLICKPAD, LITEST_ANY);
 	litest_add(clickpad_middleemulation_click_disable_while_down, LITEST_CLICKPAD, LITEST_ANY);
 
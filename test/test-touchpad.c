@@ -85,6 +85,290 @@ START_TEST(touchpad_1fg_motion)
 }
 END_TEST
 
+START_TEST(touchpad_1fg_motion_predicted)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput_device *device = dev->libinput_device;
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	enum libinput_config_status status;
+	bool have_prediction = false;
+	double last_dx = 1.0, last_predicted = 1.0;
+
+	litest_assert(libinput_device_config_prediction_is_available(device));
+	litest_assert_int_eq(libinput_device_config_prediction_get_default_horizon(device),
+			     0U);
+
+	status = libinput_device_config_prediction_set_horizon(device, 51);
+	litest_assert_enum_eq(status, LIBINPUT_CONFIG_STATUS_INVALID);
+	status = libinput_device_config_prediction_set_horizon(device, 16);
+	litest_assert_enum_eq(status, LIBINPUT_CONFIG_STATUS_SUCCESS);
+	litest_assert_int_eq(libinput_device_config_prediction_get_horizon(device),
+			     16U);
+
+	litest_disable_tap(device);
+	litest_disable_hold_gestures(device);
+	litest_drain_events(li);
+
+	litest_touch_down(dev, 0, 50, 50);
+	litest_touch_move_to(dev, 0, 50, 50, 80, 50, 20);
+	litest_touch_up(dev, 0);
+
+	litest_dispatch(li);
+
+	event = libinput_get_event(li);
+	litest_assert_notnull(event);
+
+	while (event) {
+		struct libinput_event_pointer *ptrev;
+
+		ptrev = litest_is_motion_event(event);
+		last_dx = libinput_event_pointer_get_dx(ptrev);
+		last_predicted = libinput_event_pointer_get_dx_predicted(ptrev);
+		litest_assert_double_ge(last_predicted, 0.0);
+		litest_assert_double_eq(libinput_event_pointer_get_dy_predicted(ptrev),
+					0.0);
+		if (last_predicted > 0.0)
+			have_prediction = true;
+		libinput_event_destroy(event);
+		event = libinput_get_event(li);
+	}
+
+	litest_assert(have_prediction);
+
+	/* The final event moves the pointer back to where it is */
+	litest_assert_double_eq(last_dx, 0.0);
+	litest_assert_double_eq(last_predicted, 0.0);
+}
+END_TEST
+
+START_TEST(touchpad_1fg_motion_predicted_settle)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput_device *device = dev->libinput_device;
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	struct libinput_event_pointer *ptrev;
+	enum libinput_config_status status;
+	double last_predicted = 0.0;
+
+	status = libinput_device_config_prediction_set_horizon(device, 16);
+	litest_assert_enum_eq(status, LIBINPUT_CONFIG_STATUS_SUCCESS);
+
+	litest_disable_tap(device);
+	litest_disable_hold_gestures(device);
+	litest_drain_events(li);
+
+	litest_touch_down(dev, 0, 50, 50);
+	litest_touch_move_to(dev, 0, 50, 50, 80, 50, 20);
+	litest_dispatch(li);
+
+	event = libinput_get_event(li);
+	litest_assert_notnull(event);
+	while (event) {
+		ptrev = litest_is_motion_event(event);
+		last_predicted = libinput_event_pointer_get_dx_predicted(ptrev);
+		libinput_event_destroy(event);
+		event = libinput_get_event(li);
+	}
+	litest_assert_double_gt(last_predicted, 0.0);
+
+	/* The finger stops without lifting, no more frames arrive but the
+	 * prediction still ends */
+	litest_timeout(li, 50);
+
+	event = libinput_get_event(li);
+	ptrev = litest_is_motion_event(event);
+	litest_assert_double_eq(libinput_event_pointer_get_dx(ptrev), 0.0);
+	litest_assert_double_eq(libinput_event_pointer_get_dy(ptrev), 0.0);
+	litest_assert_double_eq(libinput_event_pointer_get_dx_predicted(ptrev), 0.0);
+	litest_assert_double_eq(libinput_event_pointer_get_dy_predicted(ptrev), 0.0);
+	libinput_event_destroy(event);
+	litest_assert_empty_queue(li);
+
+	/* Nothing left to settle on release */
+	litest_touch_up(dev, 0);
+	litest_dispatch(li);
+	litest_assert_empty_queue(li);
+}
+END_TEST
+
+START_TEST(touchpad_1fg_motion_predicted_burst)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput_device *device = dev->libinput_device;
+	struct libinput *li = dev->libinput;
+	enum libinput_config_status status;
+
+	/* Test devices use a 12ms frame interval */
+	status = libinput_device_config_prediction_set_horizon(device, 24);
+	litest_assert_enum_eq(status, LIBINPUT_CONFIG_STATUS_SUCCESS);
+
+	litest_disable_tap(device);
+	litest_disable_hold_gestures(device);
+	litest_drain_events(li);
+
+	/* All frames are processed in one go with almost no time between
+	 * them, the prediction must not exceed two frames' worth of motion */
+	litest_touch_down(dev, 0, 20, 50);
+	for (int i = 1; i <= 10; i++)
+		litest_touch_move(dev, 0, 20 + i * 3, 50);
+	litest_touch_up(dev, 0);
+
+	litest_dispatch(li);
+
+	struct libinput_event *event = libinput_get_event(li);
+	litest_assert_notnull(event);
+
+	while (event) {
+		struct libinput_event_pointer *ptrev = litest_is_motion_event(event);
+		double dx = libinput_event_pointer_get_dx(ptrev);
+		double predicted = libinput_event_pointer_get_dx_predicted(ptrev);
+
+		litest_assert_double_le(predicted, 2 * dx + 0.001);
+		libinput_event_destroy(event);
+		event = libinput_get_event(li);
+	}
+}
+END_TEST
+
+START_TEST(touchpad_frame_rate_merge)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	int nevents = 0;
+
+	litest_disable_tap(dev->libinput_device);
+	litest_disable_hold_gestures(dev->libinput_device);
+	litest_drain_events(li);
+
+	/* The device is limited to 80Hz, a burst of frames with almost no
+	 * time between them gets merged into fewer processed frames */
+	litest_touch_down(dev, 0, 20, 50);
+	for (int i = 1; i <= 10; i++)
+		litest_touch_move(dev, 0, 20 + i * 3, 50);
+	litest_timeout(li, 20);
+
+	event = libinput_get_event(li);
+	litest_assert_notnull(event);
+
+	while (event) {
+		struct libinput_event_pointer *ptrev;
+
+		ptrev = litest_is_motion_event(event);
+		litest_assert_double_ge(libinput_event_pointer_get_dx(ptrev), 0);
+		litest_assert_double_eq(libinput_event_pointer_get_dy(ptrev), 0);
+		nevents++;
+		libinput_event_destroy(event);
+		event = libinput_get_event(li);
+	}
+
+	litest_assert_int_lt(nevents, 10);
+
+	litest_touch_up(dev, 0);
+	litest_dispatch(li);
+}
+END_TEST
+
+START_TEST(touchpad_frame_rate_flush)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	struct libinput_event_pointer *ptrev;
+
+	litest_disable_tap(dev->libinput_device);
+	litest_disable_hold_gestures(dev->libinput_device);
+	litest_drain_events(li);
+
+	litest_touch_down(dev, 0, 20, 50);
+	litest_dispatch(li);
+	litest_assert_empty_queue(li);
+
+	/* Motion right after the touch down is deferred, the timer has
+	 * to process it even though no further frame arrives */
+	litest_touch_move_to(dev, 0, 20, 50, 40, 50, 3);
+	litest_dispatch(li);
+	litest_assert_empty_queue(li);
+
+	litest_timeout(li, 20);
+
+	event = libinput_get_event(li);
+	ptrev = litest_is_motion_event(event);
+	litest_assert_double_gt(libinput_event_pointer_get_dx(ptrev), 0);
+	libinput_event_destroy(event);
+	litest_assert_empty_queue(li);
+
+	litest_touch_up(dev, 0);
+	litest_dispatch(li);
+}
+END_TEST
+
+static double
+touchpad_msc_timestamp_jump_dx(struct litest_device *dev, int interval)
+{
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	double dx = 0.0;
+
+	/* The sequence after a sleep of the i2c controller, see
+	 * tp_process_msc_timestamp() */
+	litest_push_event_frame(dev);
+	litest_touch_down(dev, 0, 20, 50);
+	litest_event(dev, EV_MSC, MSC_TIMESTAMP, 0);
+	litest_pop_event_frame(dev);
+
+	litest_push_event_frame(dev);
+	litest_touch_move(dev, 0, 21, 50);
+	litest_event(dev, EV_MSC, MSC_TIMESTAMP, interval);
+	litest_pop_event_frame(dev);
+	litest_drain_events(li);
+
+	litest_push_event_frame(dev);
+	litest_touch_move(dev, 0, 60, 50);
+	litest_event(dev, EV_MSC, MSC_TIMESTAMP, 123456);
+	litest_pop_event_frame(dev);
+	litest_dispatch(li);
+
+	while ((event = libinput_get_event(li))) {
+		struct libinput_event_pointer *ptrev;
+
+		ptrev = litest_is_motion_event(event);
+		dx += libinput_event_pointer_get_dx(ptrev);
+		libinput_event_destroy(event);
+	}
+
+	litest_touch_up(dev, 0);
+	litest_drain_events(li);
+
+	return dx;
+}
+
+START_TEST(touchpad_msc_timestamp_jump)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	double dx_jump, dx_ignored;
+
+	litest_disable_tap(dev->libinput_device);
+	litest_disable_hold_gestures(dev->libinput_device);
+	litest_drain_events(li);
+
+	/* A 7.3ms hardware interval followed by a timestamp way above it
+	 * is a jump, the motion is spread over the elapsed hardware time
+	 * and thus accelerated less */
+	dx_jump = touchpad_msc_timestamp_jump_dx(dev, 7300);
+
+	/* An interval above 20ms is not the sequence we're looking for,
+	 * the same motion is processed as-is */
+	dx_ignored = touchpad_msc_timestamp_jump_dx(dev, 25000);
+
+	litest_assert_double_gt(dx_jump, 0.0);
+	litest_assert_double_lt(dx_jump, dx_ignored);
+}
+END_TEST
+
 START_TEST(touchpad_2fg_no_motion)
 {
 	struct litest_device *dev = litest_current_device();
@@ -3654,6 +3938,67 @@ START_TEST(touchpad_state_after_syn_dropped_2fg_change)
 }
 END_TEST
 
+START_TEST(touchpad_state_after_syn_dropped_resync)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput_device *device;
+
+	if (litest_slot_count(dev) < 2)
+		return LITEST_NOT_APPLICABLE;
+
+	litest_drain_events(dev->libinput);
+
+	/* Separate context so we can remove the device and see the
+	 * SYN_DROPPED summary */
+	_litest_context_destroy_ struct libinput *li = litest_create_context();
+	device = libinput_path_add_device(li,
+					  libevdev_uinput_get_devnode(dev->uinput));
+	litest_disable_tap(device);
+	litest_disable_hold_gestures(device);
+	libinput_log_set_priority(li, LIBINPUT_LOG_PRIORITY_INFO);
+	litest_drain_events(li);
+
+	litest_with_logcapture(li, capture) {
+		litest_touch_down(dev, 0, 10, 10);
+		litest_dispatch(li);
+
+		/* Force a SYN_DROPPED */
+		for (int i = 0; i < 500; i++)
+			litest_touch_move(dev, 0, 10 + 0.1 * i, 10 + 0.1 * i);
+
+		/* still within SYN_DROPPED, only the resync tells us
+		 * about the second touch */
+		litest_touch_down(dev, 1, 80, 60);
+
+		litest_dispatch(li);
+		litest_assert_strv_substring(capture->infos, "SYN_DROPPED event");
+		litest_drain_events(li);
+		litest_drain_events(dev->libinput);
+
+		/* Both touches are known after the resync, so this is a
+		 * 2fg scroll */
+		litest_touch_move_two_touches(dev, 60, 60, 80, 60, 0, -20, 10);
+		litest_touch_up(dev, 0);
+		litest_touch_up(dev, 1);
+		litest_assert_only_axis_events(li,
+					       LIBINPUT_EVENT_POINTER_SCROLL_FINGER);
+
+		/* pointer motion still works? */
+		litest_touch_down(dev, 0, 50, 50);
+		litest_touch_move_to(dev, 0, 50, 50, 70, 50, 10);
+		litest_touch_up(dev, 0);
+		litest_assert_only_typed_events(li, LIBINPUT_EVENT_POINTER_MOTION);
+
+		libinput_path_remove_device(device);
+		litest_dispatch(li);
+		litest_assert_strv_substring(capture->infos,
+					     "SYN_DROPPED events over");
+	}
+
+	litest_drain_events(dev->libinput);
+}
+END_TEST
+
 START_TEST(touchpad_dwt_single_key)
 {
 	struct litest_device *touchpad = litest_current_device();
@@ -4023,6 +4368,61 @@ START_TEST(touchpad_dwt_type)
 }
 END_TEST
 
+START_TEST(touchpad_dwt_type_extend_timeout)
+{
+	struct litest_device *touchpad = litest_current_device();
+	struct litest_device *keyboard;
+	struct libinput *li = touchpad->libinput;
+	const int nkeys = 10;
+	int nextended = 0;
+
+	if (!has_disable_while_typing(touchpad))
+		return LITEST_NOT_APPLICABLE;
+
+	keyboard = dwt_init_paired_keyboard(li, touchpad);
+	litest_disable_tap(touchpad->libinput_device);
+	litest_disable_hold_gestures(touchpad->libinput_device);
+	libinput_log_set_priority(li, LIBINPUT_LOG_PRIORITY_DEBUG);
+	litest_drain_events(li);
+
+	litest_with_logcapture(li, capture) {
+		/* Typing for well over the dwt timeout, the timer catches up
+		 * with the key presses when it fires instead of being
+		 * re-armed for every key */
+		for (int i = 0; i < nkeys; i++) {
+			litest_keyboard_key(keyboard, KEY_A, true);
+			litest_keyboard_key(keyboard, KEY_A, false);
+			litest_timeout(li, 100);
+		}
+		litest_assert_only_typed_events(li, LIBINPUT_EVENT_KEYBOARD_KEY);
+
+		litest_touch_down(touchpad, 0, 50, 50);
+		litest_touch_move_to(touchpad, 0, 50, 50, 70, 50, 5);
+		litest_touch_up(touchpad, 0);
+		litest_assert_empty_queue(li);
+
+		char **strv = capture->debugs;
+		size_t index;
+		while (strv_find_substring(strv, "palm: keyboard timeout extended", &index)) {
+			nextended++;
+			strv += index + 1;
+		}
+	}
+
+	litest_assert_int_gt(nextended, 0);
+	litest_assert_int_lt(nextended, nkeys);
+
+	litest_timeout_dwt_long(li);
+
+	litest_touch_down(touchpad, 0, 50, 50);
+	litest_touch_move_to(touchpad, 0, 50, 50, 70, 50, 5);
+	litest_touch_up(touchpad, 0);
+	litest_assert_only_typed_events(li, LIBINPUT_EVENT_POINTER_MOTION);
+
+	litest_device_destroy(keyboard);
+}
+END_TEST
+
 START_TEST(touchpad_dwt_type_short_timeout)
 {
 	struct litest_device *touchpad = litest_current_device();
@@ -5674,6 +6074,68 @@ START_TEST(touchpad_thumb_lower_area_movement_rethumb)
 }
 END_TEST
 
+START_TEST(touchpad_thumb_slow_landing)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct axis_replacement axes[] = {
+		{ ABS_MT_TOUCH_MAJOR, 20 },
+		{ ABS_MT_TOUCH_MINOR, 20 },
+		{ -1, 0 },
+	};
+
+	litest_disable_tap(dev->libinput_device);
+	litest_disable_hold_gestures(dev->libinput_device);
+	litest_drain_events(li);
+
+	/* Thumb put down slowly between the thumb lines, it only reaches
+	 * the size threshold a few frames after it landed */
+	litest_touch_down_extended(dev, 0, 50, 88, axes);
+	litest_axis_set_value(axes, ABS_MT_TOUCH_MAJOR, 40);
+	litest_touch_move_extended(dev, 0, 50, 88, axes);
+	litest_axis_set_value(axes, ABS_MT_TOUCH_MAJOR, 55);
+	litest_touch_move_extended(dev, 0, 50, 88, axes);
+	litest_axis_set_value(axes, ABS_MT_TOUCH_MAJOR, 75);
+	litest_touch_move_extended(dev, 0, 50, 88, axes);
+	litest_dispatch(li);
+
+	/* Slow movement - no events */
+	litest_touch_move_to_extended(dev, 0, 50, 88, 55, 88, axes, 50);
+	litest_assert_empty_queue(li);
+
+	litest_touch_up(dev, 0);
+	litest_assert_empty_queue(li);
+}
+END_TEST
+
+START_TEST(touchpad_thumb_slow_landing_finger)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct axis_replacement axes[] = {
+		{ ABS_MT_TOUCH_MAJOR, 20 },
+		{ ABS_MT_TOUCH_MINOR, 20 },
+		{ -1, 0 },
+	};
+
+	litest_disable_tap(dev->libinput_device);
+	litest_disable_hold_gestures(dev->libinput_device);
+	litest_drain_events(li);
+
+	/* Finger between the thumb lines that moves before it gets to
+	 * the thumb size, that's not a thumb being put down */
+	litest_touch_down_extended(dev, 0, 40, 88, axes);
+	litest_touch_move_to_extended(dev, 0, 40, 88, 50, 88, axes, 10);
+	litest_drain_events(li);
+
+	litest_axis_set_value(axes, ABS_MT_TOUCH_MAJOR, 75);
+	litest_touch_move_to_extended(dev, 0, 50, 88, 55, 88, axes, 50);
+	litest_touch_up(dev, 0);
+
+	litest_assert_only_typed_events(li, LIBINPUT_EVENT_POINTER_MOTION);
+}
+END_TEST
+
 START_TEST(touchpad_thumb_speed_empty_slots)
 {
 	struct litest_device *dev = litest_current_device();
@@ -7464,7 +7926,13 @@ TEST_COLLECTION(touchpad)
 {
 	/* clang-format off */
 	litest_add(touchpad_1fg_motion, LITEST_TOUCHPAD, LITEST_ANY);
+	litest_add(touchpad_1fg_motion_predicted, LITEST_TOUCHPAD, LITEST_ANY);
+	litest_add(touchpad_1fg_motion_predicted_burst, LITEST_TOUCHPAD, LITEST_ANY);
+	litest_add(touchpad_1fg_motion_predicted_settle, LITEST_TOUCHPAD, LITEST_ANY);
 	litest_add(touchpad_2fg_no_motion, LITEST_TOUCHPAD, LITEST_SINGLE_TOUCH);
+	litest_add_for_device(touchpad_frame_rate_merge, LITEST_TOUCHPAD_MAX_FRAME_RATE);
+	litest_add_for_device(touchpad_frame_rate_flush, LITEST_TOUCHPAD_MAX_FRAME_RATE);
+	litest_add_for_device(touchpad_msc_timestamp_jump, LITEST_TOUCHPAD_MSC_TIMESTAMP);
 
 	litest_add(touchpad_2fg_scroll, LITEST_TOUCHPAD, LITEST_SINGLE_TOUCH|LITEST_SEMI_MT);
 	litest_add(touchpad_2fg_scroll_initially_diagonal, LITEST_TOUCHPAD, LITEST_SINGLE_TOUCH|LITEST_SEMI_MT);
@@ -7539,9 +8007,12 @@ TEST_COLLECTION(touchpad)
 		litest_add_parametrized(touchpad_fingers_down_before_init, LITEST_TOUCHPAD, LITEST_ANY, params);
 	}
 	litest_add(touchpad_state_after_syn_dropped_2fg_change, LITEST_TOUCHPAD, LITEST_SINGLE_TOUCH);
+	litest_add(touchpad_state_after_syn_dropped_resync, LITEST_TOUCHPAD, LITEST_SINGLE_TOUCH);
 
 	litest_add(touchpad_thumb_lower_area_movement, LITEST_CLICKPAD, LITEST_ANY);
 	litest_add(touchpad_thumb_lower_area_movement_rethumb, LITEST_CLICKPAD, LITEST_ANY);
+	litest_add_for_device(touchpad_thumb_slow_landing, LITEST_MAGIC_TRACKPAD);
+	litest_add_for_device(touchpad_thumb_slow_landing_finger, LITEST_MAGIC_TRACKPAD);
 	litest_add(touchpad_thumb_speed_empty_slots, LITEST_TOUCHPAD, LITEST_SINGLE_TOUCH);
 	litest_add(touchpad_thumb_area_clickfinger, LITEST_CLICKPAD, LITEST_ANY);
 	litest_add(touchpad_thumb_area_btnarea, LITEST_CLICKPAD, LITEST_ANY);
@@ -7617,6 +8088,7 @@ TEST_COLLECTION(touchpad_dwt)
 		litest_add_parametrized(touchpad_dwt_type, LITEST_TOUCHPAD, LITEST_ANY, params);
 	}
 	litest_add(touchpad_dwt_type_short_timeout, LITEST_TOUCHPAD, LITEST_ANY);
+	litest_add(touchpad_dwt_type_extend_timeout, LITEST_TOUCHPAD, LITEST_ANY);
 	litest_add(touchpad_dwt_shift_combo_triggers_dwt, LITEST_TOUCHPAD, LITEST_ANY);
 	litest_add(touchpad_dwt_modifier_no_dwt, LITEST_TOUCHPAD, LITEST_ANY);
 	litest_add(touchpad_dwt_modifier_combo_no_dwt, LITEST_TOUCHPAD, LITEST_ANY);
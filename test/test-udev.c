@@ -28,6 +28,7 @@
 #include <libinput-util.h>
 #include <libinput.h>
 #include <libudev.h>
+#include <poll.h>
 #include <unistd.h>
 
 #include "litest.h"
@@ -378,6 +379,61 @@ START_TEST(udev_suspend_resume)
 }
 END_TEST
 
+START_TEST(udev_suspend_resume_keep_devices)
+{
+	struct libinput_event *event;
+	int num_devices = 0;
+	int added = 0, removed = 0;
+
+	_unref_(udev) *udev = udev_new();
+	litest_assert_notnull(udev);
+
+	_unref_(libinput) *li =
+		libinput_udev_create_context(&simple_interface, NULL, udev);
+	litest_assert_notnull(li);
+	litest_assert_int_eq(libinput_set_suspend_mode(li,
+						       LIBINPUT_SUSPEND_MODE_KEEP_DEVICES),
+			     0);
+	litest_assert_int_eq(libinput_udev_assign_seat(li, "seat0"), 0);
+
+	litest_assert_int_ge(litest_dispatch(li), 0);
+	process_events_count_devices(li, &num_devices);
+	litest_assert_int_gt(num_devices, 0);
+
+	/* Neither the suspend nor the resume may remove or add devices */
+	libinput_suspend(li);
+	litest_assert_int_ge(litest_dispatch(li), 0);
+	libinput_resume(li);
+	litest_assert_int_ge(litest_dispatch(li), 0);
+
+	while ((event = libinput_get_event(li))) {
+		switch (libinput_event_get_type(event)) {
+		case LIBINPUT_EVENT_DEVICE_ADDED:
+			added++;
+			break;
+		case LIBINPUT_EVENT_DEVICE_REMOVED:
+			removed++;
+			break;
+		default:
+			break;
+		}
+		libinput_event_destroy(event);
+	}
+
+	litest_assert_int_eq(added, 0);
+	litest_assert_int_eq(removed, 0);
+
+	/* Back to the default, devices are removed */
+	litest_assert_int_eq(libinput_set_suspend_mode(li,
+						       LIBINPUT_SUSPEND_MODE_REMOVE_DEVICES),
+			     0);
+	libinput_suspend(li);
+	litest_assert_int_ge(litest_dispatch(li), 0);
+	process_events_count_devices(li, &num_devices);
+	litest_assert_int_eq(num_devices, 0);
+}
+END_TEST
+
 START_TEST(udev_resume_before_seat)
 {
 	_unref_(udev) *udev = udev_new();
@@ -596,6 +652,170 @@ START_TEST(udev_ignore_device)
 }
 END_TEST
 
+static char *
+litest_device_sysname(struct litest_device *dev)
+{
+	const char *devnode = libevdev_uinput_get_devnode(dev->uinput);
+
+	return safe_strdup(strrchr(devnode, '/') + 1);
+}
+
+/**
+ * Wait until our own monitor has seen the uevent. The uevents are
+ * multicast, so libinput's monitor has it queued at that point too.
+ */
+static void
+monitor_wait_for_uevent(struct udev_monitor *monitor,
+			const char *sysname,
+			const char *action)
+{
+	struct pollfd fds = {
+		.fd = udev_monitor_get_fd(monitor),
+		.events = POLLIN,
+	};
+
+	while (true) {
+		litest_assert_int_gt(poll(&fds, 1, 2000), 0);
+
+		_unref_(udev_device) *d = udev_monitor_receive_device(monitor);
+		if (d && streq(udev_device_get_sysname(d), sysname) &&
+		    streq(udev_device_get_action(d), action))
+			return;
+	}
+}
+
+static void
+trigger_uevent(const char *sysname, const char *action)
+{
+	_autofree_ char *path = strdup_printf("/sys/class/input/%s/uevent", sysname);
+	int fd = open(path, O_WRONLY);
+
+	litest_assert_errno_success(fd);
+	litest_assert_int_eq(write(fd, action, strlen(action)), (ssize_t)strlen(action));
+	close(fd);
+}
+
+struct hotplug_count {
+	const char *sysname;
+	int added;
+	int removed;
+};
+
+static void
+count_hotplug_events(struct libinput *li, struct hotplug_count *counts, size_t ncounts)
+{
+	struct libinput_event *event;
+
+	while ((event = libinput_get_event(li))) {
+		enum libinput_event_type type = libinput_event_get_type(event);
+		const char *sysname =
+			libinput_device_get_sysname(libinput_event_get_device(event));
+
+		for (size_t i = 0; i < ncounts; i++) {
+			if (!streq(sysname, counts[i].sysname))
+				continue;
+
+			if (type == LIBINPUT_EVENT_DEVICE_ADDED)
+				counts[i].added++;
+			else if (type == LIBINPUT_EVENT_DEVICE_REMOVED)
+				counts[i].removed++;
+		}
+		libinput_event_destroy(event);
+	}
+}
+
+START_TEST(udev_monitor_batch)
+{
+	_unref_(udev) *udev = udev_new();
+	litest_assert_notnull(udev);
+
+	_unref_(udev_monitor) *monitor = udev_monitor_new_from_netlink(udev, "udev");
+	litest_assert_notnull(monitor);
+	udev_monitor_filter_add_match_subsystem_devtype(monitor, "input", NULL);
+	litest_assert_int_eq(udev_monitor_enable_receiving(monitor), 0);
+
+	_unref_(libinput) *li =
+		libinput_udev_create_context(&simple_interface, NULL, udev);
+	litest_assert_notnull(li);
+	litest_assert_int_eq(libinput_udev_assign_seat(li, "seat0"), 0);
+	litest_dispatch(li);
+	litest_drain_events(li);
+
+	/* Add two devices and remove one of them before libinput gets to
+	 * see any of it: the flap must not produce any events */
+	struct litest_device *mouse =
+		litest_create(LITEST_MOUSE, NULL, NULL, NULL, NULL);
+	_autofree_ char *mouse_sysname = litest_device_sysname(mouse);
+	struct litest_device *flap =
+		litest_create(LITEST_KEYBOARD, NULL, NULL, NULL, NULL);
+	_autofree_ char *flap_sysname = litest_device_sysname(flap);
+	litest_device_destroy(flap);
+
+	monitor_wait_for_uevent(monitor, mouse_sysname, "add");
+	monitor_wait_for_uevent(monitor, flap_sysname, "add");
+	monitor_wait_for_uevent(monitor, flap_sysname, "remove");
+
+	litest_dispatch(li);
+	{
+		struct hotplug_count counts[] = {
+			{ .sysname = mouse_sysname },
+			{ .sysname = flap_sysname },
+		};
+
+		count_hotplug_events(li, counts, ARRAY_LENGTH(counts));
+		litest_assert_int_eq(counts[0].added, 1);
+		litest_assert_int_eq(counts[0].removed, 0);
+		litest_assert_int_eq(counts[1].added, 0);
+		litest_assert_int_eq(counts[1].removed, 0);
+	}
+
+	/* Another add for a device we already have is a duplicate, a new
+	 * device in the same batch is added */
+	trigger_uevent(mouse_sysname, "add");
+	struct litest_device *keyboard =
+		litest_create(LITEST_KEYBOARD, NULL, NULL, NULL, NULL);
+	_autofree_ char *keyboard_sysname = litest_device_sysname(keyboard);
+
+	monitor_wait_for_uevent(monitor, mouse_sysname, "add");
+	monitor_wait_for_uevent(monitor, keyboard_sysname, "add");
+
+	litest_dispatch(li);
+	{
+		struct hotplug_count counts[] = {
+			{ .sysname = mouse_sysname },
+			{ .sysname = keyboard_sysname },
+		};
+
+		count_hotplug_events(li, counts, ARRAY_LENGTH(counts));
+		litest_assert_int_eq(counts[0].added, 0);
+		litest_assert_int_eq(counts[0].removed, 0);
+		litest_assert_int_eq(counts[1].added, 1);
+		litest_assert_int_eq(counts[1].removed, 0);
+	}
+
+	/* Both removals in one batch */
+	litest_device_destroy(mouse);
+	litest_device_destroy(keyboard);
+
+	monitor_wait_for_uevent(monitor, mouse_sysname, "remove");
+	monitor_wait_for_uevent(monitor, keyboard_sysname, "remove");
+
+	litest_dispatch(li);
+	{
+		struct hotplug_count counts[] = {
+			{ .sysname = mouse_sysname },
+			{ .sysname = keyboard_sysname },
+		};
+
+		count_hotplug_events(li, counts, ARRAY_LENGTH(counts));
+		litest_assert_int_eq(counts[0].added, 0);
+		litest_assert_int_eq(counts[0].removed, 1);
+		litest_assert_int_eq(counts[1].added, 0);
+		litest_assert_int_eq(counts[1].removed, 1);
+	}
+}
+END_TEST
+
 TEST_COLLECTION(udev)
 {
 	/* clang-format off */
@@ -611,6 +831,7 @@ TEST_COLLECTION(udev)
 	litest_add_for_device(udev_double_suspend, LITEST_SYNAPTICS_CLICKPAD_X220);
 	litest_add_for_device(udev_double_resume, LITEST_SYNAPTICS_CLICKPAD_X220);
 	litest_add_for_device(udev_suspend_resume, LITEST_SYNAPTICS_CLICKPAD_X220);
+	litest_add_for_device(udev_suspend_resume_keep_devices, LITEST_SYNAPTICS_CLICKPAD_X220);
 	litest_add_for_device(udev_resume_before_seat, LITEST_SYNAPTICS_CLICKPAD_X220);
 	litest_add_for_device(udev_suspend_resume_before_seat, LITEST_SYNAPTICS_CLICKPAD_X220);
 	litest_add_for_device(udev_device_sysname, LITEST_SYNAPTICS_CLICKPAD_X220);
@@ -620,5 +841,6 @@ TEST_COLLECTION(udev)
 	litest_add_for_device(udev_path_remove_device, LITEST_SYNAPTICS_CLICKPAD_X220);
 
 	litest_add_no_device(udev_ignore_device);
+	litest_add_no_device(udev_monitor_batch);
 	/* clang-format on */
 }
@@ -31,6 +31,7 @@
 #include "util-bits.h"
 #include "util-files.h"
 #include "util-input-event.h"
+#include "util-key-count.h"
 #include "util-list.h"
 #include "util-macros.h"
 #include "util-matrix.h"
@@ -325,6 +326,40 @@ START_TEST(bitfield_helpers)
 }
 END_TEST
 
+START_TEST(long_bit_iterator)
+{
+	unsigned long bits[NLONGS(KEY_CNT)] = { 0 };
+	const int expected[] = { 0, 1, 63, 64, 65, 127, 300, KEY_MAX };
+	size_t idx = 0;
+
+	litest_assert_int_eq(long_find_next_bit(bits, ARRAY_LENGTH(bits), 0), -1);
+
+	ARRAY_FOR_EACH(expected, e)
+		long_set_bit(bits, *e);
+
+	long_bit_for_each(bits, ARRAY_LENGTH(bits), b) {
+		litest_assert_int_lt(idx, ARRAY_LENGTH(expected));
+		litest_assert_int_eq(b, expected[idx]);
+		idx++;
+	}
+	litest_assert_int_eq(idx, ARRAY_LENGTH(expected));
+
+	litest_assert_int_eq(long_find_next_bit(bits, ARRAY_LENGTH(bits), 2), 63);
+	litest_assert_int_eq(long_find_next_bit(bits, ARRAY_LENGTH(bits), 128), 300);
+	litest_assert_int_eq(long_find_next_bit(bits, ARRAY_LENGTH(bits), KEY_CNT), -1);
+
+	/* clearing bits ahead of the iterator skips them */
+	idx = 0;
+	long_bit_for_each(bits, ARRAY_LENGTH(bits), b) {
+		long_clear_bit(bits, b);
+		long_clear_bit(bits, 300);
+		idx++;
+	}
+	litest_assert_int_eq(idx, ARRAY_LENGTH(expected) - 1);
+	litest_assert(!long_any_bit_set(bits, ARRAY_LENGTH(bits)));
+}
+END_TEST
+
 START_TEST(bitmask_test)
 {
 	{
@@ -599,6 +634,46 @@ START_TEST(matrix_helpers)
 }
 END_TEST
 
+START_TEST(key_count_test)
+{
+	struct key_count kc = { 0 };
+
+	litest_assert(!key_count_any_down(&kc));
+	litest_assert_int_eq(key_count_get(&kc, KEY_A), 0U);
+
+	/* releasing a key that isn't down */
+	litest_assert_int_eq(key_count_dec(&kc, KEY_A), 0U);
+	litest_assert(!key_count_any_down(&kc));
+
+	litest_assert_int_eq(key_count_inc(&kc, KEY_A), 1U);
+	litest_assert_int_eq(key_count_inc(&kc, KEY_MAX), 1U);
+	litest_assert(key_count_is_down(&kc, KEY_A));
+	litest_assert(key_count_any_down(&kc));
+
+	/* multiple presses go into the extra table */
+	for (uint32_t i = 2; i <= 10; i++) {
+		litest_assert_int_eq(key_count_inc(&kc, BTN_LEFT), i - 1);
+		litest_assert_int_eq(key_count_inc(&kc, KEY_A), i);
+	}
+	litest_assert_int_eq(key_count_get(&kc, KEY_A), 10U);
+	litest_assert_int_eq(key_count_get(&kc, BTN_LEFT), 9U);
+
+	for (uint32_t i = 10; i > 0; i--)
+		litest_assert_int_eq(key_count_dec(&kc, KEY_A), i - 1);
+	litest_assert(!key_count_is_down(&kc, KEY_A));
+	litest_assert_int_eq(key_count_get(&kc, BTN_LEFT), 9U);
+
+	for (uint32_t i = 9; i > 0; i--)
+		litest_assert_int_eq(key_count_dec(&kc, BTN_LEFT), i - 1);
+	litest_assert_int_eq(key_count_dec(&kc, KEY_MAX), 0U);
+	litest_assert(!key_count_any_down(&kc));
+	litest_assert_int_eq(kc.nextra, 0U);
+
+	key_count_reset(&kc);
+	litest_assert_ptr_null(kc.extra);
+}
+END_TEST
+
 START_TEST(ratelimit_helpers)
 {
 	struct ratelimit rl;
@@ -956,6 +1031,81 @@ START_TEST(boolean_prop_parser)
 }
 END_TEST
 
+START_TEST(udev_properties_test)
+{
+	/* clang-format off */
+	struct udev_property props[] = {
+		{ .key = "ID_SERIAL", .value = "foo" },
+		{ .key = "ID_INPUT_MOUSE", .value = "1" },
+		{ .key = "LIBINPUT_FUZZ_00", .value = "8" },
+		{ .key = "ID_INPUT", .value = "1" },
+		{ .key = "ID_INTEGRATION", .value = "internal" },
+		{ .key = "ID_INPUT_KEY", .value = "0" },
+		{ .key = "LIBINPUT_FUZZ_01", .value = "abc" },
+		{ .key = "ID_INPUT_TOUCHPAD", .value = "yes" },
+	};
+	/* clang-format on */
+	struct udev_property *prop, *first;
+	size_t n;
+	bool b;
+	int i;
+
+	udev_properties_sort(props, ARRAY_LENGTH(props));
+	for (size_t idx = 1; idx < ARRAY_LENGTH(props); idx++)
+		litest_assert_int_lt(strcmp(props[idx - 1].key, props[idx].key), 0);
+
+	prop = udev_properties_find(props, ARRAY_LENGTH(props), "ID_INTEGRATION");
+	litest_assert_notnull(prop);
+	litest_assert_str_eq(prop->value, "internal");
+	litest_assert_ptr_null(udev_properties_find(props, ARRAY_LENGTH(props), "ID_INPUT_"));
+	litest_assert_ptr_null(udev_properties_find(props, ARRAY_LENGTH(props), "ZZZ"));
+	litest_assert_ptr_null(udev_properties_find(props, 0, "ID_INPUT"));
+
+	/* ID_INPUT and ID_INTEGRATION sort right next to the range but are
+	 * not part of it */
+	n = udev_properties_find_prefix(props, ARRAY_LENGTH(props), "ID_INPUT_", &first);
+	litest_assert_int_eq(n, 3U);
+	litest_assert_str_eq(first[0].key, "ID_INPUT_KEY");
+	litest_assert_str_eq(first[1].key, "ID_INPUT_MOUSE");
+	litest_assert_str_eq(first[2].key, "ID_INPUT_TOUCHPAD");
+
+	n = udev_properties_find_prefix(props, ARRAY_LENGTH(props), "LIBINPUT_FUZZ_", &first);
+	litest_assert_int_eq(n, 2U);
+	n = udev_properties_find_prefix(props, ARRAY_LENGTH(props), "ZZZ", &first);
+	litest_assert_int_eq(n, 0U);
+	litest_assert_ptr_null(first);
+	n = udev_properties_find_prefix(props, 0, "ID_", &first);
+	litest_assert_int_eq(n, 0U);
+	litest_assert_ptr_null(first);
+
+	/* Typed values are parsed once, changing the string afterwards
+	 * doesn't change the cached result */
+	prop = udev_properties_find(props, ARRAY_LENGTH(props), "ID_INPUT_MOUSE");
+	litest_assert(udev_property_get_bool(prop, &b));
+	litest_assert(b);
+	prop->value = "0";
+	litest_assert(udev_property_get_bool(prop, &b));
+	litest_assert(b);
+
+	prop = udev_properties_find(props, ARRAY_LENGTH(props), "ID_INPUT_TOUCHPAD");
+	litest_assert(!udev_property_get_bool(prop, &b));
+	prop->value = "1";
+	litest_assert(!udev_property_get_bool(prop, &b));
+
+	prop = udev_properties_find(props, ARRAY_LENGTH(props), "LIBINPUT_FUZZ_00");
+	litest_assert(udev_property_get_int(prop, &i));
+	litest_assert_int_eq(i, 8);
+	prop->value = "16";
+	litest_assert(udev_property_get_int(prop, &i));
+	litest_assert_int_eq(i, 8);
+	litest_assert(!udev_property_get_bool(prop, &b));
+
+	prop = udev_properties_find(props, ARRAY_LENGTH(props), "LIBINPUT_FUZZ_01");
+	litest_assert(!udev_property_get_int(prop, &i));
+	litest_assert(!udev_property_get_int(prop, &i));
+}
+END_TEST
+
 START_TEST(evcode_prop_parser)
 {
 	/* clang-format off */
@@ -3392,8 +3542,10 @@ main(void)
 	ADD_TEST(array_for_each);
 
 	ADD_TEST(bitfield_helpers);
+	ADD_TEST(long_bit_iterator);
 	ADD_TEST(bitmask_test);
 	ADD_TEST(matrix_helpers);
+	ADD_TEST(key_count_test);
 	ADD_TEST(ratelimit_helpers);
 	ADD_TEST(dpi_parser);
 	ADD_TEST(wheel_click_parser);
@@ -3403,6 +3555,7 @@ main(void)
 	ADD_TEST(calibration_prop_parser);
 	ADD_TEST(range_prop_parser);
 	ADD_TEST(boolean_prop_parser);
+	ADD_TEST(udev_properties_test);
 	ADD_TEST(evcode_prop_parser);
 	ADD_TEST(input_prop_parser);
 	ADD_TEST(evdev_abs_parser);
@@ -34,10 +34,92 @@
 #include <string.h>
 #include <unistd.h>
 
+#include "util-mem.h"
 #include "util-strings.h"
 
 #include "shared.h"
 
+struct device_timing {
+	char *sysname;
+	char *timing;
+};
+
+static struct device_timing *timings;
+static size_t ntimings;
+
+#define TIMING_MARKER " - timing: "
+
+/* libinput logs the time spent creating each device as debug message,
+ * collect those so we can print them with the device. Everything else
+ * that would be logged without --timing goes to the default handler. */
+LIBINPUT_ATTRIBUTE_PRINTF(3, 0)
+static void
+timing_log_handler(struct libinput *li,
+		   enum libinput_log_priority priority,
+		   const char *format,
+		   va_list args)
+{
+	char buf[1024];
+	char *marker;
+	va_list args_copy;
+
+	va_copy(args_copy, args);
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+	vsnprintf(buf, sizeof(buf), format, args);
+#pragma GCC diagnostic pop
+
+	marker = strstr(buf, TIMING_MARKER);
+	if (!marker) {
+		if (priority >= LIBINPUT_LOG_PRIORITY_ERROR)
+			tools_log_handler(li, priority, format, args_copy);
+		va_end(args_copy);
+		return;
+	}
+	va_end(args_copy);
+
+	*marker = '\0';
+	marker += strlen(TIMING_MARKER);
+	marker[strcspn(marker, "\n")] = '\0';
+
+	timings = realloc(timings, (ntimings + 1) * sizeof(*timings));
+	if (!timings)
+		abort();
+	timings[ntimings].sysname = strdup_printf("%s", buf);
+	timings[ntimings].timing = strdup_printf("%s", marker);
+	/* sysname is padded */
+	timings[ntimings].sysname[strcspn(timings[ntimings].sysname, " ")] = '\0';
+	ntimings++;
+}
+
+static const char *
+device_timing(struct libinput_device *device)
+{
+	const char *sysname = libinput_device_get_sysname(device);
+
+	/* the last one wins if the device was created more than once */
+	for (size_t i = ntimings; i > 0; i--) {
+		if (streq(timings[i - 1].sysname, sysname))
+			return timings[i - 1].timing;
+	}
+
+	return "n/a";
+}
+
+static void
+device_timings_destroy(void)
+{
+	for (size_t i = 0; i < ntimings; i++) {
+		free(timings[i].sysname);
+		free(timings[i].timing);
+	}
+	free(timings);
+	timings = NULL;
+	ntimings = 0;
+}
+
+static bool show_timing = false;
+
 static const char *
 tap_default(struct libinput_device *device)
 {
@@ -548,16 +630,20 @@ print_device_notify(struct libinput_event *ev)
 	if (libinput_device_has_capability(dev, LIBINPUT_DEVICE_CAP_TABLET_PAD))
 		print_pad_info(dev);
 
+	if (show_timing)
+		print_aligned("Timing", "%s", device_timing(dev));
+
 	printf("\n");
 }
 
 static inline void
 usage(void)
 {
-	printf("Usage: libinput list-devices [--help|--version]\n");
+	printf("Usage: libinput list-devices [--help|--version|--timing]\n");
 	printf("\n"
 	       "--help ...... show this help and exit\n"
 	       "--version ... show version information and exit\n"
+	       "--timing .... show the time spent on creating each device\n"
 	       "\n");
 }
 
@@ -574,11 +660,13 @@ main(int argc, char **argv)
 		enum {
 			OPT_HELP = 1,
 			OPT_VERBOSE,
+			OPT_TIMING,
 		};
 		static struct option opts[] = {
 			CONFIGURATION_OPTIONS,
 			{ "help", no_argument, 0, 'h' },
 			{ "verbose", no_argument, 0, OPT_VERBOSE },
+			{ "timing", no_argument, 0, OPT_TIMING },
 			{ 0, 0, 0, 0 }
 		};
 		c = getopt_long(argc, argv, "h", opts, &option_index);
@@ -592,10 +680,17 @@ main(int argc, char **argv)
 		case OPT_HELP:
 			usage();
 			return EXIT_SUCCESS;
+		case OPT_TIMING:
+			show_timing = true;
+			break;
 		default:
 			return EXIT_INVALID_USAGE;
 		}
 	}
+	/* The timing is logged at debug priority */
+	if (show_timing)
+		tools_set_log_handler(timing_log_handler);
+
 	if (optind < argc) {
 		const char *devices[32] = { NULL };
 		size_t ndevices = 0;
@@ -608,13 +703,18 @@ main(int argc, char **argv)
 		} while (++optind < argc);
 		li = tools_open_backend(BACKEND_DEVICE,
 					devices,
-					false,
+					show_timing,
 					&grab,
 					false,
 					NULL);
 	} else {
 		const char *seat[2] = { "seat0", NULL };
-		li = tools_open_backend(BACKEND_UDEV, seat, false, &grab, false, NULL);
+		li = tools_open_backend(BACKEND_UDEV,
+					seat,
+					show_timing,
+					&grab,
+					false,
+					NULL);
 	}
 	if (!li)
 		return 1;
@@ -630,6 +730,7 @@ main(int argc, char **argv)
 	}
 
 	libinput_unref(li);
+	device_timings_destroy();
 
 	return EXIT_SUCCESS;
 }
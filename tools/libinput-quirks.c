@@ -85,7 +85,10 @@ usage(void)
 	       "	Print the quirks for the given device\n"
 	       "\n"
 	       "  libinput quirks validate [--data-dir /path/to/quirks/dir]\n"
-	       "	Validate the database\n");
+	       "	Validate the database\n"
+	       "\n"
+	       "  libinput quirks compile [--data-dir /path/to/quirks/dir]\n"
+	       "	Compile the database into a binary cache in the data directory\n");
 }
 
 static void
@@ -99,6 +102,7 @@ main(int argc, char **argv)
 {
 	const char *data_path = NULL, *override_file = NULL;
 	bool validate = false;
+	bool compile = false;
 
 	while (1) {
 		int c;
@@ -156,6 +160,13 @@ main(int argc, char **argv)
 			return EXIT_FAILURE;
 		}
 		validate = true;
+	} else if (streq(argv[optind], "compile")) {
+		optind++;
+		if (optind < argc) {
+			usage();
+			return EXIT_FAILURE;
+		}
+		compile = true;
 	} else {
 		fprintf(stderr, "Unnkown action '%s'\n", argv[optind]);
 		return EXIT_FAILURE;
@@ -171,6 +182,19 @@ main(int argc, char **argv)
 		}
 	}
 
+	if (compile) {
+		if (!quirks_compile_cache(data_path,
+					  log_handler,
+					  QLOG_CUSTOM_LOG_PRIORITIES)) {
+			fprintf(stderr,
+				"Failed to compile the device quirks. "
+				"Please see the above errors "
+				"and/or re-run with --verbose for more details\n");
+			return EXIT_FAILURE;
+		}
+		return EXIT_SUCCESS;
+	}
+
 	_unref_(quirks_context) *quirks =
 		quirks_init_subsystem(data_path,
 				      override_file,
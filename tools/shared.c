@@ -359,6 +359,19 @@ tools_parse_option(int option, const char *optarg, struct tools_options *options
 			return 1;
 		options->custom_step = strtod(optarg, NULL);
 		break;
+	case OPT_CUSTOM_SPEEDS:
+		if (!optarg)
+			return 1;
+		options->custom_speeds =
+			double_array_from_string(optarg, ";", &options->custom_nspeeds);
+		if (!options->custom_speeds || options->custom_nspeeds < 2) {
+			fprintf(stderr,
+				"Invalid --set-custom-speeds\n"
+				"Please provide at least 2 speeds separated by a semicolon\n"
+				" e.g. --set-custom-speeds=\"0.0;1.5\"\n");
+			return 1;
+		}
+		break;
 	case OPT_CUSTOM_TYPE:
 		if (!optarg)
 			return 1;
@@ -545,6 +558,23 @@ tools_load_plugins(struct libinput *libinput, char **plugin_paths)
 	}
 }
 
+void
+tools_log_handler(struct libinput *li,
+		  enum libinput_log_priority priority,
+		  const char *format,
+		  va_list args)
+{
+	log_handler(li, priority, format, args);
+}
+
+static libinput_log_handler custom_log_handler = NULL;
+
+void
+tools_set_log_handler(libinput_log_handler handler)
+{
+	custom_log_handler = handler;
+}
+
 static struct libinput *
 tools_open_udev(const char *seat,
 		bool verbose,
@@ -564,7 +594,7 @@ tools_open_udev(const char *seat,
 		return NULL;
 	}
 
-	libinput_log_set_handler(li, log_handler);
+	libinput_log_set_handler(li, custom_log_handler ? custom_log_handler : log_handler);
 	if (verbose)
 		libinput_log_set_priority(li, LIBINPUT_LOG_PRIORITY_DEBUG);
 
@@ -592,8 +622,11 @@ tools_open_device(const char **paths,
 		return NULL;
 	}
 
+	if (custom_log_handler)
+		libinput_log_set_handler(li, custom_log_handler);
 	if (verbose) {
-		libinput_log_set_handler(li, log_handler);
+		if (!custom_log_handler)
+			libinput_log_set_handler(li, log_handler);
 		libinput_log_set_priority(li, LIBINPUT_LOG_PRIORITY_DEBUG);
 	}
 
@@ -729,11 +762,24 @@ tools_device_apply_config(struct libinput_device *device, struct tools_options *
 	if (options->profile == LIBINPUT_CONFIG_ACCEL_PROFILE_CUSTOM) {
 		_destroy_(libinput_config_accel) *config = libinput_config_accel_create(
 			LIBINPUT_CONFIG_ACCEL_PROFILE_CUSTOM);
-		libinput_config_accel_set_points(config,
-						 options->custom_type,
-						 options->custom_step,
-						 options->custom_npoints,
-						 options->custom_points);
+		if (options->custom_speeds) {
+			if (options->custom_nspeeds != options->custom_npoints)
+				fprintf(stderr,
+					"--set-custom-speeds and --set-custom-points "
+					"need the same number of values\n");
+			else
+				libinput_config_accel_set_curve(config,
+								options->custom_type,
+								options->custom_npoints,
+								options->custom_speeds,
+								options->custom_points);
+		} else {
+			libinput_config_accel_set_points(config,
+							 options->custom_type,
+							 options->custom_step,
+							 options->custom_npoints,
+							 options->custom_points);
+		}
 		libinput_device_config_accel_apply(device, config);
 	}
 
@@ -1015,6 +1061,7 @@ tools_list_device_quirks(struct quirks_context *ctx,
 			case QUIRK_ATTR_PALM_PRESSURE_THRESHOLD:
 			case QUIRK_ATTR_THUMB_PRESSURE_THRESHOLD:
 			case QUIRK_ATTR_THUMB_SIZE_THRESHOLD:
+			case QUIRK_ATTR_TOUCHPAD_MAX_FRAME_RATE:
 				quirks_get_uint32(quirks, q, &v);
 				snprintf(buf, sizeof(buf), "%s=%u", name, v);
 				callback(userdata, buf);
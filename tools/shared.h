@@ -68,6 +68,7 @@ enum configuration_options {
 	OPT_APPLY_TO,
 	OPT_CUSTOM_POINTS,
 	OPT_CUSTOM_STEP,
+	OPT_CUSTOM_SPEEDS,
 	OPT_CUSTOM_TYPE,
 	OPT_ROTATION_ANGLE,
 	OPT_PRESSURE_RANGE,
@@ -116,6 +117,7 @@ enum configuration_options {
 	{ "apply-to",                  required_argument, 0, OPT_APPLY_TO },\
 	{ "set-custom-points",         required_argument, 0, OPT_CUSTOM_POINTS },\
 	{ "set-custom-step",           required_argument, 0, OPT_CUSTOM_STEP },\
+	{ "set-custom-speeds",         required_argument, 0, OPT_CUSTOM_SPEEDS },\
 	{ "set-custom-type",           required_argument, 0, OPT_CUSTOM_TYPE },\
 	{ "set-rotation-angle",        required_argument, 0, OPT_ROTATION_ANGLE }, \
 	{ "set-pressure-range",        required_argument, 0, OPT_PRESSURE_RANGE }, \
@@ -174,6 +176,8 @@ struct tools_options {
 	double custom_step;
 	size_t custom_npoints;
 	double *custom_points;
+	size_t custom_nspeeds;
+	double *custom_speeds;
 	unsigned int angle;
 	double pressure_range[2];
 	float calibration[6];
@@ -188,6 +192,21 @@ void
 tools_init_options(struct tools_options *options);
 int
 tools_parse_option(int option, const char *optarg, struct tools_options *options);
+/**
+ * The default log handler for contexts created with tools_open_backend().
+ */
+LIBINPUT_ATTRIBUTE_PRINTF(3, 0)
+void
+tools_log_handler(struct libinput *li,
+		  enum libinput_log_priority priority,
+		  const char *format,
+		  va_list args);
+/**
+ * Use the given log handler instead of the default one for contexts
+ * created with tools_open_backend().
+ */
+void
+tools_set_log_handler(libinput_log_handler handler);
 struct libinput *
 tools_open_backend(enum tools_backend which,
 		   const char **seat_or_devices,
@@ -295,6 +295,12 @@ def test_set_custom_step(libinput_debug_tool):
     libinput_debug_tool.run_command_success(["--set-custom-step=1.0"])
 
 
+def test_set_custom_speeds(libinput_debug_tool):
+    libinput_debug_tool.run_command_missing_arg(["--set-custom-speeds"])
+    libinput_debug_tool.run_command_success(["--set-custom-speeds", "0.0;1.0"])
+    libinput_debug_tool.run_command_success(["--set-custom-speeds=0.0;0.5;3.0"])
+
+
 def test_set_pressure_range(libinput_debug_tool):
     libinput_debug_tool.run_command_missing_arg(["--set-pressure-range"])
     libinput_debug_tool.run_command_success(["--set-pressure-range", "0.1:0.9"])